@@ -0,0 +1,96 @@
+// Example showing use of the MD_UISwitch library
+//
+// Uses a lookup table to find the key pressed on a 16 key analog resistor
+// ladder, rather than checking the analog value against each key in turn.
+//
+// At startup the key table is checked for overlapping key windows and the
+// lookup table is printed in a form that can be pasted into a sketch as a
+// PROGMEM table. Set USE_PROGMEM to 1 and paste the table below to use it
+// from program memory and save the RAM.
+//
+// Prints the switch events on the Serial Monitor
+//
+#include <MD_UISwitch.h>
+
+#define USE_PROGMEM 0   // set to 1 to use the PROGMEM table below
+
+const uint8_t ANALOG_SWITCH_PIN = A0;
+const uint8_t LUT_SHIFT = 2;    // each lookup table byte covers 4 ADC counts
+
+// 16 keys evenly spaced across the ADC range
+MD_UISwitch_Analog::uiAnalogKeys_t kt[] =
+{
+  {  30, 20, '0' }, {  94, 20, '1' }, { 158, 20, '2' }, { 222, 20, '3' },
+  { 286, 20, '4' }, { 350, 20, '5' }, { 414, 20, '6' }, { 478, 20, '7' },
+  { 542, 20, '8' }, { 606, 20, '9' }, { 670, 20, 'A' }, { 734, 20, 'B' },
+  { 798, 20, 'C' }, { 862, 20, 'D' }, { 926, 20, 'E' }, { 990, 20, 'F' },
+};
+
+MD_UISwitch_Analog S(ANALOG_SWITCH_PIN, kt, ARRAY_SIZE(kt));
+
+#if USE_PROGMEM
+const uint8_t lutP[MD_UISwitch_Analog::lookupSize(LUT_SHIFT)] PROGMEM =
+{
+  // paste the table printed by this sketch here
+};
+#else
+uint8_t lut[MD_UISwitch_Analog::lookupSize(LUT_SHIFT)];
+#endif
+
+void printLookup(void)
+// Print the lookup table as C source
+{
+  uint8_t t[MD_UISwitch_Analog::lookupSize(LUT_SHIFT)];
+
+  MD_UISwitch_Analog::buildLookup(kt, ARRAY_SIZE(kt), t, LUT_SHIFT);
+  Serial.print(F("\n\nLookup table, shift "));
+  Serial.print(LUT_SHIFT);
+  for (uint16_t i = 0; i < ARRAY_SIZE(t); i++)
+  {
+    if (i % 16 == 0) Serial.print(F("\n "));
+    Serial.print(F(" 0x"));
+    if (t[i] < 0x10) Serial.print(F("0"));
+    Serial.print(t[i], HEX);
+    Serial.print(F(","));
+  }
+  Serial.print(F("\n"));
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Analog Lookup Example]"));
+
+#if USE_PROGMEM
+  S.setLookup_P(lutP, LUT_SHIFT);
+#else
+  S.setLookup(lut, LUT_SHIFT);
+#endif
+  S.begin();
+
+  if (S.getOverlap())
+    Serial.print(F("\nWarning: key table has overlapping windows"));
+  printLookup();
+}
+
+void loop(void)
+{
+  MD_UISwitch::keyResult_t k = S.read();
+
+  if (k == MD_UISwitch::KEY_NULL)
+    return;
+
+  Serial.print(F("\n"));
+  Serial.print((char)S.getKey());
+  Serial.print(F(" "));
+  switch (k)
+  {
+    case MD_UISwitch::KEY_UP:        Serial.print(F("KEY_UP"));     break;
+    case MD_UISwitch::KEY_DOWN:      Serial.print(F("KEY_DOWN"));   break;
+    case MD_UISwitch::KEY_PRESS:     Serial.print(F("KEY_PRESS"));  break;
+    case MD_UISwitch::KEY_DPRESS:    Serial.print(F("KEY_DOUBLE")); break;
+    case MD_UISwitch::KEY_LONGPRESS: Serial.print(F("KEY_LONG"));   break;
+    case MD_UISwitch::KEY_RPTPRESS:  Serial.print(F("KEY_REPEAT")); break;
+    default:                         Serial.print(F("KEY_UNKNWN")); break;
+  }
+}
@@ -0,0 +1,646 @@
+// Benchmark for the MD_UISwitch library
+//
+// Measures the time taken per call by read() for each type of switch
+// and, separately, by the debounce() and processFSM() logic through the
+// idle, pressed, bouncing and repeat phases of a key press. The hardware
+// scan time is what remains of read() once the logic time is removed.
+//
+// Times are measured using the BENCH_TICKS() timer hook:
+// - AVR       : CPU cycles from Timer1 running at the CPU clock.
+// - host HAL  : nanoseconds of real time (see extras/host).
+// - otherwise : microseconds from micros().
+//
+// On hardware the switch inputs are not driven by the benchmark, so read()
+// is only measured with all switches released (idle). With the host HAL
+// the simulated pins and ADC are scripted through every phase.
+//
+// The compile time MD_UISwitch_DigitalT template is measured on the same
+// pins as the runtime Digital 4 switch for comparison, with the default
+// options and with no options. A switch built on MD_UISwitch_Static with
+// the same scan as User 4 shows the cost of the virtual read() calls.
+//
+// The analog switch is also measured with enableAsyncRead() set. On the
+// host the 104us AVR conversion time is modelled for these, so the time
+// spent waiting for the conversion shows in the blocking read().
+//
+// The matrix is measured at several sizes, sharing the 4x4 matrix pins, to
+// show how the scan time grows with the number of lines driven and read.
+// The 2x4 matrix drives its rows (see setDriveRows()) and the others their
+// columns.
+// With the host HAL an 8x8 matrix is also measured. The host emulation of the
+// port registers costs more than the pin functions it replaces, so on the host
+// compare the I/O accesses rather than the times. The idle read() of the
+// matrix is a single probe of all the keys, and with the host HAL the 4017 is
+// also measured with a probe pin (see setProbePin()).
+//
+// The worst case time for one read() with a key held is compared for full
+// and incremental (see setScanSlice()) matrix and 4017 scans. With the host 
+// HAL the most I/O accesses in one read() are also shown.
+//
+// A 16 switch User object is measured reading through a simulated slow bus,
+// such as an I2C I/O expander, with one bus transaction per switch and with
+// the bulk callback making one transaction for all of them.
+//
+// The 16 key Bank is measured with a callback for each key and debounce RC
+// integrator, and with a word callback reading all the keys at once and
+// debouncing them in parallel (see MD_UISwitch_VDebounce).
+//
+// With the host HAL, the time taken to detect an analog ladder key press and
+// release is also measured with and without the analog filters. The 
+// simulated voltage settles through other key windows on each press and has
+// random noise spikes while the key is held.
+//
+// Results are printed on the Serial Monitor.
+//
+#include <MD_UISwitch.h>
+
+const uint16_t BENCH_CALLS = 1000;  // number of calls measured per phase
+
+#ifndef BENCH_TICKS
+#if defined(UISWITCH_HAL_HEADER)
+typedef uint32_t benchTicks_t;
+#define BENCH_TICKS() hostNanos()
+#define BENCH_UNIT "ns"
+#define BENCH_SIM 1
+#elif defined(__AVR__)
+typedef uint16_t benchTicks_t;
+#define BENCH_TICKS() TCNT1
+#define BENCH_UNIT "cycles"
+#define BENCH_SIM 0
+#else
+typedef uint32_t benchTicks_t;
+#define BENCH_TICKS() micros()
+#define BENCH_UNIT "us"
+#define BENCH_SIM 0
+#endif
+#endif
+
+// Time the expression and add the elapsed ticks to the accumulator
+#define BENCH_TIME(acc, expr) \
+  do { benchTicks_t t0 = BENCH_TICKS(); expr; acc += (benchTicks_t)(BENCH_TICKS() - t0); } while (false)
+
+// Key press phases measured
+typedef enum { PH_IDLE, PH_PRESSED, PH_BOUNCE, PH_REPEAT, PH_COUNT } benchPhase_t;
+const char *phaseName[PH_COUNT] = { "idle", "pressed", "bounce", "repeat" };
+
+// --- Switch definitions
+const uint8_t DIG_PIN[] = { 2, 3, 4, 5 };
+const uint8_t MTX_ROWS = 4, MTX_COLS = 4;
+uint8_t mtxRowPin[MTX_ROWS] = { 6, 7, 8, 9 };
+uint8_t mtxColPin[MTX_COLS] = { 10, 11, 12, 13 };
+char mtxKt[(MTX_ROWS * MTX_COLS) + 1] = "123A456B789C*0#D";
+uint8_t mtx8RowPin[8] = { 24, 25, 26, 27, 28, 29, 30, 31 };   // host HAL only
+uint8_t mtx8ColPin[8] = { 32, 33, 34, 35, 36, 37, 38, 39 };
+char mtx8Kt[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!?";
+const uint8_t ANA_PIN = A0;
+MD_UISwitch_Analog::uiAnalogKeys_t anaKt[] =
+{
+  {  10, 10, 'R' }, { 130, 15, 'U' }, { 305, 15, 'D' }, { 475, 15, 'L' }, { 720, 15, 'S' },
+};
+const uint8_t KM_KEYS = 40;
+const uint8_t KM_CLK = A1, KM_KEY = A2, KM_RST = A3;
+const uint8_t KM_PROBE = A6;    // host HAL only
+uint8_t usrId[] = { 0, 1, 2, 3 };
+
+bool benchActive = false;   // the scripted state of the test key
+
+bool userData(uint8_t id) { return(BENCH_SIM && benchActive && id == usrId[0]); }
+
+// Stand-in for an I/O expander on a slow bus
+const uint16_t BUS_US = 200;    // time for one bus transaction
+const uint16_t BUS_CALLS = 100; // number of calls measured
+uint8_t usr16Id[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+uint32_t busCount = 0;          // bus transactions made
+
+void busTransaction(void)
+{
+  busCount++;
+#if BENCH_SIM
+  uint32_t t0 = hostNanos();
+
+  while (hostNanos() - t0 < BUS_US * 1000UL)
+    ;
+  hostAdvance(BUS_US);
+#else
+  delayMicroseconds(BUS_US);
+#endif
+}
+
+bool busUserData(uint8_t id) { busTransaction(); return(userData(id)); }
+
+uint32_t busUserBulk(void)
+{
+  uint32_t m = 0;
+
+  busTransaction();
+  for (uint8_t i = 0; i < ARRAY_SIZE(usr16Id); i++)
+    if (userData(usr16Id[i])) m |= (1UL << usr16Id[i]);
+
+  return(m);
+}
+
+MD_UISwitch_Digital swDigital1(DIG_PIN[0]);
+MD_UISwitch_Digital swDigital4(DIG_PIN, ARRAY_SIZE(DIG_PIN));
+MD_UISwitch_User    swUser4(usrId, ARRAY_SIZE(usrId), userData);
+MD_UISwitch_User    swUserBus16(usr16Id, ARRAY_SIZE(usr16Id), busUserData);
+MD_UISwitch_User    swUserBulk16(usr16Id, ARRAY_SIZE(usr16Id), busUserBulk);
+MD_UISwitch_Analog  swAnalog5(ANA_PIN, anaKt, ARRAY_SIZE(anaKt));
+MD_UISwitch_Analog  swAnalog5A(ANA_PIN, anaKt, ARRAY_SIZE(anaKt));
+
+// 16 key ladder, the test key is the last in the table
+const uint8_t ANA16_PIN = A4;
+MD_UISwitch_Analog::uiAnalogKeys_t ana16Kt[] =
+{
+  {  30, 20, '0' }, {  94, 20, '1' }, { 158, 20, '2' }, { 222, 20, '3' },
+  { 286, 20, '4' }, { 350, 20, '5' }, { 414, 20, '6' }, { 478, 20, '7' },
+  { 542, 20, '8' }, { 606, 20, '9' }, { 670, 20, 'A' }, { 734, 20, 'B' },
+  { 798, 20, 'C' }, { 862, 20, 'D' }, { 926, 20, 'E' }, { 990, 20, 'F' },
+};
+uint8_t ana16Lut[MD_UISwitch_Analog::lookupSize(2)];
+MD_UISwitch_Analog  swAnalog16(ANA16_PIN, ana16Kt, ARRAY_SIZE(ana16Kt));
+MD_UISwitch_Analog  swAnalog16L(ANA16_PIN, ana16Kt, ARRAY_SIZE(ana16Kt));
+MD_UISwitch_Matrix  swMatrix2x2(2, 2, mtxRowPin, mtxColPin, mtxKt);
+MD_UISwitch_Matrix  swMatrix2x4(2, 4, mtxRowPin, mtxColPin, mtxKt);
+MD_UISwitch_Matrix  swMatrix4x2(4, 2, mtxRowPin, mtxColPin, mtxKt);
+MD_UISwitch_Matrix  swMatrix4x4(MTX_ROWS, MTX_COLS, mtxRowPin, mtxColPin, mtxKt);
+MD_UISwitch_Matrix  swMatrix8x8(8, 8, mtx8RowPin, mtx8ColPin, mtx8Kt);
+MD_UISwitch_Matrix  swMatrix4x4S(MTX_ROWS, MTX_COLS, mtxRowPin, mtxColPin, mtxKt);
+MD_UISwitch_Matrix  swMatrix8x8S(8, 8, mtx8RowPin, mtx8ColPin, mtx8Kt);
+MD_UISwitch_4017KM  sw4017(KM_KEYS, KM_CLK, KM_KEY, KM_RST);
+MD_UISwitch_4017KM  sw4017P(KM_KEYS, KM_CLK, KM_KEY, KM_RST);
+MD_UISwitch_4017KM  sw4017S(KM_KEYS, KM_CLK, KM_KEY, KM_RST);
+
+const uint8_t BANK_KEYS = 16;
+uint8_t bankRC[BANK_KEYS];
+uint16_t bankState[BANK_KEYS], bankTime[BANK_KEYS];
+MD_UISwitch_Bank    swBank16(BANK_KEYS, userData, bankRC, bankState, bankTime);
+
+uint32_t userWord(uint8_t w) { return((w == 0 && userData(usrId[0])) ? (1UL << usrId[0]) : 0); }
+MD_UISwitch_Bank::bankWord_t bankWord[(BANK_KEYS + 31) / 32];
+uint16_t bankWState[BANK_KEYS], bankWTime[BANK_KEYS];
+MD_UISwitch_Bank    swBank16W(BANK_KEYS, userWord, bankWord, bankWState, bankWTime);
+
+// Template parameters must be constants, these are the DIG_PIN[] pins
+MD_UISwitch_DigitalT<LOW, MD_UISwitch::FEATURE_DEFAULT, 2, 3, 4, 5> swDigitalT4;
+MD_UISwitch_DigitalT<LOW, 0, 2, 3, 4, 5> swDigitalT4Min;
+
+// Non-virtual equivalent of MD_UISwitch_User
+class StaticUser : public MD_UISwitch_Static<StaticUser>
+{
+public:
+  StaticUser(uint8_t *ids, uint8_t count) : _ids(ids), _count(count) {}
+  void begin(void) {}
+  int16_t scan(int16_t &idx)
+  {
+    int16_t count = 0;
+
+    for (uint8_t i = 0; i < _count; i++)
+      if (userData(_ids[i]))
+      {
+        if (idx == -1) idx = i;
+        count++;
+      }
+    return(count);
+  }
+  uint8_t keyValue(int16_t idx) { return(_ids[idx]); }
+
+protected:
+  uint8_t *_ids;
+  uint8_t _count;
+};
+
+StaticUser swStaticUser4(usrId, ARRAY_SIZE(usrId));
+
+struct
+{
+  const char  *name;
+  MD_UISwitch *sw;
+} SW[] =
+{
+  { "Digital 1",   &swDigital1 },
+  { "Digital 4",   &swDigital4 },
+  { "User 4",      &swUser4 },
+  { "Analog 5",    &swAnalog5 },
+  { "Analog 16",   &swAnalog16 },
+  { "Analog 16 lookup", &swAnalog16L },
+  { "Matrix 2x2",  &swMatrix2x2 },
+  { "Matrix 2x4",  &swMatrix2x4 },
+  { "Matrix 4x2",  &swMatrix4x2 },
+  { "Matrix 4x4",  &swMatrix4x4 },
+#if BENCH_SIM
+  { "Matrix 8x8",  &swMatrix8x8 },
+#endif
+  { "4017KM 40",   &sw4017 },
+#if BENCH_SIM
+  { "4017KM 40 probe", &sw4017P },
+#endif
+  { "Bank 16",     &swBank16 },
+  { "Bank 16 words", &swBank16W },
+};
+
+// Exposes the switch logic for separate measurement
+class BenchLogic : public MD_UISwitch_Digital
+{
+public:
+  BenchLogic(void) : MD_UISwitch_Digital(0) {};
+  bool db(bool b) { return(debounce(b)); }
+  keyResult_t fsm(bool b) { return(processFSM(b)); }
+  void reset(void) { processFSM(debounce(false, true), true); }
+};
+
+BenchLogic L;
+
+#if BENCH_SIM
+// Simulated hardware - the active key is the first Digital pin,
+// the key at row 1, col 1 on the matrices, key 5 on the 4017 and 'D'
+// on the analog ladder.
+bool drivenLow(uint8_t pin) { return(hostGetPinMode(pin) == OUTPUT && hostGetPin(pin) == LOW); }
+
+bool matrixKey(uint8_t pin, uint8_t row, uint8_t col)
+// The active key connects the row and column, whichever one is driven
+{
+  return(benchActive && ((pin == row && drivenLow(col)) || (pin == col && drivenLow(row))));
+}
+
+uint8_t pinModel(uint8_t pin)
+{
+  static uint32_t rstCount = 0, clkBase = 0;
+
+  if (pin == DIG_PIN[0])
+    return(benchActive ? LOW : HIGH);
+
+  if (matrixKey(pin, mtxRowPin[1], mtxColPin[1]) || matrixKey(pin, mtx8RowPin[1], mtx8ColPin[1]))
+    return(LOW);
+
+  if (pin == KM_KEY)
+  {
+    if (hostPulseCount(KM_RST) != rstCount)   // reset since the last read
+    {
+      rstCount = hostPulseCount(KM_RST);
+      clkBase = hostPulseCount(KM_CLK);
+    }
+    return((benchActive && (hostGetPin(KM_PROBE) == HIGH || hostPulseCount(KM_CLK) - clkBase == 5)) ? HIGH : LOW);
+  }
+
+  return(HIGH);
+}
+
+const uint8_t ANA_LAT_PIN = A5;   // analog pin for the latency test
+uint16_t latAdc = 1023;           // scripted ADC value for the latency test
+
+uint16_t adcModel(uint8_t pin)
+{
+  if (pin == ANA_LAT_PIN) return(latAdc);
+  return(benchActive ? (pin == ANA16_PIN ? 990 : 305) : 1023);
+}
+
+MD_UISwitch_Analog swLatency(ANA_LAT_PIN, anaKt, ARRAY_SIZE(anaKt));
+#endif
+
+// Simulated time passes only on the host, real time passes on hardware
+void benchTime(uint32_t us)
+{
+#if BENCH_SIM
+  hostAdvance(us);
+#else
+  (void)us;
+#endif
+}
+
+// The input for call i of a phase and time between calls
+bool phaseInput(benchPhase_t ph, uint16_t i) { return(ph == PH_BOUNCE ? (i & 1) : ph != PH_IDLE); }
+uint32_t phaseStep(benchPhase_t ph) { return(ph == PH_PRESSED || ph == PH_BOUNCE ? 100 : 1000); }
+
+benchTicks_t overhead;      // cost of the timing itself
+
+uint32_t netTime(uint32_t t)
+// Remove the timing overhead from the total for BENCH_CALLS calls
+{
+  uint32_t o = (uint32_t)overhead * BENCH_CALLS;
+
+  return(t > o ? t - o : 0);
+}
+
+uint32_t logicTime[2][PH_COUNT];  // debounce() and processFSM() results
+
+void printResult(const char *label, uint32_t ticks)
+{
+  Serial.print(F("  "));
+  Serial.print(label);
+  Serial.print(F("="));
+  Serial.print(ticks / BENCH_CALLS);
+}
+
+template <class S> void warmUp(benchPhase_t ph, S *sw)
+// Reach the start of the phase from released and idle state
+{
+  benchActive = false;
+  for (uint16_t i = 0; i < 1000; i++) { sw->read(); benchTime(1000); }
+
+  if (ph == PH_REPEAT)    // hold until past the long press time
+  {
+    benchActive = true;
+    for (uint16_t i = 0; i < 1000; i++) { sw->read(); benchTime(1000); }
+  }
+}
+
+void benchLogic(void)
+{
+  for (uint8_t ph = 0; ph < PH_COUNT; ph++)
+  {
+    uint32_t tDb = 0, tFsm = 0;
+
+    // warm up to the start of the phase
+    L.reset();
+    if (ph == PH_REPEAT)
+    {
+      uint32_t start = millis();
+
+      while (millis() - start < 1000) { L.fsm(true); benchTime(1000); }
+    }
+
+    for (uint16_t i = 0; i < BENCH_CALLS; i++)
+    {
+      bool b = phaseInput((benchPhase_t)ph, i);
+
+      BENCH_TIME(tDb, b = L.db(b));
+      BENCH_TIME(tFsm, L.fsm(ph == PH_REPEAT || b));
+      benchTime(phaseStep((benchPhase_t)ph));
+    }
+    logicTime[0][ph] = netTime(tDb);
+    logicTime[1][ph] = netTime(tFsm);
+  }
+
+  Serial.print(F("\n\nLogic"));
+  for (uint8_t j = 0; j < 2; j++)
+  {
+    Serial.print(j == 0 ? F("\n debounce()   ") : F("\n processFSM() "));
+    for (uint8_t ph = 0; ph < PH_COUNT; ph++)
+      printResult(phaseName[ph], logicTime[j][ph]);
+  }
+}
+
+template <class S> void benchRead(const char *name, S *sw)
+{
+  uint32_t tRead[PH_COUNT];
+#if BENCH_SIM
+  uint32_t io[PH_COUNT];
+#endif
+  uint8_t phases = BENCH_SIM ? PH_COUNT : PH_PRESSED; // only idle on hardware
+
+  sw->begin();
+  for (uint8_t ph = 0; ph < phases; ph++)
+  {
+    uint32_t t = 0;
+
+    warmUp((benchPhase_t)ph, sw);
+#if BENCH_SIM
+    io[ph] = hostIoCount();
+#endif
+    for (uint16_t i = 0; i < BENCH_CALLS; i++)
+    {
+      benchActive = phaseInput((benchPhase_t)ph, i);
+      BENCH_TIME(t, sw->read());
+      benchTime(phaseStep((benchPhase_t)ph));
+    }
+    tRead[ph] = netTime(t);
+#if BENCH_SIM
+    io[ph] = hostIoCount() - io[ph];
+#endif
+  }
+
+  Serial.print(F("\n\n"));
+  Serial.print(name);
+  Serial.print(F("\n read()       "));
+  for (uint8_t ph = 0; ph < phases; ph++)
+    printResult(phaseName[ph], tRead[ph]);
+  Serial.print(F("\n scan         "));
+  for (uint8_t ph = 0; ph < phases; ph++)
+  {
+    uint32_t logic = logicTime[0][ph] + logicTime[1][ph];
+
+    printResult(phaseName[ph], tRead[ph] > logic ? tRead[ph] - logic : 0);
+  }
+#if BENCH_SIM
+  Serial.print(F("\n I/O accesses "));
+  for (uint8_t ph = 0; ph < phases; ph++)
+    printResult(phaseName[ph], io[ph]);
+#endif
+}
+
+template <class S> void benchWorst(const char *name, S *sw)
+// Average and worst case time for one read() with the test key held
+{
+  uint32_t t = 0;
+  benchTicks_t tMax = 0;
+#if BENCH_SIM
+  uint32_t ioMax = 0;
+#endif
+
+  sw->begin();
+  warmUp(PH_PRESSED, sw);
+  benchActive = true;
+  for (uint16_t i = 0; i < BENCH_CALLS; i++)
+  {
+    benchTicks_t dt;
+#if BENCH_SIM
+    uint32_t io = hostIoCount();
+#endif
+
+    dt = BENCH_TICKS();
+    sw->read();
+    dt = BENCH_TICKS() - dt;
+#if BENCH_SIM
+    io = hostIoCount() - io;
+    if (io > ioMax) ioMax = io;
+#endif
+    t += dt;
+    if (dt > tMax) tMax = dt;
+    benchTime(100);
+  }
+
+  Serial.print(F("\n "));
+  Serial.print(name);
+  for (uint8_t i = strlen(name); i < 20; i++)
+    Serial.print(' ');
+  Serial.print(F("calls/scan="));
+  Serial.print(sw->getScanCalls());
+  printResult("average", netTime(t));
+  Serial.print(F("  max="));
+  Serial.print(tMax > overhead ? tMax - overhead : 0);
+#if BENCH_SIM
+  Serial.print(F("  max I/O="));
+  Serial.print(ioMax);
+#endif
+}
+
+void benchBus(const char *name, MD_UISwitch *sw)
+// Average time and bus transactions for one read() with the switches idle
+{
+  uint32_t t = 0, bus;
+
+  sw->begin();
+  benchActive = false;
+  bus = busCount;
+  for (uint16_t i = 0; i < BUS_CALLS; i++)
+  {
+    BENCH_TIME(t, sw->read());
+    benchTime(1000);
+  }
+  bus = busCount - bus;
+
+  Serial.print(F("\n "));
+  Serial.print(name);
+  for (uint8_t i = strlen(name); i < 20; i++)
+    Serial.print(' ');
+  Serial.print(F("read()="));
+  Serial.print(t / BUS_CALLS);
+  Serial.print(F("  bus transactions="));
+  Serial.print(bus / BUS_CALLS);
+}
+
+#if BENCH_SIM
+void benchLatency(const char *name, bool median, uint8_t settle)
+// Average ms from the start of a press of 'D' to KEY_DOWN, and from
+// the end of the press to KEY_UP. Other KEY_DOWN and KEY_UP events are
+// counted as spurious.
+{
+  const uint8_t PRESSES = 50;
+  const uint16_t PRESS_MS = 400;
+  uint32_t rnd = 1, v = 1023;
+  uint32_t tDown = 0, tUp = 0;
+  uint16_t nDown = 0, nUp = 0, spurious = 0;
+
+  swLatency.enableMedian(median);
+  swLatency.setSettleCount(settle);
+  swLatency.begin();
+
+  for (uint8_t p = 0; p < PRESSES; p++)
+  {
+    uint32_t start = millis();
+    bool down = false;
+
+    for (uint16_t i = 0; i < 2 * PRESS_MS; i++)
+    {
+      bool held = (i < PRESS_MS);
+      uint32_t target = held ? 305 : 1023;
+      MD_UISwitch::keyResult_t k;
+
+      // voltage halves the distance to the target each ms, with 5% noise spikes when held
+      v = (v + target) / 2;
+      rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+      latAdc = (held && (rnd % 100) < 5) ? (rnd >> 8) % 1024 : v;
+
+      k = swLatency.read();
+      if (k == MD_UISwitch::KEY_DOWN)
+      {
+        if (held && !down && swLatency.getKey() == 'D') { down = true; nDown++; tDown += millis() - start; }
+        else spurious++;
+      }
+      else if (k == MD_UISwitch::KEY_UP)
+      {
+        if (!held && down) { down = false; nUp++; tUp += millis() - start - PRESS_MS; }
+        else spurious++;
+      }
+      benchTime(1000);
+    }
+  }
+
+  Serial.print(F("\n "));
+  Serial.print(name);
+  for (uint8_t i = strlen(name); i < 18; i++)
+    Serial.print(' ');
+  Serial.print(F("down="));
+  Serial.print(nDown ? tDown / nDown : 0);
+  Serial.print(F("ms  up="));
+  Serial.print(nUp ? tUp / nUp : 0);
+  Serial.print(F("ms  presses="));
+  Serial.print(nDown);
+  Serial.print(F("/"));
+  Serial.print(PRESSES);
+  Serial.print(F("  spurious="));
+  Serial.print(spurious);
+}
+#endif
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Benchmark]"));
+  Serial.print(F("\nAverage " BENCH_UNIT " per call over "));
+  Serial.print(BENCH_CALLS);
+  Serial.print(F(" calls"));
+
+#if defined(__AVR__) && !BENCH_SIM
+  // Timer1 free running at the CPU clock
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+#endif
+#if BENCH_SIM
+  hostSetPinModel(pinModel);
+  hostSetAdcModel(adcModel);
+#endif
+  swAnalog16L.setLookup(ana16Lut, 2);
+  swAnalog5A.enableAsyncRead(true);
+#if BENCH_SIM
+  sw4017P.setProbePin(KM_PROBE);
+#endif
+  swMatrix2x4.setDriveRows(true);
+  swMatrix4x4S.setScanSlice(1);
+  swMatrix8x8S.setScanSlice(2);
+  sw4017S.setScanSlice(8);
+
+  // calibrate the cost of the measurement itself
+  {
+    uint32_t t = 0;
+
+    for (uint16_t i = 0; i < BENCH_CALLS; i++)
+      BENCH_TIME(t, ;);
+    overhead = t / BENCH_CALLS;
+  }
+
+  benchLogic();
+  for (uint8_t i = 0; i < ARRAY_SIZE(SW); i++)
+    benchRead(SW[i].name, SW[i].sw);
+  benchRead("DigitalT 4", &swDigitalT4);
+  benchRead("DigitalT 4 no options", &swDigitalT4Min);
+  benchRead("Static User 4", &swStaticUser4);
+
+#if BENCH_SIM
+  hostSetAdcTime(104);    // AVR conversion time at 16MHz
+  benchRead("Analog 5 with ADC time", &swAnalog5);
+#endif
+  benchRead("Analog 5 async", &swAnalog5A);
+
+  Serial.print(F("\n\nUser 16 on a "));
+  Serial.print(BUS_US);
+  Serial.print(F("us bus"));
+  benchBus("per id callback", &swUserBus16);
+  benchBus("bulk callback", &swUserBulk16);
+
+  Serial.print(F("\n\nWorst case read() with a key held"));
+  benchWorst("Matrix 4x4", &swMatrix4x4);
+  benchWorst("Matrix 4x4 slice 1", &swMatrix4x4S);
+#if BENCH_SIM
+  benchWorst("Matrix 8x8", &swMatrix8x8);
+  benchWorst("Matrix 8x8 slice 2", &swMatrix8x8S);
+#endif
+  benchWorst("4017KM 40", &sw4017);
+  benchWorst("4017KM 40 slice 8", &sw4017S);
+
+#if BENCH_SIM
+  hostSetAdcTime(0);
+  Serial.print(F("\n\nAnalog detection latency"));
+  benchLatency("no filter", false, 1);
+  benchLatency("median", true, 1);
+  benchLatency("settle 3", false, 3);
+  benchLatency("median, settle 3", true, 3);
+#endif
+
+  Serial.print(F("\n"));
+#if BENCH_SIM
+  hostExit(0);
+#endif
+}
+
+void loop(void) {}
@@ -0,0 +1,104 @@
+// Example showing use of the MD_UISwitch library
+//
+// Scans a 4x4 keypad matrix from a timer interrupt and passes the key
+// events to the main loop through a lock-free event queue. The main loop
+// takes the events in batches whenever it is ready, here every 100ms,
+// which is much less often than the switches need to be scanned.
+//
+// On AVR processors the interrupt is piggybacked on the Timer0 millis()
+// timer using the compare A interrupt, which fires once every millisecond.
+// On other architectures the scan is run from loop() every millisecond
+// instead, and this should be replaced by a suitable timer interrupt.
+//
+// Prints the key events, with the time they were detected, on the Serial Monitor
+//
+#include <MD_UISwitch.h>
+
+uint8_t rowPins[] = { 4, 5, 6, 7 };     // connected to keypad row pinouts
+uint8_t colPins[] = { 8, 9, 10, 11 };   // connected to the keypad column pinouts
+
+const uint8_t ROWS = sizeof(rowPins);
+const uint8_t COLS = sizeof(colPins);
+
+char kt[(ROWS*COLS) + 1] = "123A456B789C*0#D";  //define the symbols for the keypad
+
+MD_UISwitch_Matrix S(ROWS, COLS, rowPins, colPins, kt);
+
+MD_UISwitch_Queue::queueEvent_t qBuf[16];   // power of 2 number of events
+MD_UISwitch_Queue Q(qBuf, ARRAY_SIZE(qBuf));
+
+#ifdef __AVR__
+ISR(TIMER0_COMPA_vect)
+{
+  Q.scan(S);
+}
+#endif
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Event Queue Example]"));
+
+  S.begin();
+  S.enableRepeat(false);
+
+#ifdef __AVR__
+  // Timer0 is already running for millis(), just add an interrupt part way through the count
+  OCR0A = 0xAF;
+  TIMSK0 |= _BV(OCIE0A);
+#endif
+}
+
+void loop(void)
+{
+  static uint16_t lostEvents = 0;
+  static uint32_t timeDrain = 0;
+  MD_UISwitch_Queue::queueEvent_t ev[4];
+  uint8_t n;
+
+#ifndef __AVR__
+  static uint32_t timeLast = 0;
+
+  if (millis() != timeLast)
+  {
+    timeLast = millis();
+    Q.scan(S);
+  }
+#endif
+
+  // the main loop is busy with other things and only looks at the keys every 100ms
+  if (millis() - timeDrain < 100)
+    return;
+  timeDrain = millis();
+
+  // take all the events waiting, a few at a time
+  while ((n = Q.pop(ev, ARRAY_SIZE(ev))) != 0)
+  {
+    for (uint8_t i = 0; i < n; i++)
+    {
+      Serial.print(F("\n"));
+      Serial.print(ev[i].time);
+      Serial.print(F(" "));
+      Serial.print((char)ev[i].key);
+      Serial.print(F(" "));
+      switch (ev[i].result)
+      {
+        case MD_UISwitch::KEY_UP:        Serial.print(F("KEY_UP"));     break;
+        case MD_UISwitch::KEY_DOWN:      Serial.print(F("KEY_DOWN"));   break;
+        case MD_UISwitch::KEY_PRESS:     Serial.print(F("KEY_PRESS"));  break;
+        case MD_UISwitch::KEY_DPRESS:    Serial.print(F("KEY_DOUBLE")); break;
+        case MD_UISwitch::KEY_LONGPRESS: Serial.print(F("KEY_LONG"));   break;
+        case MD_UISwitch::KEY_RPTPRESS:  Serial.print(F("KEY_REPEAT")); break;
+        default:                         Serial.print(F("KEY_UNKNWN")); break;
+      }
+    }
+  }
+
+  // report any events lost because the queue was full
+  if (Q.getOverflow() != lostEvents)
+  {
+    Serial.print(F("\nEvents lost: "));
+    Serial.print(Q.getOverflow() - lostEvents);
+    lostEvents = Q.getOverflow();
+  }
+}
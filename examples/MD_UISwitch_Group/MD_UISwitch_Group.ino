@@ -0,0 +1,78 @@
+// Example showing use of the MD_UISwitch library
+//
+// Manages a front panel with different types of switches as one
+// group. A single read() processes all the switches and returns
+// their events in one stream, tagged with the switch that reported
+// each one.
+//
+// Prints the switch events on the Serial Monitor
+//
+#include <MD_UISwitch.h>
+
+// Two individual digital switches
+MD_UISwitch_Digital SWA(2, LOW);
+MD_UISwitch_Digital SWB(3, LOW);
+
+// An LCD shield style analog keypad
+MD_UISwitch_Analog::uiAnalogKeys_t akt[] =
+{
+  {  10, 10, 'R' },  // Right
+  { 130, 15, 'U' },  // Up
+  { 305, 15, 'D' },  // Down
+  { 475, 15, 'L' },  // Left
+  { 720, 15, 'S' },  // Select
+};
+MD_UISwitch_Analog SWK(A0, akt, ARRAY_SIZE(akt));
+
+// A 4x4 keypad matrix
+uint8_t rowPins[] = { 4, 5, 6, 7 };
+uint8_t colPins[] = { 8, 9, 10, 11 };
+char kt[] = "123A456B789C*0#D";
+MD_UISwitch_Matrix SWM(ARRAY_SIZE(rowPins), ARRAY_SIZE(colPins), rowPins, colPins, kt);
+
+// The group of switches
+MD_UISwitch *panel[] = { &SWA, &SWB, &SWK, &SWM };
+const char *panelName[ARRAY_SIZE(panel)] = { "SWA", "SWB", "Keys", "Keypad" };
+MD_UISwitch_Group::groupState_t panelState[ARRAY_SIZE(panel)];
+
+MD_UISwitch_Group G(panel, panelState, ARRAY_SIZE(panel));
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Group Example]"));
+
+  G.begin();      // also initializes all the switches
+  //G.setIdleTime(10);  // only check for new key presses every 10ms
+
+  // switch options are still set on the individual switches
+  SWM.enableRepeatResult(true);
+}
+
+void loop(void)
+{
+  MD_UISwitch_Group::groupEvent_t ev[4];
+  uint8_t n = G.read(ev, ARRAY_SIZE(ev));
+
+  for (uint8_t i = 0; i < n; i++)
+  {
+    Serial.print(F("\n"));
+    Serial.print(panelName[ev[i].id]);
+    if (ev[i].id >= 2)    // the multi key switches
+    {
+      Serial.print(F(" "));
+      Serial.print((char)ev[i].key);
+    }
+    Serial.print(F(" "));
+    switch (ev[i].result)
+    {
+      case MD_UISwitch::KEY_UP:        Serial.print(F("KEY_UP"));     break;
+      case MD_UISwitch::KEY_DOWN:      Serial.print(F("KEY_DOWN"));   break;
+      case MD_UISwitch::KEY_PRESS:     Serial.print(F("KEY_PRESS"));  break;
+      case MD_UISwitch::KEY_DPRESS:    Serial.print(F("KEY_DOUBLE")); break;
+      case MD_UISwitch::KEY_LONGPRESS: Serial.print(F("KEY_LONG"));   break;
+      case MD_UISwitch::KEY_RPTPRESS:  Serial.print(F("KEY_REPEAT")); break;
+      default:                         Serial.print(F("KEY_UNKNWN")); break;
+    }
+  }
+}
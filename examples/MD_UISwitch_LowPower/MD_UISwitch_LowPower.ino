@@ -0,0 +1,96 @@
+// Example showing use of the MD_UISwitch library
+//
+// Only reads the switches when something can happen, rather than
+// continuously polling them. The switches are read when
+// - a pin change interrupt shows that a switch input has changed, or
+// - the deadline reported by nextDeadline() for a timed event is reached.
+// The rest of the time the processor is free to do other work or to sleep.
+//
+// Prints the switch events, and every few seconds the number of reads
+// made compared to the number of times loop() has run.
+//
+#include <MD_UISwitch.h>
+
+// Switches on pins with external interrupts (2 and 3 on an Uno)
+const uint8_t SW_PIN[] = { 2, 3 };
+
+MD_UISwitch_Digital SW0(SW_PIN[0], LOW);
+MD_UISwitch_Digital SW1(SW_PIN[1], LOW);
+
+MD_UISwitch *SW[] = { &SW0, &SW1 };
+
+volatile bool pinChange = true;   // read everything the first time
+
+void switchISR(void)
+{
+  pinChange = true;
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Low Power Example]"));
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(SW); i++)
+  {
+    SW[i]->begin();
+    attachInterrupt(digitalPinToInterrupt(SW_PIN[i]), switchISR, CHANGE);
+  }
+}
+
+void loop(void)
+{
+  static uint32_t timeRead = 0;     // time of the last read
+  static uint32_t deadline = 0;     // ms from timeRead to the next read
+  static uint32_t timeReport = 0;
+  static uint32_t loops = 0, reads = 0;
+
+  loops++;
+
+  if (pinChange || (deadline != MD_UISwitch::DEADLINE_NONE && millis() - timeRead >= deadline))
+  {
+    pinChange = false;
+    timeRead = millis();
+    reads++;
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(SW); i++)
+    {
+      MD_UISwitch::keyResult_t k = SW[i]->read();
+
+      if (k != MD_UISwitch::KEY_NULL)
+      {
+        Serial.print(F("\nSW"));
+        Serial.print(i);
+        Serial.print(F(" "));
+        switch (k)
+        {
+          case MD_UISwitch::KEY_UP:        Serial.print(F("KEY_UP"));     break;
+          case MD_UISwitch::KEY_DOWN:      Serial.print(F("KEY_DOWN"));   break;
+          case MD_UISwitch::KEY_PRESS:     Serial.print(F("KEY_PRESS"));  break;
+          case MD_UISwitch::KEY_DPRESS:    Serial.print(F("KEY_DOUBLE")); break;
+          case MD_UISwitch::KEY_LONGPRESS: Serial.print(F("KEY_LONG"));   break;
+          case MD_UISwitch::KEY_RPTPRESS:  Serial.print(F("KEY_REPEAT")); break;
+          default:                         Serial.print(F("KEY_UNKNWN")); break;
+        }
+      }
+    }
+
+    // work out when the switches next need attention
+    deadline = MD_UISwitch::nextDeadline(SW, ARRAY_SIZE(SW));
+  }
+
+  if (millis() - timeReport >= 5000)
+  {
+    Serial.print(F("\nReads "));
+    Serial.print(reads);
+    Serial.print(F(" in "));
+    Serial.print(loops);
+    Serial.print(F(" loops"));
+    timeReport = millis();
+    loops = reads = 0;
+  }
+
+  // Other work goes here. An application with nothing else to do could
+  // sleep until the next interrupt, as the millis() timer interrupt will
+  // wake it in time for the deadline.
+}
@@ -0,0 +1,62 @@
+// Example showing use of the MD_UISwitch library
+//
+// Uses N-Key Rollover mode on a 4x4 keypad matrix so that keys
+// held together are each detected independently.
+//
+// Prints the key events on the Serial Monitor
+//
+#include <MD_UISwitch.h>
+
+uint8_t rowPins[] = { 4, 5, 6, 7 };     // connected to keypad row pinouts
+uint8_t colPins[] = { 8, 9, 10, 11 };   // connected to the keypad column pinouts
+
+const uint8_t ROWS = sizeof(rowPins);
+const uint8_t COLS = sizeof(colPins);
+
+char kt[(ROWS*COLS) + 1] = "123A456B789C*0#D";  //define the symbols for the keypad
+
+MD_UISwitch_Matrix S(ROWS, COLS, rowPins, colPins, kt);
+
+MD_UISwitch_Matrix::keySlot_t slots[4];     // up to 4 keys tracked at the same time
+MD_UISwitch::keyEvent_t events[ARRAY_SIZE(slots)];
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch NKRO Example]"));
+
+  S.begin();
+  S.enableNKRO(slots, ARRAY_SIZE(slots));
+  //S.enableGhostDetect(false);   // for a matrix with diodes
+  S.enableRepeatResult(true);
+}
+
+void loop(void)
+{
+  static bool ghost = false;
+  uint8_t n = S.read(events, ARRAY_SIZE(events));
+
+  if (S.isGhosting() != ghost)
+  {
+    ghost = S.isGhosting();
+    Serial.print(ghost ? F("\nGhosting - new keys ignored") : F("\nGhosting cleared"));
+  }
+
+  for (uint8_t i = 0; i < n; i++)
+  {
+    Serial.print(F("\n"));
+    Serial.print((char)events[i].key);
+    Serial.print(F(" "));
+    switch (events[i].result)
+    {
+      case MD_UISwitch::KEY_NULL:      /* Serial.print("KEY_NULL"); */  break;
+      case MD_UISwitch::KEY_UP:        Serial.print("KEY_UP");     break;
+      case MD_UISwitch::KEY_DOWN:      Serial.print("KEY_DOWN");   break;
+      case MD_UISwitch::KEY_PRESS:     Serial.print("KEY_PRESS");  break;
+      case MD_UISwitch::KEY_DPRESS:    Serial.print("KEY_DOUBLE"); break;
+      case MD_UISwitch::KEY_LONGPRESS: Serial.print("KEY_LONG");   break;
+      case MD_UISwitch::KEY_RPTPRESS:  Serial.print("KEY_REPEAT"); break;
+      default:                         Serial.print("KEY_UNKNWN"); break;
+    }
+  }
+}
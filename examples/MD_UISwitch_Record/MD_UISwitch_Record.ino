@@ -0,0 +1,86 @@
+// Example showing use of the MD_UISwitch library
+//
+// Records the input to a switch so that a problem seen with a key press 
+// sequence can be replayed off-target. The library must be compiled with 
+// UI_RECORD set to 1. As the library is compiled separately from the sketch,
+// this needs to be changed in MD_UISwitch.h or set in the compiler options 
+// for the whole build.
+//
+// The last samples recorded are kept. Send 'd' on the Serial Monitor to 
+// print them, in the form read by the host replay in extras/host, and 'c' 
+// to clear them. Recording stops while the samples are printed.
+//
+// Prints the switch events on the Serial Monitor
+//
+#include <MD_UISwitch.h>
+
+#if !UI_RECORD
+#error "Set UI_RECORD to 1 in MD_UISwitch.h to use this example"
+#endif
+
+MD_UISwitch_Digital S(2, LOW);
+
+MD_UISwitch_Recorder::sample_t samples[120];
+MD_UISwitch_Recorder R(samples, ARRAY_SIZE(samples));
+
+void dump(void)
+// Print the samples, one per line as "time timeUs key"
+{
+  R.enable(false);
+  Serial.print(F("\n# samples "));
+  Serial.print(R.count());
+  Serial.print(F(" lost "));
+  Serial.print(R.getLost());
+  for (uint16_t i = 0; i < R.count(); i++)
+  {
+    const MD_UISwitch_Recorder::sample_t &s = R.get(i);
+
+    Serial.print(F("\n"));
+    Serial.print(s.time);
+    Serial.print(F(" "));
+    Serial.print(s.timeUs);
+    Serial.print(F(" "));
+    Serial.print(s.key);
+  }
+  Serial.print(F("\n# end\n"));
+  R.enable(true);
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Record Example]"));
+
+  S.begin();
+  S.enableRepeatResult(true);
+  S.setRecorder(&R);
+}
+
+void loop(void)
+{
+  MD_UISwitch::keyResult_t k = S.read();
+
+  if (Serial.available())
+  {
+    switch (Serial.read())
+    {
+      case 'd': dump();    break;
+      case 'c': R.clear(); break;
+    }
+  }
+
+  if (k == MD_UISwitch::KEY_NULL)
+    return;
+
+  Serial.print(F("\n# "));
+  switch (k)
+  {
+    case MD_UISwitch::KEY_UP:        Serial.print(F("KEY_UP"));     break;
+    case MD_UISwitch::KEY_DOWN:      Serial.print(F("KEY_DOWN"));   break;
+    case MD_UISwitch::KEY_PRESS:     Serial.print(F("KEY_PRESS"));  break;
+    case MD_UISwitch::KEY_DPRESS:    Serial.print(F("KEY_DOUBLE")); break;
+    case MD_UISwitch::KEY_LONGPRESS: Serial.print(F("KEY_LONG"));   break;
+    case MD_UISwitch::KEY_RPTPRESS:  Serial.print(F("KEY_REPEAT")); break;
+    default:                         Serial.print(F("KEY_UNKNWN")); break;
+  }
+}
@@ -0,0 +1,92 @@
+// Example showing use of the MD_UISwitch library
+//
+// Defines a new type of switch using the MD_UISwitch_Static template base
+// class. The new class only needs to initialize the hardware and scan the
+// keys - the debounce, FSM and all the options come from the base class.
+// As there are no virtual methods, the compiler can inline the whole of
+// read() into loop().
+//
+// The switches are 8 keys read through a 74HC165 parallel in, serial out
+// shift register, with the key inputs pulled up and active LOW.
+//
+// Prints the switch events on the Serial Monitor
+//
+#include <MD_UISwitch.h>
+
+class Switch165 : public MD_UISwitch_Static<Switch165>
+{
+public:
+  Switch165(uint8_t pinLoad, uint8_t pinClk, uint8_t pinData, const char *kt) :
+    _pinLoad(pinLoad), _pinClk(pinClk), _pinData(pinData), _kt(kt) {};
+
+  void begin(void)
+  {
+    pinMode(_pinLoad, OUTPUT);
+    pinMode(_pinClk, OUTPUT);
+    pinMode(_pinData, INPUT);
+    digitalWrite(_pinLoad, HIGH);
+    digitalWrite(_pinClk, LOW);
+  }
+
+  // Called by read() - return the number of keys pressed and the first one found
+  int16_t scan(int16_t &idx)
+  {
+    int16_t count = 0;
+
+    // latch the inputs then shift them out
+    digitalWrite(_pinLoad, LOW);
+    digitalWrite(_pinLoad, HIGH);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      if (digitalRead(_pinData) == LOW)
+      {
+        if (idx == -1) idx = i;
+        count++;
+      }
+      digitalWrite(_pinClk, HIGH);
+      digitalWrite(_pinClk, LOW);
+    }
+
+    return(count);
+  }
+
+  // Called by read() - the value getKey() returns for a key
+  uint8_t keyValue(int16_t idx) { return(_kt[idx]); }
+
+protected:
+  uint8_t _pinLoad, _pinClk, _pinData;
+  const char *_kt;
+};
+
+Switch165 S(8, 9, 10, "ABCDEFGH");
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Static Example]"));
+
+  S.begin();
+  S.enableRepeatResult(true);
+}
+
+void loop(void)
+{
+  MD_UISwitch::keyResult_t k = S.read();
+
+  if (k == MD_UISwitch::KEY_NULL)
+    return;
+
+  Serial.print(F("\n"));
+  Serial.print((char)S.getKey());
+  Serial.print(F(" "));
+  switch (k)
+  {
+    case MD_UISwitch::KEY_UP:        Serial.print(F("KEY_UP"));     break;
+    case MD_UISwitch::KEY_DOWN:      Serial.print(F("KEY_DOWN"));   break;
+    case MD_UISwitch::KEY_PRESS:     Serial.print(F("KEY_PRESS"));  break;
+    case MD_UISwitch::KEY_DPRESS:    Serial.print(F("KEY_DOUBLE")); break;
+    case MD_UISwitch::KEY_LONGPRESS: Serial.print(F("KEY_LONG"));   break;
+    case MD_UISwitch::KEY_RPTPRESS:  Serial.print(F("KEY_REPEAT")); break;
+    default:                         Serial.print(F("KEY_UNKNWN")); break;
+  }
+}
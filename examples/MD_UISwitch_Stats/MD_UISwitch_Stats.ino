@@ -0,0 +1,111 @@
+// Example showing use of the MD_UISwitch library
+//
+// Shows the instrumentation available when the library is compiled with
+// UI_INSTRUMENT set to 1. As the library is compiled separately from the
+// sketch, this needs to be changed in MD_UISwitch.h or set in the compiler
+// options for the whole build.
+//
+// For each event, prints the time from the key press being first seen to
+// the event being returned by read(), and how much of that was after the
+// debounce accepted the press. Every few seconds prints the switch counters
+// and the histogram of read() times.
+//
+#include <MD_UISwitch.h>
+
+#if !UI_INSTRUMENT
+#error "Set UI_INSTRUMENT to 1 in MD_UISwitch.h to use this example"
+#endif
+
+MD_UISwitch_Digital S(2, LOW);
+
+const char *eventName(MD_UISwitch::keyResult_t k)
+{
+  switch (k)
+  {
+    case MD_UISwitch::KEY_UP:        return("KEY_UP");
+    case MD_UISwitch::KEY_DOWN:      return("KEY_DOWN");
+    case MD_UISwitch::KEY_PRESS:     return("KEY_PRESS");
+    case MD_UISwitch::KEY_DPRESS:    return("KEY_DOUBLE");
+    case MD_UISwitch::KEY_LONGPRESS: return("KEY_LONG");
+    case MD_UISwitch::KEY_RPTPRESS:  return("KEY_REPEAT");
+    default:                         return("KEY_NULL");
+  }
+}
+
+void printStats(void)
+{
+  const MD_UISwitch::uiStats_t &st = S.getStats();
+
+  Serial.print(F("\n\nReads "));
+  Serial.print(st.scans);
+  Serial.print(F(" bounces "));
+  Serial.print(st.bounces);
+  Serial.print(F(" resets "));
+  Serial.print(st.fsmResets);
+  for (uint8_t k = MD_UISwitch::KEY_DOWN; k <= MD_UISwitch::KEY_RPTPRESS; k++)
+  {
+    Serial.print(F("\n "));
+    Serial.print(eventName((MD_UISwitch::keyResult_t)k));
+    Serial.print(F(" "));
+    Serial.print(st.events[k]);
+  }
+  if (st.scans != 0)
+  {
+    Serial.print(F("\nRead time min "));
+    Serial.print(st.readMin);
+    Serial.print(F("us max "));
+    Serial.print(st.readMax);
+    Serial.print(F("us"));
+  }
+  for (uint8_t i = 0; i < UI_STATS_HIST; i++)
+  {
+    Serial.print(F("\n "));
+    if (i == UI_STATS_HIST - 1) Serial.print(F(">="));
+    else Serial.print(F("< "));
+    Serial.print((i == UI_STATS_HIST - 1) ? (8UL << i) : (16UL << i));
+    Serial.print(F("us "));
+    Serial.print(st.readHist[i]);
+  }
+  Serial.print(F("\n"));
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print(F("\n[MD_UISwitch Stats Example]"));
+
+  S.begin();
+  S.enableRepeatResult(true);
+}
+
+void loop(void)
+{
+  static uint32_t timeReport = 0;
+  MD_UISwitch::keyResult_t k = S.read();
+
+  if (k != MD_UISwitch::KEY_NULL)
+  {
+    const MD_UISwitch::uiEventTime_t &et = S.getEventTime();
+
+    Serial.print(F("\n"));
+    Serial.print(eventName(k));
+    Serial.print(F(" press to event "));
+    Serial.print(et.timeEmit - et.timeEdge);
+    Serial.print(F("us, after debounce "));
+    Serial.print(et.timeEmit - et.timeAccept);
+    Serial.print(F("us"));
+    if (et.timeRelease != 0)
+    {
+      Serial.print(F(", after release "));
+      Serial.print(et.timeEmit - et.timeRelease);
+      Serial.print(F("us"));
+    }
+  }
+
+  if (millis() - timeReport >= 10000)
+  {
+    printStats();
+    S.clearStats();
+    timeReport = millis();
+  }
+}
@@ -0,0 +1,305 @@
+/*
+MD_UISwitch_Analog check.
+
+Builds random key tables, some with overlapping windows and some with
+windows past the end of the ADC range, and checks that for every analog
+value the key found is the first table entry whose window holds the value:
+- with the sequential search (no lookup table);
+- with a lookup table in RAM (setLookup()) for each table shift;
+- with the same lookup table used from PROGMEM (setLookup_P()).
+It also checks that getOverlap() is set when, and only when, two windows
+overlap.
+
+It then presses the keys of a resistor ladder with the analog value passing
+through the windows of the keys in between on each press and release, and
+single sample spikes. With the median filter and a settle count, the events
+must be the same as for clean steps between the levels, a few ms later.
+Without them the events are checked to be wrong, so the check is testing
+something.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <MD_UISwitch.h>
+
+const uint16_t TABLES = 2000;     // random key tables checked
+const uint8_t  KEYS_MAX = 16;     // maximum keys in a table
+const uint8_t  SHIFT_MAX = 6;     // largest lookup table shift checked
+const uint16_t VALUE_MAX = 1100;  // analog values checked, past the ADC range
+
+uint32_t rnd = 23;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+// --- Access to the key search
+class AnalogCheck : public MD_UISwitch_Analog
+{
+public:
+  AnalogCheck(uint8_t pin, uiAnalogKeys_t *kt, uint8_t ktSize) : MD_UISwitch_Analog(pin, kt, ktSize) {};
+  int16_t key(uint16_t v) { return(findKey(v)); };
+};
+
+int16_t refKey(const MD_UISwitch_Analog::uiAnalogKeys_t *kt, uint8_t n, uint16_t v)
+// The first key table entry with v in its window
+{
+  for (uint8_t i = 0; i < n; i++)
+    if ((int32_t)v >= (int32_t)kt[i].adcThreshold - kt[i].adcTolerance &&
+      (int32_t)v <= (int32_t)kt[i].adcThreshold + kt[i].adcTolerance)
+      return(i);
+
+  return(-1);
+}
+
+bool refOverlap(const MD_UISwitch_Analog::uiAnalogKeys_t *kt, uint8_t n)
+{
+  for (uint8_t i = 0; i < n; i++)
+    for (uint8_t j = i + 1; j < n; j++)
+      if (abs((int32_t)kt[i].adcThreshold - (int32_t)kt[j].adcThreshold) <= kt[i].adcTolerance + kt[j].adcTolerance)
+        return(true);
+
+  return(false);
+}
+
+// --- Lookup check
+uint32_t checkLookup(void)
+{
+  static uint8_t lut[MD_UISwitch_Analog::lookupSize(0)];
+  MD_UISwitch_Analog::uiAnalogKeys_t kt[KEYS_MAX];
+  uint32_t errSearch = 0, errRAM = 0, errPGM = 0, errOverlap = 0;
+  uint32_t overlaps = 0, shared = 0, entries = 0;
+
+  for (uint16_t t = 0; t < TABLES; t++)
+  {
+    uint8_t n = 1 + random32() % KEYS_MAX;
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+      kt[i].adcThreshold = random32() % VALUE_MAX;
+      kt[i].adcTolerance = random32() % 40;
+      kt[i].value = 'A' + i;
+    }
+
+    for (uint8_t sh = 0; sh <= SHIFT_MAX; sh++)
+    {
+      AnalogCheck search(A0, kt, n), ram(A0, kt, n), pgm(A0, kt, n);
+
+      search.begin();
+      ram.setLookup(lut, sh);
+      ram.begin();      // builds the table
+      pgm.setLookup_P(lut, sh);
+      pgm.begin();
+
+      if (sh == 0)
+      {
+        if (search.getOverlap() != refOverlap(kt, n)) errOverlap++;
+        if (search.getOverlap()) overlaps++;
+      }
+      for (uint16_t v = 0; v <= VALUE_MAX; v++)
+      {
+        int16_t r = refKey(kt, n, v);
+
+        if (search.key(v) != r) errSearch++;
+        if (ram.key(v) != r) errRAM++;
+        if (pgm.key(v) != r) errPGM++;
+      }
+      for (uint16_t i = 0; i < MD_UISwitch_Analog::lookupSize(sh); i++)
+        if (lut[i] == MD_UISwitch_Analog::LUT_SHARED) shared++;
+      entries += MD_UISwitch_Analog::lookupSize(sh);
+    }
+  }
+
+  printf("\nLookup, %u random tables of up to %u keys, shift 0 to %u, values 0 to %u:",
+    TABLES, KEYS_MAX, SHIFT_MAX, VALUE_MAX);
+  printf("\n search errors %lu, RAM table errors %lu, PROGMEM table errors %lu",
+    (unsigned long)errSearch, (unsigned long)errRAM, (unsigned long)errPGM);
+  printf("\n %lu tables with overlaps, overlap errors %lu, %.1f%% of lookup entries shared",
+    (unsigned long)overlaps, (unsigned long)errOverlap, (100.0 * shared) / entries);
+
+  return(errSearch + errRAM + errPGM + errOverlap);
+}
+
+// --- Filter check
+const uint32_t CHECK_MS = 60000;  // simulated time for the filter check
+const uint8_t  SETTLE = 2;        // settle count
+const uint32_t MAX_SHIFT = 8;     // ms an event may move with the slides and filters
+
+MD_UISwitch_Analog::uiAnalogKeys_t ladder[] =
+{
+  {  10, 10, 'R' },
+  { 130, 15, 'U' },
+  { 305, 15, 'D' },
+  { 475, 15, 'L' },
+  { 720, 15, 'S' },
+};
+const uint16_t ADC_IDLE = 1023;
+
+typedef struct
+{
+  uint32_t start, end;    // ms
+  uint8_t  key;           // ladder index
+} press_t;
+
+typedef struct
+{
+  uint32_t time;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+std::vector<press_t> pattern;
+bool noisy;
+
+void makePattern(void)
+// Short and long presses and gaps, far enough from the FSM time limits that
+// a few ms difference does not change the events
+{
+  uint32_t t = 50;
+
+  pattern.clear();
+  while (t < CHECK_MS - 2000)
+  {
+    uint32_t len = (random32() & 1) ? 80 : ((random32() & 1) ? 400 : 1200);
+
+    pattern.push_back({ t, t + len, (uint8_t)(random32() % ARRAY_SIZE(ladder)) });
+    t += len + ((random32() & 1) ? 100 : 500);
+  }
+}
+
+uint16_t slide(uint16_t from, uint16_t to, uint32_t step, bool &done)
+// The value on the way from one level to another passes through the window
+// of each key in between, one sample in each.
+{
+  uint16_t lo = (from < to) ? from : to;
+  uint16_t hi = (from < to) ? to : from;
+  uint32_t n = 0;
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(ladder); i++)
+  {
+    uint8_t k = (from < to) ? i : ARRAY_SIZE(ladder) - 1 - i;
+
+    if (ladder[k].adcThreshold > lo && ladder[k].adcThreshold < hi && n++ == step)
+      return(ladder[k].adcThreshold);
+  }
+  done = true;
+
+  return(to);
+}
+
+uint16_t adcModel(uint8_t pin)
+// A resistor ladder, with slides between levels and single sample spikes
+// if noisy, otherwise clean steps
+{
+  uint32_t t = hostTime() / 1000;
+  uint16_t v = ADC_IDLE;
+  bool done = !noisy;
+
+  (void)pin;
+  for (size_t i = 0; i < pattern.size() && t >= pattern[i].start; i++)
+  {
+    uint16_t level = ladder[pattern[i].key].adcThreshold;
+
+    if (t < pattern[i].end)
+      v = done ? level : slide(ADC_IDLE, level, t - pattern[i].start, done);
+    else if (!done)
+      v = slide(level, ADC_IDLE, t - pattern[i].end, done);
+  }
+  if (noisy && t % 53 == 17)
+    v = ((t * 2654435761UL) >> 16) % (ADC_IDLE + 1);   // spike
+
+  return(v);
+}
+
+std::vector<event_t> runFilter(bool filter)
+{
+  MD_UISwitch_Analog sw(A0, ladder, ARRAY_SIZE(ladder));
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  sw.begin();
+  if (filter)
+  {
+    sw.enableMedian(true);
+    sw.setSettleCount(SETTLE);
+  }
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2];
+    uint8_t n;
+
+    hostSetTime(t * 1000);
+    n = sw.read(ev, ARRAY_SIZE(ev), t);
+    for (uint8_t i = 0; i < n; i++)
+      log.push_back({ t, ev[i].key, ev[i].result });
+  }
+
+  return(log);
+}
+
+uint32_t compare(const std::vector<event_t> &ref, const std::vector<event_t> &log, uint32_t &shift)
+// Count the events that are not the same as the reference, or too late or early
+{
+  uint32_t errors = (ref.size() > log.size()) ? ref.size() - log.size() : log.size() - ref.size();
+
+  shift = 0;
+  for (size_t i = 0; i < ref.size() && i < log.size(); i++)
+  {
+    uint32_t d = (log[i].time > ref[i].time) ? log[i].time - ref[i].time : ref[i].time - log[i].time;
+
+    if (log[i].key != ref[i].key || log[i].result != ref[i].result || d > MAX_SHIFT)
+      errors++;
+    else if (d > shift)
+      shift = d;
+  }
+
+  return(errors);
+}
+
+uint32_t checkFilter(void)
+// The events for clean steps between the ladder levels are the reference.
+// With the median filter and settle count, the slides through other key
+// windows and the spikes must give the same events, a few ms later.
+{
+  std::vector<event_t> ref, filtered, unfiltered;
+  uint32_t errors, errUnfiltered, shift, shiftUnfiltered;
+
+  makePattern();
+  hostSetAdcModel(adcModel);
+  noisy = false;
+  ref = runFilter(false);
+  noisy = true;
+  filtered = runFilter(true);
+  unfiltered = runFilter(false);
+  hostSetAdcModel(nullptr);
+
+  errors = compare(ref, filtered, shift);
+  errUnfiltered = compare(ref, unfiltered, shiftUnfiltered);
+  printf("\n\nLadder with slides and spikes, %u presses, %lu events:", (unsigned)pattern.size(), (unsigned long)ref.size());
+  printf("\n median and settle %u: %lu events, %lu wrong, up to %lums later",
+    SETTLE, (unsigned long)filtered.size(), (unsigned long)errors, (unsigned long)shift);
+  printf("\n unfiltered: %lu events, %lu wrong", (unsigned long)unfiltered.size(), (unsigned long)errUnfiltered);
+
+  // the unfiltered errors show that the check is doing something
+  return(errors + (errUnfiltered == 0 ? 1 : 0));
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Analog Check]\n");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  errors += checkLookup();
+  errors += checkFilter();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,418 @@
+/*
+MD_UISwitch_Bank check.
+
+Presses the keys of a bank with contact bounce, many held together, and
+checks that the bank gives the same events at the same times as a separate
+MD_UISwitch_User for each key with the same settings. The keys use all the
+bank profiles, with different timer and option settings in each.
+
+Each reference switch is read once with its key active before the check
+starts, as an MD_UISwitch_User only debounces a new key from the read after
+it is first found.
+
+It then checks the parallel debounce used by a bank with a word callback:
+- MD_UISwitch_VDebounce for 8, 16 and 32 bit words against a counter for each
+  switch that changes its state after DEBOUNCE_COUNT samples in a row in the
+  new state, with random samples;
+- a 70 key bank with a word callback, so the last word is partly used, against
+  that counter and the FSM for each key, with the keys using all the profiles.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <MD_UISwitch.h>
+
+const uint32_t CHECK_MS = 120000;     // simulated time for each check
+const uint8_t  KEYS = 16;            // keys in the bank with a key callback
+const uint8_t  WORD_KEYS = 70;       // keys in the bank with a word callback
+
+uint32_t rnd = 17;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+// --- Press pattern for each key
+typedef struct
+{
+  uint32_t start, end;    // ms
+} press_t;
+
+std::vector<press_t> pattern[WORD_KEYS];
+bool key[WORD_KEYS];
+
+void makePattern(void)
+// Random presses, mostly taps, some close together and some held long
+{
+  for (uint8_t k = 0; k < WORD_KEYS; k++)
+  {
+    uint32_t t = 50 + random32() % 500;
+
+    pattern[k].clear();
+    while (t < CHECK_MS - 3000)
+    {
+      uint32_t len = 20 + random32() % ((random32() % 4) ? 300 : 2500);
+
+      pattern[k].push_back({ t, t + len });
+      t += len + 20 + random32() % ((random32() % 2) ? 300 : 1500);
+    }
+  }
+}
+
+bool pressed(uint32_t t, uint8_t k)
+// The key state with contact bounce around each change, the same for every run
+{
+  for (size_t i = 0; i < pattern[k].size(); i++)
+  {
+    const press_t &p = pattern[k][i];
+
+    if (t < p.start) break;
+    if (t >= p.end + 4) continue;
+    if (t < p.start + 4 || t >= p.end)
+      return((((t + k) * 2654435761UL) >> 31) != 0);   // bounce
+    return(true);
+  }
+
+  return(false);
+}
+
+bool userRead(uint8_t id) { return(key[id]); }
+
+uint32_t wordRead(uint8_t w)
+// The bits past the last key are set, as they should be ignored
+{
+  uint32_t m = 0;
+
+  for (uint8_t i = 0; i < 32; i++)
+    if ((w * 32) + i >= WORD_KEYS || key[(w * 32) + i])
+      m |= (1UL << i);
+
+  return(m);
+}
+
+// --- Event log
+typedef struct
+{
+  uint32_t time;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+bool operator==(const event_t &a, const event_t &b)
+{
+  return(a.time == b.time && a.key == b.key && a.result == b.result);
+}
+
+// --- Profiles, the same settings for the bank and the reference switches
+void setProfile(MD_UISwitch &s, uint8_t p)
+{
+  switch (p)
+  {
+  case 0:   // the library default times, all options on
+    s.setPressTime(150);
+    s.setDoublePressTime(250);
+    s.setLongPressTime(600);
+    s.setRepeatTime(300);
+    s.enableDoublePress(true);
+    s.enableLongPress(true);
+    s.enableRepeat(true);
+    s.enableRepeatResult(false);
+    break;
+
+  case 1:   // long press only
+    s.setLongPressTime(1000);
+    s.enableDoublePress(false);
+    s.enableRepeat(false);
+    break;
+
+  case 2:   // fast repeat with its own result
+    s.setPressTime(100);
+    s.setRepeatTime(100);
+    s.enableRepeatResult(true);
+    s.enableDoublePress(false);
+    break;
+
+  case 3:   // double press only
+    s.setDoublePressTime(400);
+    s.enableLongPress(false);
+    s.enableRepeat(false);
+    break;
+  }
+}
+
+std::vector<event_t> runBank(void)
+{
+  uint8_t rc[KEYS];
+  uint16_t state[KEYS], time[KEYS];
+  MD_UISwitch_Bank B(KEYS, userRead, rc, state, time);
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  B.begin();
+  for (uint8_t p = MD_UISwitch_Bank::PROFILE_COUNT - 1; p > 0; p--)
+  {
+    setProfile(B, 0);
+    setProfile(B, p);
+    B.saveProfile(p);
+  }
+  setProfile(B, 0);
+  for (uint8_t k = 0; k < KEYS; k++)
+    B.setKeyProfile(k, k % MD_UISwitch_Bank::PROFILE_COUNT);
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2 * KEYS];
+    uint8_t n;
+
+    for (uint8_t k = 0; k < KEYS; k++)
+      key[k] = pressed(t, k);
+    hostSetTime(t * 1000);
+    n = B.read(ev, ARRAY_SIZE(ev));
+    for (uint8_t i = 0; i < n; i++)
+      log.push_back({ t, ev[i].key, ev[i].result });
+  }
+
+  return(log);
+}
+
+std::vector<event_t> runReference(void)
+// One switch for each key
+{
+  uint8_t id[KEYS];
+  std::vector<MD_UISwitch_User> sw;
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  for (uint8_t k = 0; k < KEYS; k++)
+  {
+    id[k] = k;
+    sw.push_back(MD_UISwitch_User(&id[k], 1, userRead));
+  }
+  for (uint8_t k = 0; k < KEYS; k++)
+  {
+    sw[k].begin();
+    setProfile(sw[k], 0);
+    setProfile(sw[k], k % MD_UISwitch_Bank::PROFILE_COUNT);
+    key[k] = true;    // find the key
+    sw[k].read();
+    key[k] = false;
+  }
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    hostSetTime(t * 1000);
+    for (uint8_t k = 0; k < KEYS; k++)
+    {
+      MD_UISwitch::keyEvent_t ev[2];
+      uint8_t n;
+
+      key[k] = pressed(t, k);
+      n = sw[k].read(ev, ARRAY_SIZE(ev));
+      for (uint8_t i = 0; i < n; i++)
+        log.push_back({ t, k, ev[i].result });
+    }
+  }
+
+  return(log);
+}
+
+uint32_t checkBank(void)
+{
+  std::vector<event_t> bank, ref;
+  uint32_t errors = 0;
+
+  makePattern();
+  bank = runBank();
+  ref = runReference();
+  std::stable_sort(bank.begin(), bank.end(),
+    [](const event_t &a, const event_t &b) { return(a.time < b.time || (a.time == b.time && a.key < b.key)); });
+
+  if (bank != ref) errors++;
+  printf("\nBank, %u keys in %u profiles: %lu events, per key reference %s",
+    KEYS, MD_UISwitch_Bank::PROFILE_COUNT, (unsigned long)ref.size(), (bank == ref) ? "same" : "DIFFERENT");
+
+  return(errors);
+}
+
+// --- Parallel debounce check
+template <typename T>
+uint32_t checkVDebounce(const char *name, uint32_t samples)
+// Random samples, each switch mostly following a level that changes now and then
+{
+  const uint8_t BITS = 8 * sizeof(T);
+  MD_UISwitch_VDebounce<T> vd;
+  bool level[32] = { false }, state[32] = { false };
+  uint8_t count[32] = { 0 };
+  uint32_t errors = 0, changes = 0;
+
+  for (uint32_t n = 0; n < samples; n++)
+  {
+    T sample = 0, prev = vd.getState(), out;
+    T expPressed = 0, expReleased = 0, expCounting = 0;
+
+    for (uint8_t i = 0; i < BITS; i++)
+    {
+      if (random32() % 50 == 0) level[i] = !level[i];
+      if ((random32() % 4) ? level[i] : (random32() & 1))
+        sample |= ((T)1 << i);
+    }
+    out = vd.update(sample);
+
+    for (uint8_t i = 0; i < BITS; i++)
+    {
+      if (((sample >> i) & 1) == state[i])
+        count[i] = 0;
+      else if (++count[i] == MD_UISwitch_VDebounce<T>::DEBOUNCE_COUNT)
+      {
+        state[i] = !state[i];
+        count[i] = 0;
+        changes++;
+        if (state[i]) expPressed |= ((T)1 << i); else expReleased |= ((T)1 << i);
+      }
+      if (count[i] != 0) expCounting |= ((T)1 << i);
+      if (((out >> i) & 1) != state[i]) errors++;
+    }
+    if (vd.getState() != out || vd.getPressed() != expPressed || vd.getReleased() != expReleased ||
+      vd.getCounting() != expCounting || (T)(expPressed | expReleased) != (T)(out ^ prev))
+      errors++;
+  }
+
+  printf("\n%-22s %lu samples, %lu changes, per switch reference %s",
+    name, (unsigned long)samples, (unsigned long)changes, (errors == 0) ? "same" : "DIFFERENT");
+
+  return(errors);
+}
+
+// --- Word callback bank check
+class FSMRef : public MD_UISwitch_Digital
+// Access to the FSM, run with the state of each key debounced separately
+{
+public:
+  using MD_UISwitch::fsmState_t;
+  FSMRef(void) : MD_UISwitch_Digital(2) {};
+  keyResult_t fsm(fsmState_t &f, bool b, uint32_t now) { return(processFSM(f, _profile, b, now)); };
+};
+
+std::vector<event_t> runWordBank(void)
+{
+  MD_UISwitch_Bank::bankWord_t word[(WORD_KEYS + 31) / 32];
+  uint16_t state[WORD_KEYS], time[WORD_KEYS];
+  MD_UISwitch_Bank B(WORD_KEYS, wordRead, word, state, time);
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  B.begin();
+  for (uint8_t p = MD_UISwitch_Bank::PROFILE_COUNT - 1; p > 0; p--)
+  {
+    setProfile(B, 0);
+    setProfile(B, p);
+    B.saveProfile(p);
+  }
+  setProfile(B, 0);
+  for (uint8_t k = 0; k < WORD_KEYS; k++)
+    B.setKeyProfile(k, k % MD_UISwitch_Bank::PROFILE_COUNT);
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2 * WORD_KEYS];
+    uint8_t n;
+
+    for (uint8_t k = 0; k < WORD_KEYS; k++)
+      key[k] = pressed(t, k);
+    hostSetTime(t * 1000);
+    n = B.read(ev, ARRAY_SIZE(ev), t);
+    for (uint8_t i = 0; i < n; i++)
+      log.push_back({ t, ev[i].key, ev[i].result });
+  }
+
+  return(log);
+}
+
+std::vector<event_t> runWordReference(void)
+// A counter and FSM for each key, with the FSM settings of its profile
+{
+  FSMRef prof[MD_UISwitch_Bank::PROFILE_COUNT];
+  FSMRef::fsmState_t fsm[WORD_KEYS];
+  bool state[WORD_KEYS] = { false };
+  uint8_t count[WORD_KEYS] = { 0 };
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  for (uint8_t p = 0; p < MD_UISwitch_Bank::PROFILE_COUNT; p++)
+  {
+    prof[p].begin();
+    setProfile(prof[p], 0);
+    setProfile(prof[p], p);
+  }
+  memset(fsm, 0, sizeof(fsm));
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    hostSetTime(t * 1000);
+    for (uint8_t k = 0; k < WORD_KEYS; k++)
+    {
+      MD_UISwitch::keyResult_t r;
+
+      if (pressed(t, k) == state[k])
+        count[k] = 0;
+      else if (++count[k] == MD_UISwitch_VDebounce<uint32_t>::DEBOUNCE_COUNT)
+      {
+        state[k] = !state[k];
+        count[k] = 0;
+      }
+
+      r = prof[k % MD_UISwitch_Bank::PROFILE_COUNT].fsm(fsm[k], state[k], t);
+      if (r != MD_UISwitch::KEY_NULL)
+        log.push_back({ t, k, r });
+      if (fsm[k].kPush != MD_UISwitch::KEY_NULL)
+      {
+        log.push_back({ t, k, fsm[k].kPush });
+        fsm[k].kPush = MD_UISwitch::KEY_NULL;
+      }
+    }
+  }
+
+  return(log);
+}
+
+uint32_t checkWordBank(void)
+{
+  std::vector<event_t> bank, ref;
+  uint32_t errors = 0;
+
+  errors += checkVDebounce<uint8_t>("VDebounce<uint8_t>:", 200000);
+  errors += checkVDebounce<uint16_t>("VDebounce<uint16_t>:", 200000);
+  errors += checkVDebounce<uint32_t>("VDebounce<uint32_t>:", 200000);
+
+  bank = runWordBank();
+  ref = runWordReference();
+  std::stable_sort(bank.begin(), bank.end(),
+    [](const event_t &a, const event_t &b) { return(a.time < b.time || (a.time == b.time && a.key < b.key)); });
+
+  if (bank != ref) errors++;
+  printf("\nBank, %u keys with a word callback: %lu events, per key reference %s",
+    WORD_KEYS, (unsigned long)ref.size(), (bank == ref) ? "same" : "DIFFERENT");
+
+  return(errors);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Bank Check]\n");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  errors += checkBank();
+  errors += checkWordBank();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
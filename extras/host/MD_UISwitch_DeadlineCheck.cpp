@@ -0,0 +1,262 @@
+/*
+MD_UISwitch nextDeadline() check.
+
+Reads each kind of switch (Digital, Matrix, NKRO Matrix, Analog and Bank),
+driven by a scripted pattern of bouncing key presses with two keys, and
+checks that reading it only when nextDeadline() has run out, or when an
+input changes as a pin change interrupt would signal, gives the same events
+at the same times as reading it every millisecond. This is done with several
+sets of options:
+- the defaults;
+- repeat events as KEY_RPTPRESS;
+- no double or long press;
+- a 10ms debounce time, eager press, and both together.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <MD_UISwitch.h>
+
+const uint32_t CHECK_MS = 60000;      // simulated time for each check
+
+// --- Switch inputs
+uint8_t digPin[] = { 4, 5, 6 };
+uint8_t rowPin[] = { 20, 21 };
+uint8_t colPin[] = { 22, 23, 24 };
+char kt[] = "abcdef";
+MD_UISwitch_Analog::uiAnalogKeys_t akt[] =
+{
+  {  10, 10, 'R' },
+  { 130, 15, 'U' },
+  { 305, 15, 'D' },
+};
+const uint8_t BANK_KEYS = 4;
+
+// The second key follows the same press pattern as the first, INPUT_OFS later
+const uint32_t INPUT_OFS = 137;
+
+enum switchType_t { SW_DIGITAL, SW_MATRIX, SW_NKRO, SW_ANALOG, SW_BANK };
+const char *typeName[] = { "Digital", "Matrix", "NKRO", "Analog", "Bank" };
+const char *optName[] = { "defaults", "repeat result", "no double/long press", "10ms debounce", "eager press", "10ms debounce, eager press" };
+
+// --- Press pattern
+typedef struct
+{
+  uint32_t start, end;    // ms
+} press_t;
+
+std::vector<press_t> pattern;
+uint32_t rnd = 19;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+void makePattern(void)
+// Random presses, mostly taps with some long holds
+{
+  uint32_t t = 50;
+
+  pattern.clear();
+  while (t < CHECK_MS - 1000)
+  {
+    uint32_t len = 20 + random32() % ((random32() % 3) ? 300 : 2500);
+
+    pattern.push_back({ t, t + len });
+    t += len + 20 + random32() % 400;
+  }
+}
+
+bool pressed(uint32_t t)
+{
+  for (size_t i = 0; i < pattern.size(); i++)
+    if (t >= pattern[i].start && t < pattern[i].end)
+      return(true);
+
+  return(false);
+}
+
+bool input(uint32_t t, uint8_t i)
+// The input with contact bounce around each change, the same for every run
+{
+  uint32_t ti = t + (i * INPUT_OFS);
+  bool b = pressed(ti);
+
+  if (t % 7 == 3 && pressed(ti + 3) != b)
+    b = !b;
+
+  return(b);
+}
+
+// --- Simulated hardware
+bool matrixKey[ARRAY_SIZE(rowPin) * ARRAY_SIZE(colPin)];
+bool bankKey[BANK_KEYS];
+
+bool driven(uint8_t pin) { return(hostGetPinMode(pin) == OUTPUT && hostGetPin(pin) == LOW); }
+
+uint8_t pinModel(uint8_t pin)
+// Matrix keys connect their row and column, whichever is driven
+{
+  for (uint8_t r = 0; r < ARRAY_SIZE(rowPin); r++)
+    for (uint8_t c = 0; c < ARRAY_SIZE(colPin); c++)
+      if (matrixKey[(r * ARRAY_SIZE(colPin)) + c] &&
+        ((pin == rowPin[r] && driven(colPin[c])) || (pin == colPin[c] && driven(rowPin[r]))))
+        return(LOW);
+
+  for (uint8_t r = 0; r < ARRAY_SIZE(rowPin); r++)
+    if (pin == rowPin[r]) return(HIGH);
+  for (uint8_t c = 0; c < ARRAY_SIZE(colPin); c++)
+    if (pin == colPin[c]) return(HIGH);
+
+  return(hostGetPin(pin));
+}
+
+bool bankRead(uint8_t id) { return(bankKey[id]); }
+
+uint8_t setInputs(uint32_t t)
+// Set the inputs for time t (ms), returning them as a bit mask
+{
+  uint8_t m = (input(t, 0) ? 0x01 : 0) | (input(t, 1) ? 0x02 : 0);
+
+  hostSetTime(t * 1000);
+  hostSetPin(digPin[1], (m & 0x01) ? LOW : HIGH);
+  hostSetPin(digPin[2], (m & 0x02) ? LOW : HIGH);
+  matrixKey[4] = (m & 0x01);
+  matrixKey[2] = (m & 0x02);
+  hostSetAdc(A0, (m & 0x01) ? 300 : ((m & 0x02) ? 130 : 1000));
+  bankKey[1] = (m & 0x01);
+  bankKey[3] = (m & 0x02);
+
+  return(m);
+}
+
+// --- Event log
+typedef struct
+{
+  uint32_t time;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+bool operator==(const event_t &a, const event_t &b)
+{
+  return(a.time == b.time && a.key == b.key && a.result == b.result);
+}
+
+void setOptions(MD_UISwitch &s, uint8_t opt)
+{
+  switch (opt)
+  {
+  case 1:
+    s.enableRepeatResult(true);
+    break;
+
+  case 2:
+    s.enableDoublePress(false);
+    s.enableLongPress(false);
+    break;
+
+  case 3:
+    s.setDebounceTime(10);
+    break;
+
+  case 4:
+    s.enableEagerPress(true);
+    break;
+
+  case 5:
+    s.setDebounceTime(10);
+    s.enableEagerPress(true);
+    break;
+  }
+}
+
+std::vector<event_t> run(switchType_t type, uint8_t opt, bool atDeadline, uint32_t &reads)
+// Read the switch every ms or only at the deadlines and input changes
+{
+  MD_UISwitch_Digital swD(digPin, ARRAY_SIZE(digPin), LOW);
+  MD_UISwitch_Matrix swM(ARRAY_SIZE(rowPin), ARRAY_SIZE(colPin), rowPin, colPin, kt);
+  MD_UISwitch_Matrix::keySlot_t slot[3];
+  MD_UISwitch_Analog swA(A0, akt, ARRAY_SIZE(akt));
+  uint8_t rc[BANK_KEYS];
+  uint16_t state[BANK_KEYS], time[BANK_KEYS];
+  MD_UISwitch_Bank swB(BANK_KEYS, bankRead, rc, state, time);
+  MD_UISwitch *sw[] = { &swD, &swM, &swM, &swA, &swB };
+  MD_UISwitch &s = *sw[type];
+  std::vector<event_t> log;
+  uint32_t wake = 0;
+  uint8_t last = 0;
+
+  reads = 0;
+  hostSetTime(0);
+  setInputs(0);
+  s.begin();
+  if (type == SW_NKRO) swM.enableNKRO(slot, ARRAY_SIZE(slot));
+  setOptions(s, opt);
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2 * ARRAY_SIZE(slot)];
+    uint8_t m = setInputs(t);
+    uint32_t d;
+    uint8_t n;
+
+    if (atDeadline && t < wake && m == last)
+      continue;
+    last = m;
+    reads++;
+    n = s.read(ev, ARRAY_SIZE(ev), t);
+    for (uint8_t i = 0; i < n; i++)
+      log.push_back({ t, ev[i].key, ev[i].result });
+
+    d = s.nextDeadline(t);
+    wake = (d == MD_UISwitch::DEADLINE_NONE) ? 0xffffffff : t + d;
+  }
+
+  return(log);
+}
+
+uint32_t checkDeadline(void)
+{
+  uint32_t errors = 0;
+
+  makePattern();
+  for (uint8_t opt = 0; opt < ARRAY_SIZE(optName); opt++)
+  {
+    printf("\n\nOptions: %s", optName[opt]);
+    for (uint8_t type = SW_DIGITAL; type <= SW_BANK; type++)
+    {
+      std::vector<event_t> ref, dl;
+      uint32_t readsRef, readsDl;
+
+      ref = run((switchType_t)type, opt, false, readsRef);
+      dl = run((switchType_t)type, opt, true, readsDl);
+      if (dl != ref) errors++;
+      printf("\n %-8s %4lu events, at deadlines %s with %5lu of %lu reads",
+        typeName[type], (unsigned long)ref.size(), (dl == ref) ? "same" : "DIFFERENT",
+        (unsigned long)readsDl, (unsigned long)readsRef);
+    }
+  }
+
+  return(errors);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Deadline Check]");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  hostSetPinModel(pinModel);
+  errors += checkDeadline();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
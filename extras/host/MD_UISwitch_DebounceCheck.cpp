@@ -0,0 +1,273 @@
+/*
+MD_UISwitch timed debounce check.
+
+Presses a digital switch with contact bounce at each press and release, and
+reads it at several fixed rates with a debounce time set. The debounce time
+is the same whatever the read rate, so at every rate:
+- every press is accepted, and no more;
+- KEY_DOWN comes no sooner than the debounce time after the press;
+- the mean press delay is within one read period and the bounce time of
+  the mean at the fastest rate.
+The delays without a debounce time, one filter step per read, are printed
+for comparison.
+
+It then checks that a gap between reads longer than the 16 bit microsecond
+range (65.5ms) still counts the filter steps and ends an eager press lockout,
+and that a debounce time shorter than the filter steps is rounded up to the
+1us minimum step time rather than becoming one step per read.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <MD_UISwitch.h>
+
+const uint8_t  PIN = 5;
+const uint32_t CHECK_US = 30000000UL; // simulated time for each rate
+const uint32_t BOUNCE_US = 2000;      // contact bounce after each edge
+const uint16_t PERIOD_US[] = { 100, 300, 1000, 2500 };  // read periods, fastest first
+const uint16_t DB_MS[] = { 5, 20 };   // debounce times checked
+const MD_UISwitch::debounceTC_t DB_TC[] = { MD_UISwitch::DB_TC_QUARTER, MD_UISwitch::DB_TC_THIRTYSECOND };
+
+// --- Press pattern
+typedef struct
+{
+  uint32_t start, end;    // us
+} press_t;
+
+std::vector<press_t> pattern;
+uint32_t rnd = 7;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+void makePattern(uint32_t dbUs)
+// Presses and gaps of at least 3 debounce times, so every press is accepted
+{
+  uint32_t t = 10000;
+
+  pattern.clear();
+  while (t < CHECK_US - 10 * dbUs)
+  {
+    uint32_t len = 3 * dbUs + BOUNCE_US + random32() % (5 * dbUs);
+
+    pattern.push_back({ t, t + len });
+    t += len + 3 * dbUs + BOUNCE_US + random32() % (5 * dbUs);
+  }
+}
+
+uint8_t pinModel(uint8_t pin)
+// Active low contact, bouncing for BOUNCE_US after each edge
+{
+  uint32_t t = hostTime();
+
+  if (pin != PIN) return(HIGH);
+
+  for (size_t i = 0; i < pattern.size(); i++)
+  {
+    if (t < pattern[i].start) break;
+    if (t < pattern[i].start + BOUNCE_US || (t >= pattern[i].end && t < pattern[i].end + BOUNCE_US))
+      return(((t * 2654435761UL) >> 31) ? LOW : HIGH);  // bounce
+    if (t < pattern[i].end)
+      return(LOW);
+  }
+
+  return(HIGH);
+}
+
+// --- Read rate check
+typedef struct
+{
+  uint32_t presses;       // KEY_DOWN events
+  uint32_t delayMin;      // press to KEY_DOWN, us
+  uint32_t delayMax;
+  double   delayMean;
+} result_t;
+
+result_t runRate(uint16_t dbMs, MD_UISwitch::debounceTC_t tc, uint16_t period)
+// Read the switch every period us, timing each KEY_DOWN from the press
+{
+  MD_UISwitch_Digital sw(PIN, LOW);
+  result_t r = { 0, 0xffffffff, 0, 0 };
+  size_t next = 0;
+  double sum = 0;
+
+  hostSetTime(0);
+  sw.begin();
+  sw.enableDoublePress(false);
+  sw.enableLongPress(false);
+  sw.enableRepeat(false);
+  sw.setDebounceTime(dbMs, tc);
+
+  for (uint32_t t = 0; t < CHECK_US; t += period)
+  {
+    hostSetTime(t);
+    if (sw.read() != MD_UISwitch::KEY_DOWN) continue;
+
+    // the press this KEY_DOWN belongs to
+    while (next + 1 < pattern.size() && pattern[next + 1].start <= t)
+      next++;
+
+    uint32_t d = t - pattern[next].start;
+
+    r.presses++;
+    if (d < r.delayMin) r.delayMin = d;
+    if (d > r.delayMax) r.delayMax = d;
+    sum += d;
+    next++;
+  }
+  if (r.presses != 0) r.delayMean = sum / r.presses;
+
+  return(r);
+}
+
+uint32_t checkRates(void)
+{
+  uint32_t errors = 0;
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(DB_MS); i++)
+  {
+    for (uint8_t j = 0; j < ARRAY_SIZE(DB_TC); j++)
+    {
+      double ref = 0;
+
+      makePattern(DB_MS[i] * 1000UL);
+      printf("\n\nDebounce %ums, time constant %u, %u presses", DB_MS[i], DB_TC[j], (unsigned)pattern.size());
+      for (uint8_t k = 0; k < ARRAY_SIZE(PERIOD_US); k++)
+      {
+        result_t r = runRate(DB_MS[i], DB_TC[j], PERIOD_US[k]);
+        result_t u = runRate(0, DB_TC[j], PERIOD_US[k]);
+        bool ok;
+
+        if (k == 0) ref = r.delayMean;
+        ok = (r.presses == pattern.size()) && (r.delayMin + 100 >= DB_MS[i] * 1000UL) &&
+          (r.delayMean <= ref + PERIOD_US[k] + BOUNCE_US) && (r.delayMean + PERIOD_US[k] + BOUNCE_US >= ref);
+        if (!ok) errors++;
+        printf("\n read every %4uus: %4lu presses, delay %5.2fms (%5.2f to %5.2f) - per read filter: %4lu presses, delay %5.2fms  %s",
+          PERIOD_US[k], (unsigned long)r.presses, r.delayMean / 1000, r.delayMin / 1000.0, r.delayMax / 1000.0,
+          (unsigned long)u.presses, u.delayMean / 1000, ok ? "ok" : "FAIL");
+      }
+    }
+  }
+
+  return(errors);
+}
+
+// --- Long gap check
+uint32_t checkGaps(void)
+// Start the debounce with one read, then read again after a long gap
+{
+  const uint32_t GAP_US[] = { 30000, 65536, 70000, 131072, 1000000 };
+  uint32_t errors = 0;
+
+  pattern.clear();
+  pattern.push_back({ 1000, 0xffffffff });
+  printf("\n\nDebounce 10ms, key held, read after a gap of");
+  for (uint8_t i = 0; i < ARRAY_SIZE(GAP_US); i++)
+  {
+    MD_UISwitch_Digital sw(PIN, LOW);
+    MD_UISwitch::keyResult_t k;
+
+    hostSetTime(0);
+    sw.begin();
+    sw.setDebounceTime(10);
+    sw.read();
+    hostSetTime(5000);    // a new key, debounced from the next read
+    sw.read();
+    hostSetTime(6000);    // the edge, the filter steps are timed from here
+    sw.read();
+    hostSetTime(6000 + GAP_US[i]);
+    k = sw.read();
+    if (k != MD_UISwitch::KEY_DOWN) errors++;
+    printf(" %lums %s", (unsigned long)(GAP_US[i] / 1000), (k == MD_UISwitch::KEY_DOWN) ? "ok" : "FAIL");
+  }
+
+  return(errors);
+}
+
+uint32_t checkEagerGaps(void)
+// Accept an eager press, release the key and read again after a long gap.
+// The lockout is over, so the release takes the debounce time from there.
+{
+  const uint32_t GAP_US[] = { 30000, 70000, 131072 };
+  const uint32_t DB_US = 5000, MAX_US = DB_US + 2000;
+  uint32_t errors = 0;
+
+  pattern.clear();
+  pattern.push_back({ 1000, 20000 });
+  printf("\nEager press, 10ms lockout, 5ms debounce, key released, read after a gap of");
+  for (uint8_t i = 0; i < ARRAY_SIZE(GAP_US); i++)
+  {
+    MD_UISwitch_Digital sw(PIN, LOW);
+    uint32_t t0 = 6000 + GAP_US[i];
+    uint32_t t;
+    bool down;
+
+    hostSetTime(0);
+    sw.begin();
+    sw.setDebounceTime(DB_US / 1000);
+    sw.enableEagerPress(true, 10);
+    sw.read();
+    hostSetTime(5000);    // a new key, debounced from the next read
+    sw.read();
+    hostSetTime(6000);    // the edge, accepted at once
+    down = (sw.read() == MD_UISwitch::KEY_DOWN);
+    for (t = t0; t < t0 + 100000; t += 1000)
+    {
+      hostSetTime(t);
+      if (sw.read() == MD_UISwitch::KEY_UP) break;
+    }
+    if (!down || t - t0 > MAX_US) errors++;
+    printf(" %lums %s", (unsigned long)(GAP_US[i] / 1000), (down && t - t0 <= MAX_US) ? "ok" : "FAIL");
+  }
+
+  return(errors);
+}
+
+// --- Minimum step time check
+uint32_t checkMinTick(void)
+// A 10us debounce time needs the 1us minimum step, so the press is accepted
+// on the read after the edge (the third read, as a new key is only debounced
+// from the read after it is found) rather than after 74 steps of one per read
+{
+  MD_UISwitch_Digital sw(PIN, LOW);
+  uint32_t reads = 0;
+
+  pattern.clear();
+  pattern.push_back({ 1000, 0xffffffff });
+  hostSetTime(0);
+  sw.begin();
+  sw.setDebounceTimeUs(10);
+  for (uint32_t t = 5000; t < 200000; t += 1000)
+  {
+    hostSetTime(t);
+    reads++;
+    if (sw.read() == MD_UISwitch::KEY_DOWN) break;
+  }
+  printf("\n\nDebounce 10us, read every 1ms: press accepted on read %lu %s", (unsigned long)reads, (reads == 3) ? "ok" : "FAIL");
+
+  return(reads == 3 ? 0 : 1);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Debounce Check]");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  hostSetPinModel(pinModel);
+  errors += checkRates();
+  errors += checkGaps();
+  errors += checkEagerGaps();
+  errors += checkMinTick();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
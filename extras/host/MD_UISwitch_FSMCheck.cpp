@@ -0,0 +1,412 @@
+/*
+MD_UISwitch FSM equivalence check.
+
+Runs every sequence of switch inputs and time steps up to SEQ_STEPS long
+through the table driven MD_UISwitch::processFSM() (UI_FSM_TABLE) and through
+a copy of the default switch statement FSM (RefFSM below). The check covers
+every combination of options, using both the runtime profile and the fixed
+profiles of the template classes. After each step the event, the FSM state,
+the pushed event, the timer and the deadline() result must be the same.
+Both FSMs are then timed on a long random sequence.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and -DUI_FSM_TABLE=1,
+and run with no parameters. The exit code is 0 if every sequence matches.
+*/
+
+#include <chrono>
+#include <MD_UISwitch.h>
+
+#if !UI_FSM_TABLE
+#error "Build with -DUI_FSM_TABLE=1 to check the table driven FSM"
+#endif
+
+const uint8_t  SEQ_STEPS = 7;           // length of the input sequences checked
+const uint8_t  TIME_STEP[] = { 0, 1, 2, 7 };  // ms between steps, covering each timer limit
+const uint32_t TIME_START = 0xfffffff8; // starting time, so the sequences cross the millis() wrap
+const uint32_t BENCH_STEPS = 20000000;  // steps timed for each FSM
+
+// The FSM timers for the check, small so that the sequences reach them.
+// Each set has every limit within a few steps, the second with zero times.
+const uint16_t TIMES[][4] =
+{
+  // press, double press, long press, repeat
+  { 2, 3, 4, 2 },
+  { 0, 1, 1, 0 },
+};
+
+// Access to the FSM types and methods, and the reference FSM
+class RefFSM : public MD_UISwitch
+{
+public:
+  using MD_UISwitch::fsmState_t;
+  using MD_UISwitch::dbState_t;
+  using MD_UISwitch::processFSM;
+  using MD_UISwitch::deadline;
+  using MD_UISwitch::S_IDLE;
+  using MD_UISwitch::S_WAIT_START;
+
+  template <typename P>
+  static keyResult_t table(fsmState_t &fsm, const P &prof, bool b, uint32_t now, bool reset)
+    { return(processFSM(fsm, prof, b, now, reset)); };
+
+  // The switch statement FSM and its deadline(), from MD_UISwitch 2.3.0
+  struct Ref
+  {
+  template <typename P>
+  static keyResult_t processFSM(fsmState_t &fsm, const P &prof, bool b, uint32_t now, bool reset = false)
+  // Return one of the keypress types depending on what has been detected
+  // in the FSM logic
+  {
+    keyResult_t k = KEY_NULL;
+
+    if (reset)
+    {
+      fsm.state = S_IDLE;
+      fsm.kPush = KEY_NULL;
+      return(k);
+    }
+
+    // If we have previously pushed something return that status now
+    if (fsm.kPush != KEY_NULL)
+    {
+      k = fsm.kPush;
+      fsm.kPush = KEY_NULL;
+      return(k);
+    }
+
+    // Now run the FSM with the input
+    switch (fsm.state)
+    {
+    case S_IDLE:    // waiting for first transition
+      if (b)
+      {
+        fsm.state = S_PRESS;
+        fsm.timeActive = now;
+        k = KEY_DOWN;
+      }
+      break;
+
+    case S_PRESS:   // press?
+      // Key off before a long press registered, so it is either double press or a press.
+      if (!b)
+      {
+        k = KEY_UP;
+        if (bitRead(prof.enableFlags, DPRESS_ENABLE))  // DPRESS allowed
+        {
+          fsm.state = S_PRESS2A;
+          fsm.timeActive = now;
+        }
+        else      // this is just a press
+        {
+          fsm.kPush = KEY_PRESS;
+          fsm.state = S_IDLE;
+        }
+      }
+
+      // if the switch is still on and we have run out of press time ...
+      if (now - fsm.timeActive > prof.timePress)
+      {
+        fsm.timeActive = now;   // reset for repeat timer base
+        // ... we either have a long press or are 
+        // heading towards repeats if they are enabled
+        if (bitRead(prof.enableFlags, LONGPRESS_ENABLE)) 
+          fsm.state = S_PRESSL;
+        else if (bitRead(prof.enableFlags, REPEAT_ENABLE))
+        {
+          k = KEY_PRESS;
+          fsm.state = S_REPEAT;
+        }
+        else // nothing else that can be done as we have no time left!
+        {
+          k = KEY_PRESS;
+          fsm.state = S_WAIT;
+        }
+      }
+      break;
+
+    case S_PRESSL:  // long press or auto repeat?
+      // It is a long press if
+      // - Key off before a repeat press is registered, or
+      // - Auto repeat is disabled
+      // Set the return code and go back to waiting
+      if (!b)
+      {
+        fsm.kPush = KEY_LONGPRESS;
+        k = KEY_UP;
+        fsm.state = S_IDLE;
+        break;
+      }
+
+      if (now - fsm.timeActive > prof.timeLongPress)
+      {
+        if (bitRead(prof.enableFlags, REPEAT_ENABLE))
+        {
+          k = KEY_PRESS;      // the first of the repeats
+          fsm.state = S_REPEAT;  // handle the rest of them
+          fsm.timeActive = now;  // set the new baseline time.
+        }
+        else  // no repeats - register the long press and wait for release
+        {
+          k = KEY_LONGPRESS;
+          fsm.state = S_WAIT;
+        }
+      }
+      break;
+
+    case S_REPEAT: // repeat?
+      // Key off before another repeat press is registered, so we have finished.
+      // Go back to waiting
+      if (!b)
+      {
+        k = KEY_UP;
+        fsm.state = S_IDLE;
+      }
+      else    // if (b)
+      {
+        // if the switch is still on and we have not run out of repeat time, then
+        // just wait for the timer to expire.
+        if ((now - fsm.timeActive) < prof.timeRepeat)
+          break;
+
+        // we are now sure we have a repeat, set the return code and remain in this
+        // state checking for further repeats if enabled
+        k = bitRead(prof.enableFlags, REPEAT_RESULT_ENABLE) ? KEY_RPTPRESS : KEY_PRESS;
+        fsm.timeActive = now;	// next key repeat time starts now
+      }
+      break;
+
+    case S_PRESS2A:   // Wait for key to be pressed again in double press sequence
+      if (b)
+      {
+        k = KEY_DOWN;
+        fsm.state = S_PRESS2B;		// switch detected, initiate second
+        fsm.timeActive = now;
+      }
+
+      // Check if we didn't get a second press within time - 
+      // then this was just a press and wait for key release
+      if (now - fsm.timeActive  > prof.timeDoublePress)
+      {
+        k = KEY_PRESS;
+        fsm.state = (b) ? S_WAIT : S_IDLE;
+      }
+      break;
+
+    case S_PRESS2B:   // Wait for key to be released in double press sequence
+      if (!b)
+      {
+        k = KEY_UP;
+        fsm.kPush = KEY_DPRESS;
+        fsm.state = S_IDLE;
+      }
+
+      // we didn't get a second release within time then this was just a press
+      // and we wait for the key to be released
+      if (now - fsm.timeActive >= prof.timePress*2)
+      {
+        fsm.kPush = KEY_PRESS;
+        fsm.state = (b) ? S_WAIT : S_IDLE;
+      }
+      break;
+
+    case S_WAIT:
+    default:
+      // After completing while still key active, allow the user to release the switch
+      // to meet starting conditions for S_IDLE
+      if (!b)
+      {
+        k = KEY_UP;
+        fsm.state = S_IDLE;
+      }
+      break;
+    }
+
+    return(k);
+  }
+
+  template <typename P>
+  static uint32_t deadline(const fsmState_t &fsm, const dbState_t &db, const P &prof, uint32_t now)
+  // Work out when processFSM() will next change state with the switch
+  // input unchanged. Must be kept in step with the FSM timer checks.
+  {
+    uint32_t elapsed = now - fsm.timeActive;
+    uint32_t limit;
+    bool held = (fsm.state != S_IDLE && fsm.state != S_PRESS2A);
+
+    // Pushed events, debouncing and a release still working through the
+    // debounce (or the eager press release filter) need the next read straight
+    // away. Otherwise the next debounce() result is prevStatus, so the next read
+    // is also needed if this does not match what the FSM last saw.
+    if (fsm.kPush != KEY_NULL || db.RCstate == S_DEBOUNCE || db.RCstate == S_RELEASED || db.RC != 0 || db.prevStatus != held)
+      return(0);
+
+    switch (fsm.state)
+    {
+    case S_PRESS:   limit = (uint32_t)prof.timePress + 1;       break;
+    case S_PRESSL:  limit = (uint32_t)prof.timeLongPress + 1;   break;
+    case S_REPEAT:  limit = prof.timeRepeat;                    break;
+    case S_PRESS2A: limit = (uint32_t)prof.timeDoublePress + 1; break;
+    case S_PRESS2B: limit = (uint32_t)prof.timePress * 2;       break;
+
+    case S_IDLE:    // only an input change can move these on
+    case S_WAIT:
+    default:
+      return(DEADLINE_NONE);
+    }
+
+    return((elapsed >= limit) ? 0 : limit - elapsed);
+  }
+  };
+};
+
+typedef RefFSM::fsmState_t fsmState_t;
+typedef RefFSM::dbState_t dbState_t;
+
+uint32_t checked = 0, errors = 0;
+
+template <typename P>
+bool same(const fsmState_t &a, const fsmState_t &b, MD_UISwitch::keyResult_t ka, MD_UISwitch::keyResult_t kb,
+  const P &prof, bool in, uint32_t now)
+// Compare the results of a step, including the deadline at the next time
+{
+  dbState_t db;
+
+  if (ka != kb || a.state != b.state || a.kPush != b.kPush || a.timeActive != b.timeActive)
+    return(false);
+
+  db.RC = 0;
+  db.prevStatus = in;
+  db.RCstate = RefFSM::S_WAIT_START;
+  db.timeStep = 0;
+
+  return(RefFSM::deadline(a, db, prof, now) == RefFSM::Ref::deadline(b, db, prof, now));
+}
+
+template <typename P>
+void walk(fsmState_t a, fsmState_t b, const P &prof, uint32_t now, uint8_t depth, uint8_t *trace)
+// Step both FSMs with every input and time step from here, depth first
+{
+  if (depth == SEQ_STEPS) return;
+
+  for (uint8_t in = 0; in < 2; in++)
+  {
+    for (uint8_t t = 0; t < ARRAY_SIZE(TIME_STEP); t++)
+    {
+      fsmState_t na = a, nb = b;
+      uint32_t tn = now + TIME_STEP[t];
+      MD_UISwitch::keyResult_t ka = RefFSM::processFSM(na, prof, in, tn);
+      MD_UISwitch::keyResult_t kb = RefFSM::Ref::processFSM(nb, prof, in, tn);
+
+      trace[depth] = (in << 4) | TIME_STEP[t];
+      checked++;
+      if (!same(na, nb, ka, kb, prof, in, tn))
+      {
+        if (errors++ < 10)
+        {
+          printf("\nMismatch options 0x%x, step input/ms:", prof.enableFlags);
+          for (uint8_t i = 0; i <= depth; i++) printf(" %u/%u", trace[i] >> 4, trace[i] & 0xf);
+          printf(" -> table %u state %u push %u, reference %u state %u push %u",
+            ka, na.state, na.kPush, kb, nb.state, nb.kPush);
+        }
+        continue;   // no point going deeper
+      }
+      walk(na, nb, prof, tn, depth + 1, trace);
+    }
+  }
+}
+
+template <typename P>
+void check(P &prof, const uint16_t *times)
+{
+  fsmState_t a, b;
+  uint8_t trace[SEQ_STEPS];
+
+  prof.timePress = times[0];
+  prof.timeDoublePress = times[1];
+  prof.timeLongPress = times[2];
+  prof.timeRepeat = times[3];
+  RefFSM::processFSM(a, prof, false, TIME_START, true);
+  a.timeActive = TIME_START;
+  b = a;
+  walk(a, b, prof, TIME_START, 0, trace);
+}
+
+template <uint8_t F>
+void checkFixed(const uint16_t *times)
+// Check the fixed profiles for options F and below
+{
+  MD_UISwitch::uiFixedProfile_t<F> prof;
+
+  check(prof, times);
+  checkFixed<F - 1>(times);
+}
+
+template <>
+void checkFixed<0>(const uint16_t *times)
+{
+  MD_UISwitch::uiFixedProfile_t<0> prof;
+
+  check(prof, times);
+}
+
+template <typename P>
+double bench(bool table, const P &prof)
+// Time each FSM on the same random input, in ns per step. Both are called
+// through a pointer, as the library FSM is not inlined into the caller.
+{
+  typedef MD_UISwitch::keyResult_t (*fsm_t)(fsmState_t &, const P &, bool, uint32_t, bool);
+  fsm_t volatile fn = table ? &RefFSM::table<P> : &RefFSM::Ref::processFSM<P>;
+  fsmState_t fsm;
+  uint32_t rnd = 1, now = 0, sum = 0;
+  bool in = false;
+  auto start = std::chrono::steady_clock::now();
+
+  RefFSM::processFSM(fsm, prof, false, now, true);
+  for (uint32_t i = 0; i < BENCH_STEPS; i++)
+  {
+    rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;
+    if ((rnd & 0x3f) == 0) in = !in;
+    now += (rnd >> 8) & 0x7;
+    sum += fn(fsm, prof, in, now, false);
+  }
+
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  if (sum == 0) printf(" ");    // keep the result
+  return(d.count() * 1e9 / BENCH_STEPS);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch FSM Check]");
+}
+
+void loop(void)
+{
+  MD_UISwitch::uiProfile_t prof;
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(TIMES); i++)
+  {
+    for (uint8_t f = 0; f < 16; f++)
+    {
+      prof.enableFlags = f;
+      check(prof, TIMES[i]);
+    }
+    checkFixed<15>(TIMES[i]);
+  }
+  printf("\n%u steps checked in sequences of up to %u steps, %u mismatches", checked, SEQ_STEPS, errors);
+
+  prof.timePress = 150;
+  prof.timeDoublePress = 250;
+  prof.timeLongPress = 600;
+  prof.timeRepeat = 300;
+  prof.enableFlags = 0x07;
+  printf("\n\nRuntime profile: table %.1f ns/step, switch %.1f ns/step", bench(true, prof), bench(false, prof));
+  {
+    MD_UISwitch::uiFixedProfile_t<0x07> fp = { 150, 250, 600, 300 };
+
+    printf("\nFixed profile:   table %.1f ns/step, switch %.1f ns/step", bench(true, fp), bench(false, fp));
+  }
+
+  printf("\n\n%s\n", (errors == 0) ? "PASS" : "FAIL");
+  hostExit(errors == 0 ? 0 : 1);
+}
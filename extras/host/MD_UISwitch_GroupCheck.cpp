@@ -0,0 +1,383 @@
+/*
+MD_UISwitch_Group check.
+
+Reads a group of one switch of each kind (Digital, NKRO Matrix, Analog and
+Bank), driven by a scripted pattern of bouncing key presses, and checks that
+the group returns the same events at the same times as reading each switch
+on its own every millisecond:
+- when the group is read every millisecond;
+- when the group is only read when nextDeadline() is 0, with a long idle
+  scan time and wake() called for every input change, as a pin change
+  interrupt would.
+
+It then presses 4 digital switches as 4 others report their release, with
+an event buffer too small for all the events from one read, again reading
+only at the deadlines and after wake(). Every switch must give the same
+events as when read on its own, no more than MAX_DELAY later.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <MD_UISwitch.h>
+
+const uint32_t CHECK_MS = 60000;      // simulated time for each check
+const uint16_t IDLE_TIME = 60000;     // group idle scan time when reading at the deadlines
+const uint32_t MAX_DELAY = 50;        // ms an event may be delayed by a small event buffer
+
+// --- Mixed group inputs
+const uint8_t DIG_PIN = 5;
+uint8_t rowPin[] = { 20, 21 };
+uint8_t colPin[] = { 22, 23, 24 };
+char kt[] = "abcdef";
+MD_UISwitch_Analog::uiAnalogKeys_t akt[] =
+{
+  {  10, 10, 'R' },
+  { 130, 15, 'U' },
+  { 305, 15, 'D' },
+};
+const uint8_t BANK_KEYS = 4;
+
+// Each input follows the same press pattern, starting at a different time.
+// digital, matrix 'e', matrix 'c' and bank key 0, analog 'D', bank key 2
+const uint32_t INPUT_OFS[] = { 0, 137, 333, 501, 777 };
+
+// --- Burst check inputs
+const uint8_t BURST_PIN[] = { 30, 31, 32, 33, 34, 35, 36, 37 };
+const uint8_t BURST_EVENTS = 2;   // event buffer size
+
+// --- Press pattern
+typedef struct
+{
+  uint32_t start, end;    // ms
+} press_t;
+
+std::vector<press_t> pattern;
+uint32_t rnd = 9;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+void makePattern(uint32_t tapMax, uint32_t holdMax, uint32_t gapMax)
+// Random presses, mostly taps with some long holds
+{
+  uint32_t t = 50;
+
+  pattern.clear();
+  while (t < CHECK_MS - 1000)
+  {
+    uint32_t len = 20 + random32() % ((random32() % 3) ? tapMax : holdMax);
+
+    pattern.push_back({ t, t + len });
+    t += len + 20 + random32() % gapMax;
+  }
+}
+
+void makeBurstPattern(void)
+// Short and long presses and gaps, far enough from the FSM time limits that
+// a few ms delay does not change the events whether a switch follows the
+// presses or the gaps
+{
+  uint32_t t = 50;
+
+  pattern.clear();
+  while (t < CHECK_MS - 1000)
+  {
+    uint32_t len = (random32() & 1) ? 100 : 400;
+
+    pattern.push_back({ t, t + len });
+    t += len + ((random32() & 1) ? 500 : 800);
+  }
+}
+
+bool pressed(uint32_t t)
+{
+  for (size_t i = 0; i < pattern.size(); i++)
+    if (t >= pattern[i].start && t < pattern[i].end)
+      return(true);
+
+  return(false);
+}
+
+bool input(uint32_t t, uint8_t i)
+// The input with contact bounce around each change, the same for every run
+{
+  bool b = pressed(t + INPUT_OFS[i]);
+
+  if (t % 7 == 3 && pressed(t + INPUT_OFS[i] + 3) != b)
+    b = !b;
+
+  return(b);
+}
+
+// --- Simulated hardware
+bool matrixKey[ARRAY_SIZE(rowPin) * ARRAY_SIZE(colPin)];
+bool bankKey[BANK_KEYS];
+
+bool driven(uint8_t pin) { return(hostGetPinMode(pin) == OUTPUT && hostGetPin(pin) == LOW); }
+
+uint8_t pinModel(uint8_t pin)
+// Matrix keys connect their row and column, whichever is driven
+{
+  for (uint8_t r = 0; r < ARRAY_SIZE(rowPin); r++)
+    for (uint8_t c = 0; c < ARRAY_SIZE(colPin); c++)
+      if (matrixKey[(r * ARRAY_SIZE(colPin)) + c] &&
+        ((pin == rowPin[r] && driven(colPin[c])) || (pin == colPin[c] && driven(rowPin[r]))))
+        return(LOW);
+
+  for (uint8_t r = 0; r < ARRAY_SIZE(rowPin); r++)
+    if (pin == rowPin[r]) return(HIGH);
+  for (uint8_t c = 0; c < ARRAY_SIZE(colPin); c++)
+    if (pin == colPin[c]) return(HIGH);
+
+  return(hostGetPin(pin));
+}
+
+bool bankRead(uint8_t id) { return(bankKey[id]); }
+
+uint32_t setInputs(uint32_t t)
+// Set the inputs for time t (ms), returning them as a bit mask
+{
+  uint32_t m = 0;
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(INPUT_OFS); i++)
+    if (input(t, i)) m |= (1UL << i);
+
+  hostSetTime(t * 1000);
+  hostSetPin(DIG_PIN, (m & 0x01) ? LOW : HIGH);
+  matrixKey[4] = (m & 0x02);
+  matrixKey[2] = bankKey[0] = (m & 0x04);
+  hostSetAdc(A0, (m & 0x08) ? 300 : 1000);
+  bankKey[2] = (m & 0x10);
+
+  return(m);
+}
+
+// --- Event log
+typedef struct
+{
+  uint32_t time;
+  uint8_t  id;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+bool operator==(const event_t &a, const event_t &b)
+{
+  return(a.time == b.time && a.id == b.id && a.key == b.key && a.result == b.result);
+}
+
+// --- Mixed group check
+enum readMode_t { READ_EACH, READ_GROUP, READ_DEADLINE };
+
+std::vector<event_t> runMixed(readMode_t mode, uint32_t &reads)
+{
+  MD_UISwitch_Digital swD(DIG_PIN, LOW);
+  MD_UISwitch_Matrix swM(ARRAY_SIZE(rowPin), ARRAY_SIZE(colPin), rowPin, colPin, kt);
+  MD_UISwitch_Matrix::keySlot_t slot[3];
+  MD_UISwitch_Analog swA(A0, akt, ARRAY_SIZE(akt));
+  uint8_t rc[BANK_KEYS];
+  uint16_t state[BANK_KEYS], time[BANK_KEYS];
+  MD_UISwitch_Bank swB(BANK_KEYS, bankRead, rc, state, time);
+  MD_UISwitch *sw[] = { &swD, &swM, &swA, &swB };
+  MD_UISwitch_Group::groupState_t gs[ARRAY_SIZE(sw)];
+  MD_UISwitch_Group G(sw, gs, ARRAY_SIZE(sw));
+  std::vector<event_t> log;
+  uint32_t last = 0xffffffff;
+
+  reads = 0;
+  hostSetTime(0);
+  if (mode == READ_EACH)
+  {
+    for (uint8_t i = 0; i < ARRAY_SIZE(sw); i++)
+      sw[i]->begin();
+  }
+  else
+    G.begin();
+  swM.enableNKRO(slot, ARRAY_SIZE(slot));
+  if (mode == READ_DEADLINE) G.setIdleTime(IDLE_TIME);
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    uint32_t m = setInputs(t);
+
+    if (mode == READ_EACH)
+    {
+      for (uint8_t i = 0; i < ARRAY_SIZE(sw); i++)
+      {
+        MD_UISwitch::keyEvent_t ev[MD_UISwitch_Group::EVENT_MAX];
+        uint8_t n = sw[i]->read(ev, ARRAY_SIZE(ev), t);
+
+        for (uint8_t j = 0; j < n; j++)
+          log.push_back({ t, i, ev[j].key, ev[j].result });
+      }
+    }
+    else
+    {
+      MD_UISwitch_Group::groupEvent_t ev[16];
+      uint8_t n;
+
+      if (mode == READ_DEADLINE)
+      {
+        if (m != last) G.wake();
+        last = m;
+        if (G.nextDeadline(t) != 0) continue;
+      }
+      n = G.read(ev, ARRAY_SIZE(ev), t);
+      for (uint8_t j = 0; j < n; j++)
+        log.push_back({ t, ev[j].id, ev[j].key, ev[j].result });
+    }
+    reads++;
+  }
+
+  return(log);
+}
+
+uint32_t checkMixed(void)
+{
+  std::vector<event_t> ref, grp, dl;
+  uint32_t readsRef, readsGrp, readsDl;
+  uint32_t errors = 0;
+
+  makePattern(300, 2500, 400);
+  ref = runMixed(READ_EACH, readsRef);
+  grp = runMixed(READ_GROUP, readsGrp);
+  dl = runMixed(READ_DEADLINE, readsDl);
+
+  if (grp != ref) errors++;
+  if (dl != ref) errors++;
+  printf("\nMixed group: %lu events, group every ms %s, at deadlines %s with %lu of %lu reads",
+    (unsigned long)ref.size(), (grp == ref) ? "same" : "DIFFERENT", (dl == ref) ? "same" : "DIFFERENT",
+    (unsigned long)readsDl, (unsigned long)readsRef);
+
+  return(errors);
+}
+
+// --- Burst check
+uint8_t burstModel(uint8_t pin)
+// The second half of the switches are pressed 2ms after the others are
+// released, as the events from the release fill the event buffer
+{
+  uint32_t t = hostTime() / 1000;
+
+  for (uint8_t i = 0; i < ARRAY_SIZE(BURST_PIN); i++)
+    if (pin == BURST_PIN[i])
+      return(((i < ARRAY_SIZE(BURST_PIN) / 2) ? pressed(t) : !pressed(t - 2)) ? LOW : HIGH);
+
+  return(HIGH);
+}
+
+uint32_t runBurst(readMode_t mode, std::vector<event_t> *log)
+// Read the switches on their own every ms or as a group at the deadlines,
+// logging the events for each switch. Return the reads.
+{
+  MD_UISwitch_Digital sw0(BURST_PIN[0], LOW), sw1(BURST_PIN[1], LOW), sw2(BURST_PIN[2], LOW), sw3(BURST_PIN[3], LOW);
+  MD_UISwitch_Digital sw4(BURST_PIN[4], LOW), sw5(BURST_PIN[5], LOW), sw6(BURST_PIN[6], LOW), sw7(BURST_PIN[7], LOW);
+  MD_UISwitch *sw[] = { &sw0, &sw1, &sw2, &sw3, &sw4, &sw5, &sw6, &sw7 };
+  MD_UISwitch_Group::groupState_t gs[ARRAY_SIZE(sw)];
+  MD_UISwitch_Group G(sw, gs, ARRAY_SIZE(sw));
+  uint32_t reads = 0;
+  uint32_t last = 0;
+
+  hostSetTime(0);
+  if (mode == READ_EACH)
+  {
+    for (uint8_t i = 0; i < ARRAY_SIZE(sw); i++)
+      sw[i]->begin();
+  }
+  else
+  {
+    G.begin();
+    G.setIdleTime(IDLE_TIME);
+  }
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    hostSetTime(t * 1000);
+    if (mode == READ_EACH)
+    {
+      for (uint8_t i = 0; i < ARRAY_SIZE(sw); i++)
+      {
+        MD_UISwitch::keyEvent_t ev[MD_UISwitch_Group::EVENT_MAX];
+        uint8_t n = sw[i]->read(ev, ARRAY_SIZE(ev), t);
+
+        for (uint8_t j = 0; j < n; j++)
+          log[i].push_back({ t, i, ev[j].key, ev[j].result });
+      }
+    }
+    else
+    {
+      MD_UISwitch_Group::groupEvent_t ev[BURST_EVENTS];
+      uint32_t m = 0;
+      uint8_t n;
+
+      // wake the group on any input change
+      for (uint8_t i = 0; i < ARRAY_SIZE(BURST_PIN); i++)
+        if (burstModel(BURST_PIN[i]) == LOW) m |= (1 << i);
+      if (m != last) G.wake();
+      last = m;
+
+      if (G.nextDeadline(t) != 0) continue;
+      n = G.read(ev, ARRAY_SIZE(ev), t);
+      for (uint8_t j = 0; j < n; j++)
+        log[ev[j].id].push_back({ t, ev[j].id, ev[j].key, ev[j].result });
+    }
+    reads++;
+  }
+
+  return(reads);
+}
+
+uint32_t checkBurst(void)
+{
+  std::vector<event_t> ref[ARRAY_SIZE(BURST_PIN)], grp[ARRAY_SIZE(BURST_PIN)];
+  uint32_t errors = 0, events = 0, delay = 0, reads;
+
+  makeBurstPattern();
+  hostSetPinModel(burstModel);
+  runBurst(READ_EACH, ref);
+  reads = runBurst(READ_DEADLINE, grp);
+  hostSetPinModel(nullptr);
+
+  // the same events for every switch, a little later
+  for (uint8_t i = 0; i < ARRAY_SIZE(BURST_PIN); i++)
+  {
+    if (grp[i].size() != ref[i].size()) errors++;
+    for (size_t j = 0; j < ref[i].size() && j < grp[i].size(); j++)
+    {
+      uint32_t d = grp[i][j].time - ref[i][j].time;
+
+      if (grp[i][j].result != ref[i][j].result || grp[i][j].time < ref[i][j].time || d > MAX_DELAY)
+        errors++;
+      else if (d > delay)
+        delay = d;
+    }
+    events += ref[i].size();
+  }
+  printf("\nBurst of %u switches, %u event buffer: %lu events, %lu reads, delay up to %lums, errors %lu",
+    (unsigned)ARRAY_SIZE(BURST_PIN), BURST_EVENTS, (unsigned long)events, (unsigned long)reads,
+    (unsigned long)delay, (unsigned long)errors);
+
+  return(errors);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Group Check]\n");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  hostSetPinModel(pinModel);
+  errors += checkMixed();
+  errors += checkBurst();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,236 @@
+/*
+MD_UISwitch host (Linux) hardware abstraction layer implementation.
+
+See MD_UISwitch_HostHAL.h for information.
+*/
+
+#include <time.h>
+#include "MD_UISwitch_HostHAL.h"
+
+HostSerial Serial;
+
+// Simulated hardware state
+static uint32_t hostTimeUs = 0;               // the simulated clock
+static uint8_t  hostPin[HOST_PIN_COUNT];      // input level or last level written
+static uint8_t  hostMode[HOST_PIN_COUNT];     // last pin mode set
+static uint16_t hostAdc[HOST_PIN_COUNT];      // ADC value for analog pins
+static hostPinModel_t hostPinModel = nullptr; // scripted pin model
+static hostAdcModel_t hostAdcModel = nullptr; // scripted ADC model
+static uint32_t hostIO = 0;                   // I/O access counter
+static uint32_t hostPulse[HOST_PIN_COUNT];    // LOW to HIGH output transitions
+static void (*hostIsr[HOST_PIN_COUNT])(void); // pin change interrupt handlers
+static int hostIsrMode[HOST_PIN_COUNT];       // pin change interrupt modes
+static uint32_t hostAdcUs = 0;                // ADC conversion time
+static uint32_t hostAdcStartUs = 0;           // simulated time the split phase conversion started
+static uint16_t hostAdcValue = 0;             // split phase conversion result
+static uint32_t hostMicrosUs = 0;             // longest simulated time taken by a micros() call
+static uint32_t hostMicrosCalls = 0;          // micros() calls, to vary the time taken
+
+// --- Clock control
+void     hostSetTime(uint32_t us) { hostTimeUs = us; }
+void     hostAdvance(uint32_t us) { hostTimeUs += us; }
+uint32_t hostTime(void) { return(hostTimeUs); }
+void     hostSetMicrosTime(uint32_t us) { hostMicrosUs = us; }
+
+uint32_t hostNanos(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return((uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec));
+}
+
+// --- Pin and ADC control
+void hostSetPin(uint8_t pin, uint8_t level)
+{
+  if (pin >= HOST_PIN_COUNT) return;
+
+  uint8_t old = hostPin[pin];
+
+  hostPin[pin] = level;
+  if (hostIsr[pin] != nullptr && old != level &&
+      (hostIsrMode[pin] == CHANGE || (hostIsrMode[pin] == RISING) == (level != LOW)))
+    hostIsr[pin]();
+}
+
+uint8_t  hostGetPin(uint8_t pin) { return(pin < HOST_PIN_COUNT ? hostPin[pin] : LOW); }
+uint8_t  hostGetPinMode(uint8_t pin) { return(pin < HOST_PIN_COUNT ? hostMode[pin] : INPUT); }
+void     hostSetAdc(uint8_t pin, uint16_t value) { if (pin < HOST_PIN_COUNT) hostAdc[pin] = value; }
+void     hostSetAdcTime(uint32_t us) { hostAdcUs = us; }
+void     hostSetPinModel(hostPinModel_t model) { hostPinModel = model; }
+void     hostSetAdcModel(hostAdcModel_t model) { hostAdcModel = model; }
+uint32_t hostIoCount(void) { return(hostIO); }
+uint32_t hostPulseCount(uint8_t pin) { return(pin < HOST_PIN_COUNT ? hostPulse[pin] : 0); }
+void     hostExit(int code) { fflush(stdout); exit(code); }
+
+// --- Arduino core functions
+uint32_t millis(void) { return(hostTimeUs / 1000); }
+uint32_t micros(void)
+// Each call takes from 1 to hostMicrosUs, as if delayed by interrupts
+{
+  uint32_t t = hostTimeUs;
+
+  if (hostMicrosUs != 0)
+    hostTimeUs += 1 + (hostMicrosCalls++ * 7) % hostMicrosUs;
+
+  return(t);
+}
+void     delay(uint32_t ms) { hostTimeUs += ms * 1000; }
+void     delayMicroseconds(uint16_t us) { hostTimeUs += us; }
+
+volatile uint8_t hostPortReg[HOST_PIN_COUNT / 8];
+volatile uint8_t hostPortModeReg[HOST_PIN_COUNT / 8];
+volatile uint8_t hostPortOutReg[HOST_PIN_COUNT / 8];
+
+static void portBit(volatile uint8_t *reg, uint8_t pin, bool set)
+// Keep a bit in the emulated mode or output registers in step with the pin
+{
+  uint8_t m = (1 << (pin % 8));
+
+  if (set) reg[pin / 8] |= m;
+  else reg[pin / 8] &= ~m;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin >= HOST_PIN_COUNT) return;
+
+  hostIO++;
+  hostMode[pin] = mode;
+  if (mode == INPUT_PULLUP) hostPin[pin] = HIGH;   // pulled up until driven otherwise
+  portBit(hostPortModeReg, pin, mode == OUTPUT);
+  if (mode != OUTPUT) portBit(hostPortOutReg, pin, mode == INPUT_PULLUP);
+}
+
+static uint8_t pinLevel(uint8_t pin)
+{
+  if (hostPinModel != nullptr) return(hostPinModel(pin));
+  return(hostGetPin(pin));
+}
+
+int digitalRead(uint8_t pin)
+{
+  hostIO++;
+  return(pinLevel(pin));
+}
+
+uint8_t hostPortRead(const volatile uint8_t *reg)
+{
+  uint8_t port = reg - hostPortReg;
+  uint8_t v = 0;
+
+  hostIO++;
+  for (uint8_t i = 0; i < 8; i++)
+    if (pinLevel((port * 8) + i) != LOW) v |= (1 << i);
+  hostPortReg[port] = v;
+
+  return(v);
+}
+
+static void writeLevel(uint8_t pin, uint8_t level)
+{
+  if (pin < HOST_PIN_COUNT && hostPin[pin] == LOW && level != LOW) hostPulse[pin]++;
+  hostSetPin(pin, level);
+}
+
+void digitalWrite(uint8_t pin, uint8_t level)
+{
+  hostIO++;
+  if (pin < HOST_PIN_COUNT) portBit(hostPortOutReg, pin, level != LOW);
+  writeLevel(pin, level);
+}
+
+static void portWrite(volatile uint8_t *reg, uint8_t v)
+// Write an emulated mode or output register and apply the bits that change
+{
+  bool isMode = (reg >= hostPortModeReg && reg < hostPortModeReg + (HOST_PIN_COUNT / 8));
+  uint8_t port = isMode ? reg - hostPortModeReg : reg - hostPortOutReg;
+  uint8_t changed = *reg ^ v;
+
+  hostIO++;
+  *reg = v;
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    uint8_t pin = (port * 8) + i;
+    uint8_t m = (1 << i);
+
+    if ((changed & m) == 0) continue;
+    if (isMode)
+      hostMode[pin] = (v & m) ? OUTPUT : ((hostPortOutReg[port] & m) ? INPUT_PULLUP : INPUT);
+    else
+      writeLevel(pin, (v & m) ? HIGH : LOW);
+  }
+}
+
+void hostPortSet(volatile uint8_t *reg, uint8_t m) { portWrite(reg, *reg | m); }
+void hostPortClear(volatile uint8_t *reg, uint8_t m) { portWrite(reg, *reg & ~m); }
+
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode)
+{
+  if (irq >= HOST_PIN_COUNT) return;
+
+  hostIsr[irq] = isr;
+  hostIsrMode[irq] = mode;
+}
+
+void detachInterrupt(uint8_t irq)
+{
+  if (irq < HOST_PIN_COUNT) hostIsr[irq] = nullptr;
+}
+
+static uint16_t hostAdcSample(uint8_t pin)
+{
+  hostIO++;
+  if (hostAdcModel != nullptr) return(hostAdcModel(pin));
+  return(pin < HOST_PIN_COUNT ? hostAdc[pin] : 0);
+}
+
+int analogRead(uint8_t pin)
+{
+  uint16_t v = hostAdcSample(pin);
+
+  // wait for the conversion in both simulated and real time
+  if (hostAdcUs != 0)
+  {
+    uint32_t t0 = hostNanos();
+
+    hostTimeUs += hostAdcUs;
+    while (hostNanos() - t0 < hostAdcUs * 1000)
+      ;
+  }
+
+  return(v);
+}
+
+// --- Split phase ADC conversion
+// The input is sampled when the conversion starts and the result is ready
+// once the conversion time has passed on the simulated clock.
+void hostAdcStart(uint8_t pin)
+{
+  hostAdcValue = hostAdcSample(pin);
+  hostAdcStartUs = hostTimeUs;
+}
+
+bool     hostAdcReady(void) { return(hostTimeUs - hostAdcStartUs >= hostAdcUs); }
+uint16_t hostAdcResult(void) { return(hostAdcValue); }
+
+void hostAdcWait(void)
+{
+  if (!hostAdcReady())
+    hostTimeUs = hostAdcStartUs + hostAdcUs;
+}
+
+// --- Sketch runner
+int main(int argc, char *argv[])
+// Run setup() then loop() until hostExit() is called or for the
+// number of iterations given as the first command line parameter.
+{
+  uint32_t count = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 0;
+
+  setup();
+  for (uint32_t i = 0; count == 0 || i < count; i++)
+    loop();
+  fflush(stdout);
+
+  return(0);
+}
@@ -0,0 +1,249 @@
+#pragma once
+/*
+MD_UISwitch host (Linux) hardware abstraction layer.
+
+Replaces the Arduino core so that the library, and sketches using it, can be
+compiled and run off-target. Time is a simulated clock that only advances when
+the application tells it to, and digital pins and analog inputs are either
+set directly or supplied by a scripted model callback.
+
+The Makefile in this folder builds the examples and the host checks below,
+and 'make check' runs the checks. To compile the library and a sketch with
+this HAL directly use, for example:
+
+  g++ -O2 -DUISWITCH_HAL_HEADER='"MD_UISwitch_HostHAL.h"' -Iextras/host -Isrc \
+      -x c++ examples/MD_UISwitch_Example/MD_UISwitch_Example.ino -x none \
+      src/MD_UISwitch.cpp extras/host/MD_UISwitch_HostHAL.cpp -o example
+
+The host main() calls setup() once and then loop() until hostExit() is
+called or the loop count given on the command line is reached.
+
+MD_UISwitch_QueueStress.cpp in this folder is a host only sketch that runs
+the MD_UISwitch_Queue producer and consumer on separate threads. Build it
+as above, with -pthread, in place of the example sketch.
+
+MD_UISwitch_Replay.h replays the input recorded by MD_UISwitch_Recorder
+through the library's debounce and FSM. MD_UISwitch_ReplayCheck.cpp uses it
+to check that a replay reproduces the recorded events, or to replay a
+recording read from stdin. Build it as above with -DUI_RECORD=1.
+
+MD_UISwitch_FSMCheck.cpp checks the table driven FSM against a copy of the
+default switch statement FSM for every input sequence up to a set length,
+with all the option flags, and times the two. Build it as above with
+-DUI_FSM_TABLE=1.
+
+MD_UISwitch_GroupCheck.cpp checks that MD_UISwitch_Group gives the same events
+as reading each switch on its own, both read every millisecond and only at
+the deadlines, and that no switch is missed when the event buffer fills.
+
+MD_UISwitch_DebounceCheck.cpp checks that a debounce time set with
+setDebounceTime() accepts a bouncing key press after the same time whatever
+the read() rate, including long gaps between reads, the eager press lockout
+and the minimum step time.
+
+MD_UISwitch_PortCheck.cpp checks that Digital switches and Matrix scans
+read through the port registers give the same events as when read pin by pin.
+
+MD_UISwitch_MatrixCheck.cpp checks that an NKRO matrix gives the same events
+as a switch for each key when keys are held together, and that three keys
+at the corners of a rectangle are reported as ghosting.
+
+MD_UISwitch_BankCheck.cpp checks that MD_UISwitch_Bank gives the same events
+as a switch for each key, with the keys using different profiles, and that
+MD_UISwitch_VDebounce and a bank with a word callback give the same results
+as debouncing each key separately.
+
+MD_UISwitch_DeadlineCheck.cpp checks that each kind of switch gives the same
+events when it is only read at its nextDeadline() or an input change as when
+it is read every millisecond.
+
+MD_UISwitch_AnalogCheck.cpp checks that the MD_UISwitch_Analog lookup tables
+find the same key as the sequential search for every analog value, and
+that the median filter and settle count hide slides and spikes in the value.
+
+MD_UISwitch_ScanCheck.cpp checks that the idle probe of MD_UISwitch_Matrix
+and MD_UISwitch_4017KM gives the same events as scanning every key, and that
+so do scans spread over several read() calls with setScanSlice().
+*/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Arduino types, constants and macros used by the library and examples
+typedef bool    boolean;
+typedef uint8_t byte;
+
+#define LOW   0
+#define HIGH  1
+
+#define INPUT         0
+#define OUTPUT        1
+#define INPUT_PULLUP  2
+
+#define CHANGE  1
+#define FALLING 2
+#define RISING  3
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define A0 14
+#define A1 15
+#define A2 16
+#define A3 17
+#define A4 18
+#define A5 19
+#define A6 20
+#define A7 21
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+#define PROGMEM
+#define F(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+
+// --- Simulated hardware
+const uint8_t HOST_PIN_COUNT = 64;  ///< number of simulated digital pins
+
+/**
+* Scripted pin model prototype.
+*
+* If set, the model is called for every digitalRead() and returns the level
+* of the pin. The current simulated time and the output levels/modes written
+* by the library are available to the model through the host functions.
+*/
+typedef uint8_t (*hostPinModel_t)(uint8_t pin);
+
+/**
+* Scripted ADC model prototype.
+*
+* If set, the model is called for every analogRead() or conversion start
+* and returns the ADC value (0-1023) for the pin.
+*/
+typedef uint16_t (*hostAdcModel_t)(uint8_t pin);
+
+// Clock control
+void     hostSetTime(uint32_t us);      ///< set the simulated time in microseconds
+void     hostAdvance(uint32_t us);      ///< advance the simulated time by us microseconds
+uint32_t hostTime(void);                ///< current simulated time in microseconds
+void     hostSetMicrosTime(uint32_t us);///< each micros() call takes 1 to us simulated microseconds, default 0
+uint32_t hostNanos(void);               ///< real (not simulated) time in nanoseconds, for benchmarks
+
+// Pin and ADC control
+void     hostSetPin(uint8_t pin, uint8_t level);     ///< set the input level of a pin
+uint8_t  hostGetPin(uint8_t pin);                    ///< last level set or written for a pin
+uint8_t  hostGetPinMode(uint8_t pin);                ///< last mode set for a pin
+void     hostSetAdc(uint8_t pin, uint16_t value);    ///< set the ADC value for an analog pin
+void     hostSetPinModel(hostPinModel_t model);      ///< set the pin model, nullptr for none
+void     hostSetAdcModel(hostAdcModel_t model);      ///< set the ADC model, nullptr for none
+void     hostSetAdcTime(uint32_t us);                ///< set the ADC conversion time, default 0
+uint32_t hostIoCount(void);                          ///< number of pin/ADC accesses since start
+uint32_t hostPulseCount(uint8_t pin);                ///< number of LOW to HIGH writes to a pin
+void     hostExit(int code);                         ///< end the host program
+
+// Pin change interrupts are called when hostSetPin() changes the level of a pin,
+// not for pins supplied by the pin model.
+#define digitalPinToInterrupt(p) (p)
+
+// Emulated port registers - 8 consecutive pins per port. Reading a port
+// register counts as one I/O access and uses the pin model for each bit.
+// The mode and output registers follow the AVR DDR and PORT registers. Each
+// write counts as one I/O access and updates the pin mode and level of the 
+// bits changed, as pinMode() and digitalWrite() would.
+extern volatile uint8_t hostPortReg[HOST_PIN_COUNT / 8];
+extern volatile uint8_t hostPortModeReg[HOST_PIN_COUNT / 8];
+extern volatile uint8_t hostPortOutReg[HOST_PIN_COUNT / 8];
+uint8_t hostPortRead(const volatile uint8_t *reg);        ///< read an emulated port input register
+void    hostPortSet(volatile uint8_t *reg, uint8_t m);    ///< set bits in an emulated mode or output register
+void    hostPortClear(volatile uint8_t *reg, uint8_t m);  ///< clear bits in an emulated mode or output register
+
+#define digitalPinToPort(p) ((p) / 8)
+#define digitalPinToBitMask(p) ((uint8_t)(1 << ((p) % 8)))
+#define portInputRegister(port) (&hostPortReg[(port)])
+#define portModeRegister(port) (&hostPortModeReg[(port)])
+#define portOutputRegister(port) (&hostPortOutReg[(port)])
+#define UI_PORT_TYPE uint8_t
+#define UI_PORT_READ(r) hostPortRead(r)
+#ifndef UI_PORT_DRIVE
+#define UI_PORT_DRIVE 1
+#endif
+#define UI_PORT_SET(r, m) hostPortSet((r), (m))
+#define UI_PORT_CLEAR(r, m) hostPortClear((r), (m))
+
+// Split phase ADC conversion. analogRead() waits for the conversion time set by
+// hostSetAdcTime() in both simulated and real time, so it shows in benchmarks.
+// The split phase conversion only uses the simulated clock, so waiting for it
+// moves the simulated clock on to the end of the conversion.
+void     hostAdcStart(uint8_t pin);   ///< sample the ADC input and start the conversion
+bool     hostAdcReady(void);          ///< true once the conversion time has passed
+void     hostAdcWait(void);           ///< advance the simulated time to the end of the conversion
+uint16_t hostAdcResult(void);         ///< the value sampled at the start of the conversion
+
+#define UI_ANALOG_START(p) hostAdcStart(p)
+#define UI_ANALOG_READY() hostAdcReady()
+#define UI_ANALOG_WAIT() hostAdcWait()
+#define UI_ANALOG_RESULT(p) hostAdcResult()
+
+// Host threads may run on different cores, so a full hardware barrier is needed
+#define UI_MEMORY_BARRIER() __sync_synchronize()
+
+// Arduino core functions
+uint32_t millis(void);
+uint32_t micros(void);
+void     delay(uint32_t ms);
+void     delayMicroseconds(uint16_t us);
+void     pinMode(uint8_t pin, uint8_t mode);
+int      digitalRead(uint8_t pin);
+void     digitalWrite(uint8_t pin, uint8_t level);
+int      analogRead(uint8_t pin);
+void     attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void     detachInterrupt(uint8_t irq);
+
+// --- Minimal Serial replacement writing to stdout
+class HostSerial
+{
+public:
+  void begin(uint32_t) {};
+  int  available(void) { return(0); };    // no input
+  int  read(void) { return(-1); };
+  void print(const char* s) { fputs(s, stdout); };
+  void print(char c) { fputc(c, stdout); };
+  void print(long v, uint8_t base = DEC) { if (base == DEC) printf("%ld", v); else printNumber((unsigned long)v, base); };
+  void print(unsigned long v, uint8_t base = DEC) { printNumber(v, base); };
+  void print(int v, uint8_t base = DEC) { print((long)v, base); };
+  void print(unsigned int v, uint8_t base = DEC) { print((unsigned long)v, base); };
+  void print(unsigned char v, uint8_t base = DEC) { print((unsigned long)v, base); };
+  void print(double v, uint8_t digits = 2) { printf("%.*f", digits, v); };
+  template <typename T> void println(T v) { print(v); print('\n'); };
+  void println(void) { print('\n'); };
+
+private:
+  void printNumber(unsigned long v, uint8_t base)
+  {
+    if (base == HEX) printf("%lX", v);
+    else if (base == BIN)
+    {
+      char s[65];
+      uint8_t i = sizeof(s) - 1;
+
+      s[i] = '\0';
+      do { s[--i] = '0' + (v & 1); v >>= 1; } while (v != 0);
+      fputs(&s[i], stdout);
+    }
+    else printf("%lu", v);
+  };
+};
+
+extern HostSerial Serial;
+
+// Sketch entry points
+void setup(void);
+void loop(void);
@@ -0,0 +1,331 @@
+/*
+MD_UISwitch_Matrix N-Key Rollover check.
+
+Presses the keys of a scripted 3x4 matrix, many held together, and checks
+that the NKRO read() gives the same events at the same times as a separate
+MD_UISwitch_User for each key. NKRO tracks each key from the read that first
+finds it pressed, so the reference starts a new switch object for each press.
+The presses never make the three corners of a rectangle, so the NKRO scan
+must never report ghosting. Each key is released for long enough that its
+slot is freed before it is pressed again.
+
+It then presses the three keys at the corners of a rectangle, so the fourth
+corner also reads as pressed, and checks that:
+- isGhosting() is true for as long as the three keys are held;
+- neither the third key nor the ghost key is accepted while ghosting;
+- the third key is accepted once one of the others is released;
+- the ghost key is reported if ghost detection is disabled, so the model
+  really does show it.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <MD_UISwitch.h>
+
+const uint32_t CHECK_MS = 60000;      // simulated time for the NKRO check
+const uint32_t RELEASE_MS = 100;      // minimum time a key is released, longer than freeing its slot
+const uint8_t  SLOTS = 6;             // NKRO key slots
+
+uint8_t rowPin[] = { 20, 21, 22 };
+uint8_t colPin[] = { 23, 24, 25, 26 };
+char kt[] = "abcdefghijkl";
+
+const uint8_t ROWS = ARRAY_SIZE(rowPin);
+const uint8_t COLS = ARRAY_SIZE(colPin);
+const uint8_t KEYS = ROWS * COLS;
+
+uint32_t rnd = 13;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+// --- Simulated matrix, no diodes
+bool key[KEYS];
+
+bool driven(uint8_t pin) { return(hostGetPinMode(pin) == OUTPUT && hostGetPin(pin) == LOW); }
+
+bool connected(uint8_t pin, uint8_t r, uint8_t c)
+{
+  return((pin == rowPin[r] && driven(colPin[c])) || (pin == colPin[c] && driven(rowPin[r])));
+}
+
+uint8_t pinModel(uint8_t pin)
+// Keys connect their row and column, whichever is driven. The key at the
+// fourth corner of a rectangle of pressed keys also connects its row and
+// column through the other three.
+{
+  for (uint8_t r = 0; r < ROWS; r++)
+    for (uint8_t c = 0; c < COLS; c++)
+    {
+      bool on = key[(r * COLS) + c];
+
+      for (uint8_t r2 = 0; r2 < ROWS && !on; r2++)
+        for (uint8_t c2 = 0; c2 < COLS && !on; c2++)
+          on = (r2 != r && c2 != c && key[(r * COLS) + c2] && key[(r2 * COLS) + c2] && key[(r2 * COLS) + c]);
+      if (on && connected(pin, r, c))
+        return(LOW);
+    }
+
+  return(HIGH);
+}
+
+bool userRead(uint8_t id) { return(key[id]); }
+
+bool rectangle(const bool *down)
+// Three of the keys down are the corners of a rectangle
+{
+  for (uint8_t i = 0; i < KEYS; i++)
+    for (uint8_t j = i + 1; j < KEYS; j++)
+    {
+      if (!down[i] || !down[j] || i / COLS != j / COLS) continue;  // two keys in one row
+      for (uint8_t k = 0; k < KEYS; k++)
+        if (down[k] && k / COLS != i / COLS && (k % COLS == i % COLS || k % COLS == j % COLS))
+          return(true);
+    }
+
+  return(false);
+}
+
+// --- Press script, a bit mask of the keys down for each ms
+std::vector<uint16_t> script;
+
+void makeScript(void)
+// Random presses, some held long enough to repeat, with up to SLOTS keys
+// pressed or just released at once
+{
+  uint32_t release[KEYS] = { 0 };   // when each key is, or was last, released
+
+  script.assign(CHECK_MS, 0);
+  for (uint32_t t = 50; t < CHECK_MS - 3000; t++)
+  {
+    bool down[KEYS];
+    uint8_t busy = 0;
+
+    for (uint8_t k = 0; k < KEYS; k++)
+    {
+      down[k] = (t < release[k]);
+      if (t < release[k] + RELEASE_MS) busy++;
+    }
+
+    if (random32() % 40 == 0 && busy < SLOTS)
+    {
+      uint8_t k = random32() % KEYS;
+
+      if (t >= release[k] + RELEASE_MS)
+      {
+        down[k] = true;
+        if (rectangle(down))
+          down[k] = false;
+        else
+          release[k] = t + 20 + random32() % ((random32() % 4) ? 300 : 1500);
+      }
+    }
+
+    for (uint8_t k = 0; k < KEYS; k++)
+      if (down[k]) script[t] |= (1 << k);
+  }
+}
+
+// --- Event log
+typedef struct
+{
+  uint32_t time;
+  char     key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+bool operator==(const event_t &a, const event_t &b)
+{
+  return(a.time == b.time && a.key == b.key && a.result == b.result);
+}
+
+bool operator<(const event_t &a, const event_t &b)
+{
+  return(a.time < b.time || (a.time == b.time && a.key < b.key));
+}
+
+void setOptions(MD_UISwitch &s)
+{
+  s.begin();
+  s.enableDoublePress(false);
+  s.enableLongPress(true);
+  s.enableRepeat(true);
+  s.enableRepeatResult(true);
+}
+
+// --- NKRO check
+std::vector<event_t> runNKRO(uint32_t &ghosts)
+{
+  MD_UISwitch_Matrix M(ROWS, COLS, rowPin, colPin, kt);
+  MD_UISwitch_Matrix::keySlot_t slot[SLOTS];
+  std::vector<event_t> log;
+
+  ghosts = 0;
+  hostSetTime(0);
+  setOptions(M);
+  M.enableNKRO(slot, SLOTS);
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2 * SLOTS];
+    uint8_t n;
+
+    for (uint8_t k = 0; k < KEYS; k++)
+      key[k] = (script[t] & (1 << k));
+    hostSetTime(t * 1000);
+    n = M.read(ev, ARRAY_SIZE(ev));
+    for (uint8_t i = 0; i < n; i++)
+      log.push_back({ t, (char)ev[i].key, ev[i].result });
+    if (M.isGhosting()) ghosts++;
+  }
+  std::stable_sort(log.begin(), log.end());
+
+  return(log);
+}
+
+std::vector<event_t> runReference(void)
+// One switch for each key, started again at each press. The switches are
+// copied, so use the id array constructor rather than the single id one.
+{
+  uint8_t id[KEYS];
+  std::vector<MD_UISwitch_User> sw;
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  for (uint8_t k = 0; k < KEYS; k++)
+  {
+    id[k] = k;
+    sw.push_back(MD_UISwitch_User(&id[k], 1, userRead));
+    setOptions(sw[k]);
+  }
+
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    hostSetTime(t * 1000);
+    for (uint8_t k = 0; k < KEYS; k++)
+    {
+      MD_UISwitch::keyEvent_t ev[2];
+      uint8_t n;
+
+      key[k] = (script[t] & (1 << k));
+      if (key[k] && t != 0 && !(script[t - 1] & (1 << k)))
+      {
+        sw[k] = MD_UISwitch_User(&id[k], 1, userRead);
+        setOptions(sw[k]);
+      }
+      n = sw[k].read(ev, ARRAY_SIZE(ev));
+      for (uint8_t i = 0; i < n; i++)
+        log.push_back({ t, kt[k], ev[i].result });
+    }
+  }
+
+  return(log);
+}
+
+uint32_t checkNKRO(void)
+{
+  std::vector<event_t> nkro, ref;
+  uint32_t ghosts, chords = 0;
+  uint32_t errors = 0;
+
+  makeScript();
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+    if (script[t] & (script[t] - 1)) chords++;
+  nkro = runNKRO(ghosts);
+  ref = runReference();
+
+  if (nkro != ref) errors++;
+  if (ghosts != 0) errors++;
+  printf("\nNKRO, %u slots: %lu events, %lums with keys held together, per key reference %s, ghosting %lums",
+    SLOTS, (unsigned long)ref.size(), (unsigned long)chords, (nkro == ref) ? "same" : "DIFFERENT", (unsigned long)ghosts);
+
+  return(errors);
+}
+
+// --- Ghost check
+uint32_t runGhost(bool detect)
+// Press a and b in the top row, then e below a, making a ghost at f.
+// Release b and then the others. Return the errors.
+{
+  const uint32_t T_AB = 50, T_E = 300, T_B = 800, T_END = 1500;
+  const uint32_t SLACK = 2;   // ms difference allowed in the KEY_DOWN delay
+  MD_UISwitch_Matrix M(ROWS, COLS, rowPin, colPin, kt);
+  MD_UISwitch_Matrix::keySlot_t slot[SLOTS];
+  uint32_t errors = 0, ghosts = 0;
+  uint32_t downA = 0, downE = 0, downF = 0;
+  uint32_t d;
+
+  hostSetTime(0);
+  setOptions(M);
+  M.enableNKRO(slot, SLOTS);
+  M.enableGhostDetect(detect);
+  for (uint32_t t = 0; t < T_END + 500; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2 * SLOTS];
+    uint8_t n;
+
+    memset(key, 0, sizeof(key));
+    key[0] = (t >= T_AB && t < T_END);    // a
+    key[1] = (t >= T_AB && t < T_B);      // b
+    key[4] = (t >= T_E && t < T_END);     // e
+    hostSetTime(t * 1000);
+    n = M.read(ev, ARRAY_SIZE(ev));
+    for (uint8_t i = 0; i < n; i++)
+    {
+      if (ev[i].key == 'a' && ev[i].result == MD_UISwitch::KEY_DOWN && downA == 0) downA = t;
+      if (ev[i].key == 'e' && ev[i].result == MD_UISwitch::KEY_DOWN && downE == 0) downE = t;
+      if (ev[i].key == 'f' && ev[i].result == MD_UISwitch::KEY_DOWN && downF == 0) downF = t;
+    }
+    if (M.isGhosting())
+    {
+      ghosts++;
+      if (t < T_E || t >= T_B + SLACK) errors++;   // only while the rectangle is held
+    }
+  }
+
+  // the other keys should see the same KEY_DOWN delay as a
+  d = downA - T_AB;
+  if (downA == 0) errors++;
+  if (detect)
+  {
+    if (ghosts < T_B - T_E) errors++;
+    if (downE < T_B + d || downE > T_B + d + SLACK) errors++;
+    if (downF != 0) errors++;
+    printf("\nGhost detection on:  ghosting %lums, e accepted at %lums (b released at %lums), f %s",
+      (unsigned long)ghosts, (unsigned long)downE, (unsigned long)T_B, (downF == 0) ? "not reported" : "REPORTED");
+  }
+  else
+  {
+    if (ghosts != 0) errors++;
+    if (downE < T_E + d || downE > T_E + d + SLACK) errors++;
+    if (downF < T_E + d || downF > T_E + d + SLACK) errors++;
+    printf("\nGhost detection off: e accepted at %lums, f reported at %lums (e pressed at %lums)",
+      (unsigned long)downE, (unsigned long)downF, (unsigned long)T_E);
+  }
+  printf(" %s", errors == 0 ? "ok" : "FAIL");
+
+  return(errors);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Matrix Check]\n");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  hostSetPinModel(pinModel);
+  errors += checkNKRO();
+  errors += runGhost(true);
+  errors += runGhost(false);
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
@@ -0,0 +1,253 @@
+/*
+MD_UISwitch port register check.
+
+Reads the same scripted switches through the hardware port registers and
+through the individual pin functions, and checks that both give the same
+events at the same times. The pin function path is the one the library
+falls back to when the port registers cannot be used:
+- MD_UISwitch_Digital with its pins on 2 ports is read by port, with one
+  extra (never pressed) pin on a third port it is read pin by pin.
+- MD_UISwitch_Matrix with 3 rows and 8 columns is scanned through the port
+  registers, with one extra (never pressed) column it is scanned pin by pin.
+  This is checked in single key and NKRO modes, driving the columns or rows.
+
+The I/O accesses for each read are printed for comparison. The Digital port
+path is checked to make one access for each port, and the Matrix port scan
+to make fewer accesses than the pin scan.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <MD_UISwitch.h>
+
+const uint32_t CHECK_MS = 60000;      // simulated time for each check
+
+// --- Digital switch inputs, the last pin is on a third port
+const uint8_t DIG_PIN[] = { 2, 3, 6, 9, 12, 21 };
+const uint8_t DIG_PORTS = 2;          // ports used by all but the last pin
+
+// --- Matrix inputs, the last column is past the port scan limit
+uint8_t rowPin[] = { 40, 41, 42 };
+uint8_t colPin[] = { 24, 25, 26, 27, 28, 29, 30, 31, 33 };
+const uint8_t ROWS = ARRAY_SIZE(rowPin);
+const uint8_t COLS = ARRAY_SIZE(colPin) - 1;   // columns pressed
+const uint8_t SLOTS = 4;              // NKRO key slots
+
+// --- Press pattern
+typedef struct
+{
+  uint32_t start, end;    // ms
+  uint8_t  key;           // key pressed
+  uint8_t  key2;          // a second key pressed at the same time, or the same key
+} press_t;
+
+std::vector<press_t> pattern;
+uint32_t rnd = 11;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+void makePattern(uint8_t keys)
+// Random presses of one key, some held long and some with a second key
+{
+  uint32_t t = 50;
+
+  pattern.clear();
+  while (t < CHECK_MS - 2000)
+  {
+    uint32_t len = 20 + random32() % ((random32() % 4) ? 300 : 1500);
+    uint8_t key = random32() % keys;
+    uint8_t key2 = (random32() % 8) ? key : random32() % keys;
+
+    pattern.push_back({ t, t + len, key, key2 });
+    t += len + 20 + random32() % 400;
+  }
+}
+
+bool pressed(uint32_t t, uint8_t key)
+// The key state with contact bounce around each change, the same for every run
+{
+  for (size_t i = 0; i < pattern.size(); i++)
+  {
+    if (t < pattern[i].start) break;
+    if (t >= pattern[i].end + 3 || (pattern[i].key != key && pattern[i].key2 != key)) continue;
+    if (t < pattern[i].start + 3 || t >= pattern[i].end)
+      return(((t * 2654435761UL) >> 31) != 0);   // bounce
+    return(true);
+  }
+
+  return(false);
+}
+
+// --- Event log
+typedef struct
+{
+  uint32_t time;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+bool operator==(const event_t &a, const event_t &b)
+{
+  return(a.time == b.time && a.key == b.key && a.result == b.result);
+}
+
+bool operator<(const event_t &a, const event_t &b)
+{
+  return(a.time < b.time || (a.time == b.time && a.key < b.key));
+}
+
+// --- Digital switch check
+uint8_t digitalModel(uint8_t pin)
+// Active low switches
+{
+  for (uint8_t i = 0; i < ARRAY_SIZE(DIG_PIN) - 1; i++)
+    if (pin == DIG_PIN[i])
+      return(pressed(hostTime() / 1000, i) ? LOW : HIGH);
+
+  return(HIGH);
+}
+
+std::vector<event_t> runDigital(uint8_t pinCount, uint32_t &io)
+// Read the first pinCount switches every ms, return the events and the I/O count
+{
+  MD_UISwitch_Digital sw(DIG_PIN, pinCount, LOW);
+  std::vector<event_t> log;
+
+  hostSetTime(0);
+  sw.begin();
+  sw.enableDoublePress(true);
+  io = hostIoCount();
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyResult_t k;
+
+    hostSetTime(t * 1000);
+    k = sw.read();
+    if (k != MD_UISwitch::KEY_NULL)
+      log.push_back({ t, sw.getKey(), k });
+  }
+  io = hostIoCount() - io;
+
+  return(log);
+}
+
+uint32_t checkDigital(void)
+{
+  std::vector<event_t> port, pin;
+  uint32_t ioPort, ioPin;
+  uint32_t errors = 0;
+
+  makePattern(ARRAY_SIZE(DIG_PIN) - 1);
+  hostSetPinModel(digitalModel);
+  port = runDigital(ARRAY_SIZE(DIG_PIN) - 1, ioPort);
+  pin = runDigital(ARRAY_SIZE(DIG_PIN), ioPin);
+  hostSetPinModel(nullptr);
+
+  if (port != pin) errors++;
+  if (ioPort != CHECK_MS * DIG_PORTS) errors++;
+  printf("\nDigital, %u switches: %lu events, port registers %s, I/O per read %.1f by port, %.1f by pin",
+    (unsigned)(ARRAY_SIZE(DIG_PIN) - 1), (unsigned long)pin.size(), (port == pin) ? "same" : "DIFFERENT",
+    (double)ioPort / CHECK_MS, (double)ioPin / CHECK_MS);
+
+  return(errors);
+}
+
+// --- Matrix check
+bool driven(uint8_t pin) { return(hostGetPinMode(pin) == OUTPUT && hostGetPin(pin) == LOW); }
+
+uint8_t matrixModel(uint8_t pin)
+// Keys connect their row and column, whichever is driven
+{
+  uint32_t t = hostTime() / 1000;
+
+  for (uint8_t r = 0; r < ROWS; r++)
+    for (uint8_t c = 0; c < COLS; c++)
+      if (((pin == rowPin[r] && driven(colPin[c])) || (pin == colPin[c] && driven(rowPin[r]))) &&
+        pressed(t, (r * COLS) + c))
+        return(LOW);
+
+  return(HIGH);
+}
+
+std::vector<event_t> runMatrix(uint8_t cols, bool nkro, bool driveRows, uint32_t &io)
+// Scan a matrix of the first cols columns every ms, return the events and
+// the I/O count. The keys have the same identifier whatever the columns.
+{
+  char kt[ARRAY_SIZE(rowPin) * ARRAY_SIZE(colPin) + 1] = { 0 };
+  MD_UISwitch_Matrix sw(ROWS, cols, rowPin, colPin, kt);
+  MD_UISwitch_Matrix::keySlot_t slot[SLOTS];
+  std::vector<event_t> log;
+
+  for (uint8_t r = 0; r < ROWS; r++)
+    for (uint8_t c = 0; c < cols; c++)
+      kt[(r * cols) + c] = 'A' + (r * ARRAY_SIZE(colPin)) + c;
+
+  hostSetTime(0);
+  sw.setDriveRows(driveRows);
+  sw.begin();
+  if (nkro) sw.enableNKRO(slot, SLOTS);
+  io = hostIoCount();
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    MD_UISwitch::keyEvent_t ev[2 * SLOTS];
+    uint8_t n;
+
+    hostSetTime(t * 1000);
+    n = sw.read(ev, ARRAY_SIZE(ev), t);
+    for (uint8_t i = 0; i < n; i++)
+      log.push_back({ t, ev[i].key, ev[i].result });
+  }
+  io = hostIoCount() - io;
+  std::stable_sort(log.begin(), log.end());
+
+  return(log);
+}
+
+uint32_t checkMatrix(void)
+{
+  uint32_t errors = 0;
+
+  makePattern(ROWS * COLS);
+  hostSetPinModel(matrixModel);
+  for (uint8_t mode = 0; mode < 4; mode++)
+  {
+    bool nkro = (mode & 1), driveRows = (mode & 2);
+    std::vector<event_t> port, pin;
+    uint32_t ioPort, ioPin;
+    bool ok;
+
+    port = runMatrix(COLS, nkro, driveRows, ioPort);
+    pin = runMatrix(COLS + 1, nkro, driveRows, ioPin);
+    ok = (port == pin && ioPort < ioPin);
+    if (!ok) errors++;
+    printf("\nMatrix %ux%u, %-12s %-6s drive: %4lu events, port registers %s, I/O per read %.1f by port, %.1f by pin",
+      ROWS, COLS, nkro ? "NKRO," : "single key,", driveRows ? "row" : "column", (unsigned long)pin.size(),
+      (port == pin) ? "same" : "DIFFERENT", (double)ioPort / CHECK_MS, (double)ioPin / CHECK_MS);
+  }
+  hostSetPinModel(nullptr);
+
+  return(errors);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Port Check]\n");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  errors += checkDigital();
+  errors += checkMatrix();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
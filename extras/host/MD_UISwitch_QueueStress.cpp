@@ -0,0 +1,134 @@
+/*
+MD_UISwitch_Queue host stress test.
+
+Runs the queue producer in a separate thread, standing in for a timer
+interrupt, and the consumer in loop(). Every event carries a sequence
+number, so the consumer can check that the events arrive in order, are
+not corrupted, and that every missing event is accounted for by the
+overflow count. The consumer periodically stalls to force overflows.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) adding -pthread, and
+run with no parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <atomic>
+#include <thread>
+#include <MD_UISwitch.h>
+
+const uint32_t EVENT_COUNT = 2000000;   // events produced in the test
+const uint8_t  QUEUE_SIZE = 32;
+
+MD_UISwitch_Queue::queueEvent_t qBuf[QUEUE_SIZE];
+MD_UISwitch_Queue Q(qBuf, QUEUE_SIZE);
+
+std::thread producer;
+std::atomic<bool> producerDone(false);
+uint32_t producerLost = 0;    // written by the producer, read after it ends
+
+uint32_t received = 0;        // events received
+uint32_t gaps = 0;            // events missing from the sequence
+uint32_t errors = 0;          // out of order or corrupt events
+uint32_t nextSeq = 0;         // next sequence number expected
+uint32_t batches = 0;
+
+MD_UISwitch::keyResult_t seqResult(uint32_t seq)
+{
+  return((MD_UISwitch::keyResult_t)(MD_UISwitch::KEY_DOWN + (seq % 6)));
+}
+
+void spin(uint32_t &rnd, uint8_t bits)
+// Busy wait for a pseudo random time to vary the relative thread speeds
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  for (volatile uint32_t i = rnd & ((1UL << bits) - 1); i != 0; i--)
+    ;
+}
+
+void produce(void)
+{
+  uint32_t rnd = 1;
+
+  for (uint32_t seq = 0; seq < EVENT_COUNT; seq++)
+  {
+    if (!Q.push((uint8_t)(seq * 7), seqResult(seq), seq))
+    {
+      producerLost++;
+      std::this_thread::yield();  // let the consumer run on a single core host
+    }
+    spin(rnd, 6);
+  }
+
+  producerDone = true;
+}
+
+void check(const MD_UISwitch_Queue::queueEvent_t &e)
+{
+  received++;
+  if (e.time < nextSeq || e.key != (uint8_t)(e.time * 7) || e.result != seqResult(e.time))
+  {
+    if (errors++ < 10)
+    {
+      Serial.print("\nBad event seq ");
+      Serial.print((unsigned long)e.time);
+      Serial.print(" expected ");
+      Serial.print((unsigned long)nextSeq);
+    }
+    return;
+  }
+  gaps += e.time - nextSeq;
+  nextSeq = e.time + 1;
+}
+
+void setup(void)
+{
+  Serial.begin(57600);
+  Serial.print("\n[MD_UISwitch_Queue Stress Test]");
+  Serial.print("\nEvents ");
+  Serial.print((unsigned long)EVENT_COUNT);
+  Serial.print(", queue size ");
+  Serial.print(QUEUE_SIZE);
+
+  producer = std::thread(produce);
+}
+
+void loop(void)
+{
+  static MD_UISwitch_Queue::queueEvent_t ev[QUEUE_SIZE / 2];
+  static uint32_t rnd = 2;
+  bool done = producerDone;   // read before draining so nothing is left behind
+  uint8_t n = Q.pop(ev, ARRAY_SIZE(ev));
+
+  if (n != 0) batches++;
+  else std::this_thread::yield();   // let the producer run on a single core host
+  for (uint8_t i = 0; i < n; i++)
+    check(ev[i]);
+
+  // stall now and again so the queue fills and overflows
+  spin(rnd, ((rnd & 0xff) == 0) ? 13 : 7);
+
+  if (done && Q.count() == 0)
+  {
+    bool pass;
+
+    producer.join();
+    gaps += EVENT_COUNT - nextSeq;
+    pass = errors == 0 && received + producerLost == EVENT_COUNT &&
+           gaps == producerLost && Q.getOverflow() == (uint16_t)producerLost;
+
+    Serial.print("\nReceived ");
+    Serial.print((unsigned long)received);
+    Serial.print(" in ");
+    Serial.print((unsigned long)batches);
+    Serial.print(" batches");
+    Serial.print("\nLost ");
+    Serial.print((unsigned long)producerLost);
+    Serial.print(", sequence gaps ");
+    Serial.print((unsigned long)gaps);
+    Serial.print(", overflow count ");
+    Serial.print(Q.getOverflow());
+    Serial.print("\nErrors ");
+    Serial.print((unsigned long)errors);
+    Serial.print(pass ? "\nPASS\n" : "\nFAIL\n");
+    hostExit(pass ? 0 : 1);
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+/*
+MD_UISwitch input replay for the host HAL.
+
+Replays samples recorded on the target by MD_UISwitch_Recorder through the
+library debounce and FSM. The samples hold everything the debounce and FSM
+use, so the events are the same, at the same read() times, as on the target
+when the replay is set up with the same timer, option and debounce settings
+as the recorded switch. The host clock is set from each sample to the time
+the timed debounce used (see setDebounceTime()), so the clock time taken 
+by each micros() call (hostSetMicrosTime()) must be 0 for the replay.
+
+The key value for the events (getKey()) is the scan index recorded, for
+example the position of the pin in the MD_UISwitch_Digital pin list.
+
+The library must be compiled with UI_RECORD set to 1 for the recorder, but
+the replay works with any setting.
+*/
+
+#include <MD_UISwitch.h>
+
+class MD_UISwitch_Replay : public MD_UISwitch_Static<MD_UISwitch_Replay>
+{
+public:
+  typedef MD_UISwitch_Recorder::sample_t sample_t;
+
+  // Event callback, called with the sample that produced the event
+  typedef void (*cbEvent)(const sample_t &s, uint8_t key, MD_UISwitch::keyResult_t k);
+
+  MD_UISwitch_Replay(void) : _key(MD_UISwitch_Recorder::KEY_NONE) {};
+
+  void begin(void) {};
+
+  // Replay one sample, returning the event for that read()
+  MD_UISwitch::keyResult_t replay(const sample_t &s)
+  {
+    hostSetTime((s.timeUs != 0) ? s.timeUs : s.time * 1000UL);
+    _key = s.key;
+
+    return(read(s.time));
+  };
+
+  // Replay count samples, calling cb for each event, and return the number of events
+  uint32_t replay(const sample_t *s, uint32_t count, cbEvent cb = nullptr)
+  {
+    uint32_t n = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      MD_UISwitch::keyResult_t k = replay(s[i]);
+
+      if (k != MD_UISwitch::KEY_NULL)
+      {
+        n++;
+        if (cb != nullptr) cb(s[i], getKey(), k);
+      }
+    }
+
+    return(n);
+  };
+
+  // Called by read() - the key in the sample being replayed
+  int16_t scan(int16_t &idx)
+  {
+    if (_key == MD_UISwitch_Recorder::KEY_NONE)
+      return(0);
+
+    idx = _key;
+    return(1);
+  };
+
+  // Called by read() - the key value is the scan index
+  uint8_t keyValue(int16_t idx) { return((uint8_t)idx); };
+
+protected:
+  uint8_t _key;   // key in the sample being replayed
+};
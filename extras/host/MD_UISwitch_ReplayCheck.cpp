@@ -0,0 +1,260 @@
+/*
+MD_UISwitch record and replay check.
+
+With no input, records two MD_UISwitch_Digital switches on the host driven
+by a random model of bouncing key presses, replays the recording through
+MD_UISwitch_Replay and checks that every event is the same, at the same
+time, as the recorded switch. This is done for the per read and the timed
+debounce, and with the clock moving on during each read as each pin read
+and micros() call takes time (varying for micros(), see hostSetMicrosTime()).
+The exit code is 0 if all checks pass.
+
+With a recording on stdin, in the form printed by the MD_UISwitch_Record
+example ("time timeUs key" per line, lines starting '#' ignored), prints the
+events from replaying it and then the replay speed. Change setupSwitch()
+to match the settings of the recorded switch.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) adding -DUI_RECORD=1,
+and run with no parameters, for example
+
+  ./replay < trace.txt
+*/
+
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+#include <MD_UISwitch.h>
+#include "MD_UISwitch_Replay.h"
+
+#if !UI_RECORD
+#error "Build with -DUI_RECORD=1"
+#endif
+
+typedef MD_UISwitch_Recorder::sample_t sample_t;
+
+const uint8_t  SW_PIN[] = { 2, 3 };
+const uint32_t CHECK_MS = 600000;       // simulated time for each check
+const uint16_t REC_SIZE = 1000;         // recorder size
+const uint16_t BENCH_RUNS = 20;         // replays timed for the speed
+
+template <class T>
+void setupSwitch(T &s, uint16_t dbTime)
+// The same settings for the recorded switch and the replay
+{
+  s.enableRepeatResult(true);
+  s.setDebounceTime(dbTime);
+}
+
+// --- Simulated bouncing key presses
+uint32_t rnd = 1;
+uint32_t readTime = 0;                    // simulated time taken by each pin read (us)
+uint32_t keyChange[ARRAY_SIZE(SW_PIN)];   // time of the last press or release (us)
+uint32_t keyNext[ARRAY_SIZE(SW_PIN)];     // time of the next press or release (us)
+bool     keyDown[ARRAY_SIZE(SW_PIN)];
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+uint8_t pinModel(uint8_t pin)
+// Active LOW keys that bounce for up to 3ms after each change
+{
+  for (uint8_t i = 0; i < ARRAY_SIZE(SW_PIN); i++)
+  {
+    if (pin == SW_PIN[i])
+    {
+      uint32_t d = hostTime() - keyChange[i];
+
+      hostAdvance(readTime);
+
+      if (d < 3000 && (random32() & 3) == 0)
+        return(keyDown[i] ? HIGH : LOW);
+      return(keyDown[i] ? LOW : HIGH);
+    }
+  }
+
+  return(HIGH);
+}
+
+void moveKeys(void)
+// Press and release the keys at random, from quick taps to long holds,
+// with idle gaps between the presses
+{
+  for (uint8_t i = 0; i < ARRAY_SIZE(SW_PIN); i++)
+  {
+    if ((int32_t)(hostTime() - keyNext[i]) >= 0)
+    {
+      keyDown[i] = !keyDown[i];
+      keyChange[i] = hostTime();
+      keyNext[i] = hostTime() + 5000 + random32() % (keyDown[i] ? 1000000UL : 2000000UL);
+    }
+  }
+}
+
+// --- Record and replay check
+typedef struct
+{
+  uint32_t time;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+std::vector<event_t> replayEvents;
+
+void saveEvent(const sample_t &s, uint8_t key, MD_UISwitch::keyResult_t k)
+{
+  replayEvents.push_back({ s.time, key, k });
+}
+
+uint32_t check(uint16_t dbTime, uint32_t period, uint32_t rdTime = 0)
+// Record the switches read every period us, with each pin read taking rdTime
+// us and each micros() call up to that, replay and compare. Return the errors.
+{
+  static sample_t buf[ARRAY_SIZE(SW_PIN)][REC_SIZE];
+  MD_UISwitch_Digital sw0(SW_PIN[0], LOW), sw1(SW_PIN[1], LOW);
+  MD_UISwitch_Recorder rec0(buf[0], REC_SIZE), rec1(buf[1], REC_SIZE);
+  MD_UISwitch_Digital *sw[ARRAY_SIZE(SW_PIN)] = { &sw0, &sw1 };
+  MD_UISwitch_Recorder *rec[ARRAY_SIZE(SW_PIN)] = { &rec0, &rec1 };
+  std::vector<sample_t> samples[ARRAY_SIZE(SW_PIN)];
+  std::vector<event_t> events[ARRAY_SIZE(SW_PIN)];
+  uint32_t errors = 0, reads = 0;
+
+  hostSetTime(0);
+  readTime = rdTime;
+  hostSetMicrosTime(rdTime);
+  for (uint8_t i = 0; i < ARRAY_SIZE(SW_PIN); i++)
+  {
+    sw[i]->begin();
+    setupSwitch(*sw[i], dbTime);
+    sw[i]->setRecorder(rec[i]);
+    keyDown[i] = false;
+    keyChange[i] = keyNext[i] = 0;
+  }
+
+  // record, moving the samples out of the recorders before they fill
+  for (uint32_t t = 0; t < CHECK_MS * 1000UL; t += period)
+  {
+    hostSetTime(t);
+    moveKeys();
+    reads++;
+    for (uint8_t i = 0; i < ARRAY_SIZE(SW_PIN); i++)
+    {
+      MD_UISwitch::keyResult_t k = sw[i]->read();
+
+      if (k != MD_UISwitch::KEY_NULL)
+        events[i].push_back({ t / 1000, 0, k });
+
+      if (rec[i]->count() > REC_SIZE / 2)
+      {
+        for (uint16_t j = 0; j < rec[i]->count(); j++)
+          samples[i].push_back(rec[i]->get(j));
+        rec[i]->clear();
+      }
+    }
+  }
+
+  // replay and compare
+  readTime = 0;
+  hostSetMicrosTime(0);
+  for (uint8_t i = 0; i < ARRAY_SIZE(SW_PIN); i++)
+  {
+    MD_UISwitch_Replay r;
+
+    for (uint16_t j = 0; j < rec[i]->count(); j++)
+      samples[i].push_back(rec[i]->get(j));
+    if (rec[i]->getLost() != 0) errors++;
+
+    setupSwitch(r, dbTime);
+    replayEvents.clear();
+    r.replay(samples[i].data(), samples[i].size(), saveEvent);
+
+    if (replayEvents.size() != events[i].size())
+      errors++;
+    for (size_t j = 0; j < replayEvents.size() && j < events[i].size(); j++)
+      if (replayEvents[j].time != events[i][j].time || replayEvents[j].result != events[i][j].result)
+        errors++;
+
+    printf("\ndebounce %2ums read every %4luus (%luus clock reads) switch %u: %5lu events, %7lu of %lu reads recorded, errors %lu",
+      dbTime, (unsigned long)period, (unsigned long)rdTime, i, (unsigned long)events[i].size(), (unsigned long)samples[i].size(),
+      (unsigned long)reads, (unsigned long)errors);
+  }
+
+  return(errors);
+}
+
+// --- Replay from stdin
+std::vector<sample_t> trace;
+
+void printEvent(const sample_t &s, uint8_t key, MD_UISwitch::keyResult_t k)
+{
+  static const char *name[] = { "KEY_NULL", "KEY_DOWN", "KEY_UP", "KEY_PRESS", "KEY_DOUBLE", "KEY_LONG", "KEY_REPEAT" };
+
+  printf("\n%lu key %u %s", (unsigned long)s.time, key, name[k]);
+}
+
+bool readTrace(void)
+{
+  char line[80];
+
+  while (fgets(line, sizeof(line), stdin) != nullptr)
+  {
+    unsigned long time, us;
+    unsigned int key;
+
+    if (line[0] == '#') continue;
+    if (sscanf(line, "%lu %lu %u", &time, &us, &key) == 3)
+      trace.push_back({ (uint32_t)time, (uint32_t)us, (uint8_t)key });
+  }
+
+  return(!trace.empty());
+}
+
+void replayTrace(void)
+{
+  MD_UISwitch_Replay r;
+  uint32_t n;
+
+  setupSwitch(r, 0);
+  n = r.replay(trace.data(), trace.size(), printEvent);
+  printf("\n\n%lu samples, %lu events", (unsigned long)trace.size(), (unsigned long)n);
+
+  // replay speed
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint16_t i = 0; i < BENCH_RUNS; i++)
+  {
+    MD_UISwitch_Replay rb;
+
+    setupSwitch(rb, 0);
+    rb.replay(trace.data(), trace.size());
+  }
+  std::chrono::duration<double> dt = std::chrono::steady_clock::now() - t0;
+  printf("\nReplay speed %.1f million samples/s\n", (double)trace.size() * BENCH_RUNS / dt.count() / 1e6);
+}
+
+void setup(void)
+{
+  hostSetPinModel(pinModel);
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  if (!isatty(0) && readTrace())
+  {
+    replayTrace();
+    hostExit(0);
+  }
+
+  errors += check(0, 200);
+  errors += check(0, 1000);
+  errors += check(10, 200);
+  errors += check(10, 5000);
+  errors += check(1, 100, 5);
+  errors += check(2, 200, 20);
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
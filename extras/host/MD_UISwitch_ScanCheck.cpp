@@ -0,0 +1,333 @@
+/*
+MD_UISwitch scan check.
+
+Presses the keys of a scripted 4x5 matrix and a 20 key 4017 keypad with
+contact bounce, sometimes two keys together, and checks that the idle probe
+gives the same events at the same times as scanning every key on each read:
+- MD_UISwitch_Matrix, single key and NKRO modes, driving the columns or the
+  rows. The full scan on each read is made by a model where the probe, and
+  only the probe, always finds a key pressed.
+- MD_UISwitch_4017KM with a probe pin (setProbePin()) and without one.
+The I/O accesses for each read are printed for comparison, and the probe is
+checked to make fewer accesses than the full scan.
+
+It then checks that scans spread over several read() calls by setScanSlice()
+give the same events at the same times as complete scans, for the Matrix in
+each mode and the 4017 keypad (with its probe pin) with several slice sizes.
+Each ms the switch is read getScanCalls() times, and only the last of these
+may return events.
+
+Build with the host HAL (see MD_UISwitch_HostHAL.h) and run with no
+parameters. The exit code is 0 if all checks pass.
+*/
+
+#include <vector>
+#include <algorithm>
+#include <MD_UISwitch.h>
+
+const uint32_t CHECK_MS = 60000;      // simulated time for each check
+
+// --- Matrix inputs
+uint8_t rowPin[] = { 20, 21, 22, 23 };
+uint8_t colPin[] = { 24, 25, 26, 27, 28 };
+char kt[] = "abcdefghijklmnopqrst";
+const uint8_t ROWS = ARRAY_SIZE(rowPin);
+const uint8_t COLS = ARRAY_SIZE(colPin);
+const uint8_t KEYS = ROWS * COLS;     // keys in the matrix and the 4017 keypad
+const uint8_t SLOTS = 4;              // NKRO key slots
+
+// --- 4017 keypad pins
+const uint8_t PIN_CLK = 30;
+const uint8_t PIN_KEY = 31;
+const uint8_t PIN_RST = 32;
+const uint8_t PIN_PROBE = 33;
+
+// --- Press pattern
+typedef struct
+{
+  uint32_t start, end;    // ms
+  uint8_t  key;           // key pressed
+  uint8_t  key2;          // a second key pressed at the same time, or the same key
+} press_t;
+
+std::vector<press_t> pattern;
+uint32_t rnd = 29;
+
+uint32_t random32(void)
+{
+  rnd ^= rnd << 13; rnd ^= rnd >> 17; rnd ^= rnd << 5;    // xorshift
+  return(rnd);
+}
+
+void makePattern(void)
+// Random presses of one key, some held long and some with a second key in
+// another row and column, so there is no ghosting
+{
+  uint32_t t = 50;
+
+  pattern.clear();
+  while (t < CHECK_MS - 2000)
+  {
+    uint32_t len = 20 + random32() % ((random32() % 4) ? 300 : 1500);
+    uint8_t key = random32() % KEYS;
+    uint8_t key2 = key;
+
+    if (random32() % 8 == 0)
+      key2 = (((key / COLS) + 1) % ROWS) * COLS + ((key % COLS) + 1) % COLS;
+    pattern.push_back({ t, t + len, key, key2 });
+    t += len + 20 + random32() % ((random32() % 2) ? 400 : 3000);
+  }
+}
+
+bool pressed(uint32_t t, uint8_t key)
+// The key state with contact bounce around each change, the same for every run
+{
+  for (size_t i = 0; i < pattern.size(); i++)
+  {
+    if (t < pattern[i].start) break;
+    if (t >= pattern[i].end + 3 || (pattern[i].key != key && pattern[i].key2 != key)) continue;
+    if (t < pattern[i].start + 3 || t >= pattern[i].end)
+      return(((t * 2654435761UL) >> 31) != 0);   // bounce
+    return(true);
+  }
+
+  return(false);
+}
+
+// --- Simulated hardware
+bool probeHit = false;    // the matrix probe always finds a key
+
+bool driven(uint8_t pin) { return(hostGetPinMode(pin) == OUTPUT && hostGetPin(pin) == LOW); }
+
+uint8_t countDriven(const uint8_t *pin, uint8_t n)
+{
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < n; i++)
+    if (driven(pin[i])) count++;
+
+  return(count);
+}
+
+uint8_t position(void)
+// The 4017 output that is HIGH, from the clock pulses since the last reset
+{
+  static uint32_t resets = 0, base = 0;
+
+  if (hostPulseCount(PIN_RST) != resets)
+  {
+    resets = hostPulseCount(PIN_RST);
+    base = hostPulseCount(PIN_CLK);
+  }
+
+  return((hostPulseCount(PIN_CLK) - base) % KEYS);
+}
+
+uint8_t pinModel(uint8_t pin)
+// Matrix keys connect their row and column, whichever is driven. The probe
+// drives all the lines of one dimension, which a scan never does. The 4017
+// key pin is HIGH for the key at the counter position, or for any key while
+// the probe pin is HIGH.
+{
+  uint32_t t = hostTime() / 1000;
+
+  if (pin == PIN_KEY)
+  {
+    for (uint8_t k = 0; k < KEYS; k++)
+      if (pressed(t, k) && (hostGetPin(PIN_PROBE) == HIGH || position() == k))
+        return(HIGH);
+    return(LOW);
+  }
+
+  if (probeHit)
+  {
+    for (uint8_t r = 0; r < ROWS; r++)
+      if (pin == rowPin[r] && countDriven(colPin, COLS) > 1) return(LOW);
+    for (uint8_t c = 0; c < COLS; c++)
+      if (pin == colPin[c] && countDriven(rowPin, ROWS) > 1) return(LOW);
+  }
+
+  for (uint8_t r = 0; r < ROWS; r++)
+    for (uint8_t c = 0; c < COLS; c++)
+      if (((pin == rowPin[r] && driven(colPin[c])) || (pin == colPin[c] && driven(rowPin[r]))) &&
+        pressed(t, (r * COLS) + c))
+        return(LOW);
+
+  return(hostGetPin(pin));
+}
+
+// --- Event log
+typedef struct
+{
+  uint32_t time;
+  uint8_t  key;
+  MD_UISwitch::keyResult_t result;
+} event_t;
+
+bool operator==(const event_t &a, const event_t &b)
+{
+  return(a.time == b.time && a.key == b.key && a.result == b.result);
+}
+
+bool operator<(const event_t &a, const event_t &b)
+{
+  return(a.time < b.time || (a.time == b.time && a.key < b.key));
+}
+
+std::vector<event_t> run(MD_UISwitch &s, uint32_t &io, uint8_t calls = 1, uint32_t *early = nullptr)
+// Read the switch calls times every ms, return the events and the I/O count.
+// The events returned before the last call each ms are counted in early.
+{
+  std::vector<event_t> log;
+
+  if (early != nullptr) *early = 0;
+  io = hostIoCount();
+  for (uint32_t t = 0; t < CHECK_MS; t++)
+  {
+    hostSetTime(t * 1000);
+    for (uint8_t c = 0; c < calls; c++)
+    {
+      MD_UISwitch::keyEvent_t ev[2 * SLOTS];
+      uint8_t n = s.read(ev, ARRAY_SIZE(ev), t);
+
+      if (n != 0 && c != calls - 1 && early != nullptr) (*early)++;
+      for (uint8_t i = 0; i < n; i++)
+        log.push_back({ t, ev[i].key, ev[i].result });
+    }
+  }
+  io = hostIoCount() - io;
+  std::stable_sort(log.begin(), log.end());
+
+  return(log);
+}
+
+uint32_t report(const char *name, const std::vector<event_t> &probe, const std::vector<event_t> &full,
+  uint32_t ioProbe, uint32_t ioFull)
+{
+  printf("\n%-38s %4lu events, probe %s, I/O per read %4.1f with probe, %4.1f full scan",
+    name, (unsigned long)full.size(), (probe == full) ? "same" : "DIFFERENT",
+    (double)ioProbe / CHECK_MS, (double)ioFull / CHECK_MS);
+
+  return((probe == full && ioProbe < ioFull) ? 0 : 1);
+}
+
+// --- Probe check
+std::vector<event_t> runMatrix(bool nkro, bool driveRows, bool hit, uint32_t &io,
+  uint8_t slice = 0, uint8_t *calls = nullptr, uint32_t *early = nullptr)
+{
+  MD_UISwitch_Matrix sw(ROWS, COLS, rowPin, colPin, kt);
+  MD_UISwitch_Matrix::keySlot_t slot[SLOTS];
+
+  hostSetTime(0);
+  probeHit = hit;
+  sw.setDriveRows(driveRows);
+  sw.begin();
+  if (nkro) sw.enableNKRO(slot, SLOTS);
+  sw.setScanSlice(slice);
+  if (calls != nullptr) *calls = sw.getScanCalls();
+
+  return(run(sw, io, sw.getScanCalls(), early));
+}
+
+std::vector<event_t> run4017(bool probe, uint32_t &io,
+  uint8_t slice = 0, uint8_t *calls = nullptr, uint32_t *early = nullptr)
+{
+  MD_UISwitch_4017KM sw(KEYS, PIN_CLK, PIN_KEY, PIN_RST);
+
+  hostSetTime(0);
+  probeHit = false;
+  if (probe) sw.setProbePin(PIN_PROBE);
+  sw.begin();
+  sw.setScanSlice(slice);
+  if (calls != nullptr) *calls = sw.getScanCalls();
+
+  return(run(sw, io, sw.getScanCalls(), early));
+}
+
+uint32_t checkProbe(void)
+{
+  std::vector<event_t> probe, full;
+  uint32_t ioProbe, ioFull;
+  uint32_t errors = 0;
+
+  for (uint8_t mode = 0; mode < 4; mode++)
+  {
+    bool nkro = (mode & 1), driveRows = (mode & 2);
+    char name[40];
+
+    probe = runMatrix(nkro, driveRows, false, ioProbe);
+    full = runMatrix(nkro, driveRows, true, ioFull);
+    snprintf(name, sizeof(name), "Matrix %ux%u, %s %s drive:", ROWS, COLS,
+      nkro ? "NKRO," : "single key,", driveRows ? "row" : "column");
+    errors += report(name, probe, full, ioProbe, ioFull);
+  }
+
+  probe = run4017(true, ioProbe);
+  full = run4017(false, ioFull);
+  errors += report("4017, 20 keys:", probe, full, ioProbe, ioFull);
+
+  return(errors);
+}
+
+// --- Slice check
+uint32_t reportSlice(const char *name, uint8_t slice, uint8_t calls, const std::vector<event_t> &full,
+  const std::vector<event_t> &sliced, uint32_t early)
+{
+  printf("\n %-37s slice %2u in %2u calls: %4lu events, %s, %lu early",
+    name, slice, calls, (unsigned long)full.size(), (sliced == full) ? "same" : "DIFFERENT", (unsigned long)early);
+
+  return((sliced == full && early == 0) ? 0 : 1);
+}
+
+uint32_t checkSlice(void)
+{
+  const uint8_t steps[] = { 1, 3, 7, 10 };    // 4017 keys checked per call
+  std::vector<event_t> full, sliced;
+  uint32_t io, early;
+  uint8_t calls;
+  uint32_t errors = 0;
+
+  printf("\n\nSliced scans against complete scans:");
+  for (uint8_t mode = 0; mode < 4; mode++)
+  {
+    bool nkro = (mode & 1), driveRows = (mode & 2);
+    uint8_t nDrive = driveRows ? ROWS : COLS;
+    char name[40];
+
+    snprintf(name, sizeof(name), "Matrix %ux%u, %s %s drive:", ROWS, COLS,
+      nkro ? "NKRO," : "single key,", driveRows ? "row" : "column");
+    full = runMatrix(nkro, driveRows, false, io);
+    for (uint8_t slice = 1; slice < nDrive; slice++)
+    {
+      sliced = runMatrix(nkro, driveRows, false, io, slice, &calls, &early);
+      errors += reportSlice(name, slice, calls, full, sliced, early);
+    }
+  }
+
+  full = run4017(true, io);
+  for (uint8_t i = 0; i < ARRAY_SIZE(steps); i++)
+  {
+    sliced = run4017(true, io, steps[i], &calls, &early);
+    errors += reportSlice("4017, 20 keys:", steps[i], calls, full, sliced, early);
+  }
+
+  return(errors);
+}
+
+void setup(void)
+{
+  printf("\n[MD_UISwitch Scan Check]\n");
+}
+
+void loop(void)
+{
+  uint32_t errors = 0;
+
+  makePattern();
+  hostSetPinModel(pinModel);
+  errors += checkProbe();
+  errors += checkSlice();
+  printf("\n\n%s\n", errors == 0 ? "PASS" : "FAIL");
+
+  hostExit(errors == 0 ? 0 : 1);
+}
@@ -23,410 +23,882 @@ const int16_t KEY_IDX_UNDEF = -1;   ///< Index value for undefined index
 #define UI_PRINT(s, v)  ///< Debugging macro
 #endif
 
-MD_UISwitch::MD_UISwitch(void) : _state(S_IDLE), _lastKeyIdx(KEY_IDX_UNDEF)
+MD_UISwitch::MD_UISwitch(void) : _lastKeyIdx(KEY_IDX_UNDEF), _newKey(false)
 {
+  _profile.enableFlags = 0;
   setPressTime(KEY_PRESS_TIME);
   setDoublePressTime(KEY_DPRESS_TIME);
   setLongPressTime(KEY_LONGPRESS_TIME);
   setRepeatTime(KEY_REPEAT_TIME);
   enableRepeatResult(false);
+  setDebounce(_dbTiming, 0, DB_TC_THIRTYSECOND);
+  setLockout(_dbTiming, false, 0);
   debounce(false, true);    // reset the debounce routine
   processFSM(false, true);  // reset the FSM
+#if UI_INSTRUMENT
+  statClear(_stats);
+  _evTime = uiEventTime_t();
+  _statActive = false;
+#endif
+#if UI_RECORD
+  _rec = nullptr;
+#endif
 }
 
-bool MD_UISwitch::debounce(bool curStatus, bool reset)
-/*
-  Switch debounce using Edge Detection & Resistor-Capacitor Digital Filter.
-
-  This Digital filter mimics an analogue RC filter with first-order
-  recursive low pass filter. It has good EMI filtering and quick response,
-  with a nearly continuous output like an analogue circuit.
-
-  Based on Elio Mazzocca, Contact-debouncing algorithm emulates Schmitt trigger.
-  Based on Oregon State University, Debounce switches algorithm.
-  Based on John Youngquist, Debouncing Switches and Encoders.
-  Version by Andrew M. Kollosche, 2015-2018 at http://www.ganssle.com/tem/tem366.html
-
-  Time-Constant  TCSHIFT, TC,  UTH,  LTH, Approx execute times on a PIC16 @ 2MHz.
-  Quarter           2,    63,  242,   15,  1ms.
-  Eight             3,    31,  238,   12,  2ms.
-  Sixteenth         4,    15,  230,   10,  3ms.
-  Thirty-second     5,     7,  215,    7,  9ms.
-  Sixty-forth       6,     3,  184,    3,  15ms.
-
-  Note: Thresholds count for each RC time-constant,
-  is calculated on 3 time-constants or for Upper threshold is 96% and
-  3% for Lower Threshold.
-*/
+#if UI_INSTRUMENT
+void MD_UISwitch::statClear(uiStats_t &st)
+{
+  st = uiStats_t();
+  st.readMin = 0xffffffff;
+}
+
+void MD_UISwitch::statRead(uiStats_t &st, uint32_t t)
+{
+  uint8_t b = 0;
+
+  st.scans++;
+  if (t < st.readMin) st.readMin = t;
+  if (t > st.readMax) st.readMax = t;
+
+  // power of 2 buckets from 16us
+  while (b < UI_STATS_HIST - 1 && t >= (16UL << b))
+    b++;
+  if (st.readHist[b] != 0xffff) st.readHist[b]++;
+}
+
+void MD_UISwitch::statEventTime(uiEventTime_t &et, bool &active, state_db before, const dbState_t &db, bool b)
+// Note when the debounce starts on a new press, when its result goes active and
+// when it goes inactive again.
 {
-  // --- These constants are a consistent set from the table above
-  const uint8_t TC_SHIFT = 5;   // bit shift for fraction
-  const uint8_t TC = 7;         // RC time constant
-  const uint8_t UTH = 215;      // Upper Threshold  for 'on'
-  const uint8_t LTH = 7;        // Lower Threshold for 'off'
-  // ---
+  uint32_t t = UI_MICROS();
 
-  // handle the reset
-  if (reset)
+  if (before != S_DEBOUNCE && db.RCstate == S_DEBOUNCE)
   {
-    _RC = 0;
-    _prevStatus = false;
-    _RCstate = S_WAIT_START;
+    et.timeEdge = t;
+    et.timeAccept = et.timeRelease = 0;
   }
+  if (b && !active) et.timeAccept = t;
+  if (!b && active) et.timeRelease = t;
+  active = b;
+}
+#endif
 
-  bool b = _prevStatus; // return status value
+// RC filter constants for each debounceTC_t, see debounce() in MD_UISwitch.h
+const uint8_t PROGMEM MD_UISwitch::dbTable[][4] =
+{
+  // TC_SHIFT, TC, UTH, LTH
+  { 2, 63, 242, 15 },
+  { 3, 31, 238, 12 },
+  { 4, 15, 230, 10 },
+  { 5,  7, 215,  7 },
+  { 6,  3, 184,  3 },
+};
+
+void MD_UISwitch::setDebounce(dbTiming_t &dt, uint32_t us, debounceTC_t tc)
+{
+  const uint8_t *row = dbTable[tc];
+  uint8_t shift = UI_PGM_READ_BYTE(row + 0);
+  uint8_t TC = UI_PGM_READ_BYTE(row + 1);
+  uint8_t UTH = UI_PGM_READ_BYTE(row + 2);
+  uint8_t rc = 0;
+  uint8_t steps = 0;
+
+  // count the filter steps for a clean key press to pass the upper threshold
+  while (rc <= UTH)
+  {
+    rc = rc - (rc >> shift) + TC;
+    steps++;
+  }
 
-  //edge detector from 'inactive' to 'active'
-  switch (_RCstate)
+  if (us != 0)
   {
-    case S_WAIT_START: // wait for 'inactive' to 'active' transition
-    {
-      if (!_prevStatus && curStatus)
-        _RCstate = S_DEBOUNCE;
-      _prevStatus = curStatus;
-    }
-    break;
+    us /= steps;
+    if (us == 0) us = 1;  // the shortest step time, as 0 is one step per read
+  }
+  if (us > 0xffff) us = 0xffff;
+  dt.tc = tc;
+  dt.tick = (uint16_t)us;
+}
 
-    case S_DEBOUNCE:  // RC debounce
-    {
-      //first compute RCnew = RCold * fraction. Using shift and subtraction.
-      uint8_t temp = _RC >> TC_SHIFT;
-      _RC = _RC - temp;   // subtract fraction for result.
+void MD_UISwitch::setLockout(dbTiming_t &dt, bool f, uint8_t t)
+{
+  if (t > 65) t = 65;   // the lockout time is held in 16 bit microseconds
+  dt.lockout = f ? ((t == 0) ? 1 : (uint16_t)t * 1000) : 0;
+}
 
-      if (curStatus)    // still an active switch
-        _RC += TC;       // add in the time constant
-      else
-        if (_RC > 0) _RC--; // 'leak' and decay the value
+#if UI_FSM_TABLE
+// FSM transition table
+//
+// Each entry is the next state, the event returned, the event pushed for the 
+// next step and whether the state timer restarts. The entries for a state are
+// found through its fsmIndex byte
+//   bit 7    - the state has a timer (FSM_TIMED, see timerLimit())
+//   bits 3-6 - first entry of the state's block, in groups of 4
+//   bits 0-2 - the option bits (enableFlags) that change what the state does
+// and within the block by the options in the mask, the switch input and the
+// timer expired, in that order. So a state that depends on no options has 4
+// entries, one for each combination of input and timer.
+//
+// The KEY_RPTPRESS event is returned as KEY_PRESS unless REPEAT_RESULT_ENABLE.
+#define FSM_T(next, ev, push, timer) \
+  (uint16_t)((next) | ((ev) << FSM_EVENT) | ((push) << FSM_PUSH) | ((timer) << FSM_TIMER))
+#define FSM_I(timed, block, mask) (uint8_t)(((timed) ? FSM_TIMED : 0) | ((block) << 3) | (mask))
+
+const uint8_t PROGMEM MD_UISwitch::fsmIndex[] =
+{
+  FSM_I(0,  0, 0),    // S_IDLE
+  FSM_I(1,  1, (1 << DPRESS_ENABLE) | (1 << LONGPRESS_ENABLE) | (1 << REPEAT_ENABLE)),  // S_PRESS
+  FSM_I(1,  9, 0),    // S_PRESS2A
+  FSM_I(1, 10, 0),    // S_PRESS2B
+  FSM_I(1, 11, (1 << REPEAT_ENABLE)),   // S_PRESSL
+  FSM_I(1, 13, 0),    // S_REPEAT
+  FSM_I(0, 14, 0),    // S_WAIT
+};
+
+const uint16_t PROGMEM MD_UISwitch::fsmTable[] =
+{
+  // Each line is the input inactive and active, with the timer running and
+  // then expired. The S_PRESS and S_PRESSL blocks have a line for each
+  // combination of the options they depend on.
+
+  // S_IDLE - wait for the first transition
+  FSM_T(S_IDLE, KEY_NULL, KEY_NULL, 0),     FSM_T(S_IDLE, KEY_NULL, KEY_NULL, 0),
+  FSM_T(S_PRESS, KEY_DOWN, KEY_NULL, 1),    FSM_T(S_PRESS, KEY_DOWN, KEY_NULL, 1),
+
+  // S_PRESS - released before the press time is a press or the start of
+  // a double press. Held past the press time is a long press, repeats or a
+  // press, depending on the options. A release seen after the press time
+  // when double press is off gives KEY_UP then KEY_PRESS, and then whatever
+  // the options give for the timer expiring.
+  // no options
+  FSM_T(S_IDLE, KEY_UP, KEY_PRESS, 0),      FSM_T(S_WAIT, KEY_PRESS, KEY_PRESS, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_WAIT, KEY_PRESS, KEY_NULL, 1),
+  // REPEAT
+  FSM_T(S_IDLE, KEY_UP, KEY_PRESS, 0),      FSM_T(S_REPEAT, KEY_PRESS, KEY_PRESS, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_REPEAT, KEY_PRESS, KEY_NULL, 1),
+  // LONGPRESS
+  FSM_T(S_IDLE, KEY_UP, KEY_PRESS, 0),      FSM_T(S_PRESSL, KEY_UP, KEY_PRESS, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_PRESSL, KEY_NULL, KEY_NULL, 1),
+  // LONGPRESS, REPEAT
+  FSM_T(S_IDLE, KEY_UP, KEY_PRESS, 0),      FSM_T(S_PRESSL, KEY_UP, KEY_PRESS, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_PRESSL, KEY_NULL, KEY_NULL, 1),
+  // DPRESS
+  FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),    FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_WAIT, KEY_PRESS, KEY_NULL, 1),
+  // DPRESS, REPEAT
+  FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),    FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_REPEAT, KEY_PRESS, KEY_NULL, 1),
+  // DPRESS, LONGPRESS
+  FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),    FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_PRESSL, KEY_NULL, KEY_NULL, 1),
+  // DPRESS, LONGPRESS, REPEAT
+  FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),    FSM_T(S_PRESS2A, KEY_UP, KEY_NULL, 1),
+  FSM_T(S_PRESS, KEY_NULL, KEY_NULL, 0),    FSM_T(S_PRESSL, KEY_NULL, KEY_NULL, 1),
+
+  // S_PRESS2A - wait for the key to be pressed again in a double press,
+  // or time out as a press
+  FSM_T(S_PRESS2A, KEY_NULL, KEY_NULL, 0),  FSM_T(S_IDLE, KEY_PRESS, KEY_NULL, 0),
+  FSM_T(S_PRESS2B, KEY_DOWN, KEY_NULL, 1),  FSM_T(S_PRESS2B, KEY_DOWN, KEY_NULL, 1),
+
+  // S_PRESS2B - wait for the release in a double press. Not released in
+  // time is just a press, waiting for the release.
+  FSM_T(S_IDLE, KEY_UP, KEY_DPRESS, 0),     FSM_T(S_IDLE, KEY_UP, KEY_PRESS, 0),
+  FSM_T(S_PRESS2B, KEY_NULL, KEY_NULL, 0),  FSM_T(S_WAIT, KEY_NULL, KEY_PRESS, 0),
+
+  // S_PRESSL - released before the long press time is a long press, after
+  // it the first repeat or the long press, waiting for the release
+  // no options
+  FSM_T(S_IDLE, KEY_UP, KEY_LONGPRESS, 0),  FSM_T(S_IDLE, KEY_UP, KEY_LONGPRESS, 0),
+  FSM_T(S_PRESSL, KEY_NULL, KEY_NULL, 0),   FSM_T(S_WAIT, KEY_LONGPRESS, KEY_NULL, 0),
+  // REPEAT
+  FSM_T(S_IDLE, KEY_UP, KEY_LONGPRESS, 0),  FSM_T(S_IDLE, KEY_UP, KEY_LONGPRESS, 0),
+  FSM_T(S_PRESSL, KEY_NULL, KEY_NULL, 0),   FSM_T(S_REPEAT, KEY_PRESS, KEY_NULL, 1),
+
+  // S_REPEAT - a repeat each time the timer expires until released
+  FSM_T(S_IDLE, KEY_UP, KEY_NULL, 0),       FSM_T(S_IDLE, KEY_UP, KEY_NULL, 0),
+  FSM_T(S_REPEAT, KEY_NULL, KEY_NULL, 0),   FSM_T(S_REPEAT, KEY_RPTPRESS, KEY_NULL, 1),
+
+  // S_WAIT - wait for the key to be released
+  FSM_T(S_IDLE, KEY_UP, KEY_NULL, 0),       FSM_T(S_IDLE, KEY_UP, KEY_NULL, 0),
+  FSM_T(S_WAIT, KEY_NULL, KEY_NULL, 0),     FSM_T(S_WAIT, KEY_NULL, KEY_NULL, 0),
+};
+
+#undef FSM_T
+#undef FSM_I
+
+MD_UISwitch::keyResult_t MD_UISwitch::fsmStep(fsmState_t &fsm, uint8_t d, uint8_t flags, bool b, bool expired, uint32_t now)
+// Take one FSM step from the transition table
+{
+  uint8_t idx = ((((d >> 3) & 0xf) + (flags & d & 0x7)) << 2) | (b << 1) | expired;
+  uint16_t t = UI_PGM_READ_WORD(&fsmTable[idx]);
+  keyResult_t k;
 
-      //check upper & lower threshold.
-      b = (_RC > UTH);     // upper threshold means we have a valid result
-      if (b or _RC < LTH)  // got result or lower threshold
-      {
-        _RC = 0;               // reset RC value
-        _RCstate = S_WAIT_RELEASE; // move on to next state
-      }
-    }
-    break;
+  fsm.state = (state_fsm)(t & 0x7);
+  fsm.kPush = (keyResult_t)((t >> FSM_PUSH) & 0x7);
+  if (t & (1 << FSM_TIMER)) fsm.timeActive = now;
 
-    case S_WAIT_RELEASE:  // waiting for switch release
-    default:
-    {
-      if (!curStatus) _RCstate = S_WAIT_START;
-    }
-    break;
-  }
+  k = (keyResult_t)((t >> FSM_EVENT) & 0x7);
+  if (k == KEY_RPTPRESS && !bitRead(flags, REPEAT_RESULT_ENABLE))
+    k = KEY_PRESS;
+
+  return(k);
+}
+
+#endif
 
-  // UIPRINTS((b) ? "-> DOWN" : "<- UP");
+uint32_t MD_UISwitch::nextDeadline(uint32_t now)
+{
+  if (_newKey) return(0);
+
+  return(deadline(_fsm, _db, _profile, now));
+}
 
-  return (b);
+uint8_t MD_UISwitch::read(keyEvent_t *ev, uint8_t evSize, uint32_t now)
+{
+  return(readEvents(*this, ev, evSize, now));
 }
 
-MD_UISwitch::keyResult_t MD_UISwitch::processFSM(bool b, bool reset)
-// Return one of the keypress types depending on what has been detected
-// in the FSM logic
+uint8_t MD_UISwitch::poll(MD_UISwitch *s[], uint8_t count, keyResult_t *result)
 {
-  keyResult_t k = KEY_NULL;
+  uint32_t now = UI_MILLIS();   // one time for the whole group
+  uint8_t n = 0;
 
-  if (reset)
+  for (uint8_t i = 0; i < count; i++)
   {
-    _state = S_IDLE;
-    _kPush = KEY_NULL;
-    return(k);
+    result[i] = s[i]->read(now);
+    if (result[i] != KEY_NULL) n++;
   }
 
-  // If we have previously pushed something return that status now
-  if (_kPush != KEY_NULL)
+  return(n);
+}
+
+uint32_t MD_UISwitch::nextDeadline(MD_UISwitch *s[], uint8_t count)
+{
+  uint32_t now = UI_MILLIS();
+  uint32_t t = DEADLINE_NONE;
+
+  for (uint8_t i = 0; i < count && t != 0; i++)
   {
-    k = _kPush;
-    _kPush = KEY_NULL;
-    return(k);
+    uint32_t d = s[i]->nextDeadline(now);
+
+    if (d < t) t = d;
   }
 
-  // Now run the FSM with the input
-  switch (_state)
+  return(t);
+}
+
+
+// -----------------------------------------------
+// MD_UISwitch_Digital methods
+// -----------------------------------------------
+void MD_UISwitch_Digital::begin(void)
+{
+  UI_PRINT("\nUISwitch_Digital begin() ", _pinCount);
+  UI_PRINTS(" pins");
+
+  for (uint8_t i = 0; i < _pinCount; i++)
+    UI_PIN_MODE(_pins[i], _onState == LOW ? INPUT_PULLUP : INPUT);
+
+#if UI_PORT_IO
+  // group the pins by hardware port so that each port is read once
+  bool valid = true;
+
+  _portCount = 0;
+  for (uint8_t i = 0; valid && i < _pinCount; i++)
   {
-  case S_IDLE:    // waiting for first transition
-    //UI_PRINT("\nS_IDLE", b);
-    if (b)
-    {
-      _state = S_PRESS;
-      _timeActive = millis();
-      k = KEY_DOWN;
-    }
-    break;
+    volatile UI_PORT_TYPE *reg = UI_PORT_INPUT(_pins[i]);
+    uint8_t j = 0;
 
-  case S_PRESS:   // press?
-    UI_PRINT("\nS_PRESS ", b);
-    // Key off before a long press registered, so it is either double press or a press.
-    if (!b)
-    {
-      k = KEY_UP;
-      if (bitRead(_enableFlags, DPRESS_ENABLE))  // DPRESS allowed
-      {
-        _state = S_PRESS2A;
-        _timeActive = millis();
-      }
-      else      // this is just a press
-      {
-        _kPush = KEY_PRESS;
-        _state = S_IDLE;
-      }
-    }
+    while (j < _portCount && _portReg[j] != reg)
+      j++;
 
-    // if the switch is still on and we have run out of press time ...
-    if (millis() - _timeActive > _timePress)
+    if (reg == nullptr || (j == _portCount && _portCount == UI_DIGITAL_PORTS))
+      valid = false;    // not a port pin or too many ports
+    else
     {
-      _timeActive = millis();   // reset for repeat timer base
-      // ... we either have a long press or are 
-      // heading towards repeats if they are enabled
-      if (bitRead(_enableFlags, LONGPRESS_ENABLE)) 
-        _state = S_PRESSL;
-      else if (bitRead(_enableFlags, REPEAT_ENABLE))
+      if (j == _portCount)    // new port group
       {
-        k = KEY_PRESS;
-        _state = S_REPEAT;
+        _portReg[j] = reg;
+        _portMask[j] = 0;
+        _portCount++;
       }
-      else // nothing else that can be done as we have no time left!
-      {
-        k = KEY_PRESS;
-        _state = S_WAIT;
-      }
-    }
-    break;
-
-  case S_PRESSL:  // long press or auto repeat?
-    UI_PRINT("\nS_PRESSL ", b);
-    // It is a long press if
-    // - Key off before a repeat press is registered, or
-    // - Auto repeat is disabled
-    // Set the return code and go back to waiting
-    if (!b)
-    {
-      _kPush = KEY_LONGPRESS;
-      k = KEY_UP;
-      _state = S_IDLE;
-      break;
+      _portMask[j] |= UI_PORT_MASK(_pins[i]);
     }
+  }
 
-    if (millis() - _timeActive > _timeLongPress)
-    {
-      if (bitRead(_enableFlags, REPEAT_ENABLE))
-      {
-        k = KEY_PRESS;      // the first of the repeats
-        _state = S_REPEAT;  // handle the rest of them
-        _timeActive = millis();  // set the new baseline time.
-      }
-      else  // no repeats - register the long press and wait for release
-      {
-        k = KEY_LONGPRESS;
-        _state = S_WAIT;
-      }
-    }
-    break;
+  if (!valid) _portCount = 0;   // fall back to reading individual pins
+  UI_PRINT(" in ", _portCount);
+  UI_PRINTS(" port groups");
+#endif
+}
 
-  case S_REPEAT: // repeat?
-    UI_PRINT("\nS_REPEAT ", b);
-    // Key off before another repeat press is registered, so we have finished.
-    // Go back to waiting
-    if (!b)
-    {
-      k = KEY_UP;
-      _state = S_IDLE;
-    }
-    else    // if (b)
-    {
-      // if the switch is still on and we have not run out of repeat time, then
-      // just wait for the timer to expire.
-      if ((millis() - _timeActive) < _timeRepeat)
-        break;
-
-      // we are now sure we have a repeat, set the return code and remain in this
-      // state checking for further repeats if enabled
-      k = bitRead(_enableFlags, REPEAT_RESULT_ENABLE) ? KEY_RPTPRESS : KEY_PRESS;
-      _timeActive = millis();	// next key repeat time starts now
-    }
-    break;
+int16_t MD_UISwitch_Digital::scanPins(int16_t &idx)
+{
+  int16_t count = 0;
 
-  case S_PRESS2A:   // Wait for key to be pressed again in double press sequence
-    UI_PRINT("\nS_PRESS2A ", b);
-    if (b)
+  for (uint8_t i = 0; i < _pinCount; i++)
+  {
+    if (UI_DIGITAL_READ(_pins[i]) == _onState)
     {
-      k = KEY_DOWN;
-      _state = S_PRESS2B;		// switch detected, initiate second
-      _timeActive = millis();
+      if (idx == KEY_IDX_UNDEF) idx = i;  // only record the first one
+      count++;
     }
+  }
 
-    // Check if we didn't get a second press within time - 
-    // then this was just a press and wait for key release
-    if (millis() - _timeActive  > _timeDoublePress)
-    {
-      k = KEY_PRESS;
-      _state = (b) ? S_WAIT : S_IDLE;
-    }
-    break;
+  return(count);
+}
 
-  case S_PRESS2B:   // Wait for key to be released in double press sequence
-    UI_PRINT("\nS_PRESS2B ", b);
-    if (!b)
-    {
-      k = KEY_UP;
-      _kPush = KEY_DPRESS;
-      _state = S_IDLE;
-    }
+int16_t MD_UISwitch_Digital::scanPorts(int16_t &idx)
+{
+  int16_t count = 0;
+#if UI_PORT_IO
+  uint8_t port = 0;
+  UI_PORT_TYPE bit = 0;
+
+  // one register read per port, then count the active bits
+  for (uint8_t i = 0; i < _portCount; i++)
+  {
+    UI_PORT_TYPE v = UI_PORT_READ(_portReg[i]);
 
-    // we didn't get a second release within time then this was just a press
-    // and we wait for the key to be released
-    if (millis() - _timeActive >= _timePress*2)
+    if (_onState == LOW) v = ~v;
+    v &= _portMask[i];
+    if (v != 0)
     {
-      _kPush = KEY_PRESS;
-      _state = (b) ? S_WAIT : S_IDLE;
+      port = i;
+      bit = v;
     }
-    break;
-
-  case S_WAIT:
-  default:
-    // After completing while still key active, allow the user to release the switch
-    // to meet starting conditions for S_IDLE
-    UI_PRINT("\nS_WAITING ", b);
-    if (!b)
+    for (; v != 0; v &= (v - 1))
+      count++;
+  }
+
+  // only a single active key needs to be mapped back to its pin index,
+  // and this is usually the same key as last time.
+  if (count == 1)
+  {
+    if (_lastKeyIdx != KEY_IDX_UNDEF && _lastKeyIdx < _pinCount &&
+        UI_PORT_MASK(_pins[_lastKeyIdx]) == bit && UI_PORT_INPUT(_pins[_lastKeyIdx]) == _portReg[port])
+      idx = _lastKeyIdx;
+    else
     {
-      k = KEY_UP;
-      _state = S_IDLE;
+      for (uint8_t i = 0; i < _pinCount; i++)
+      {
+        if (UI_PORT_MASK(_pins[i]) == bit && UI_PORT_INPUT(_pins[i]) == _portReg[port])
+        {
+          idx = i;
+          break;
+        }
+      }
     }
-    break;
   }
+#else
+  (void)idx;
+#endif
 
-  return(k);
+  return(count);
 }
 
+MD_UISwitch::keyResult_t MD_UISwitch_Digital::read(uint32_t now)
+{
+  UI_STAT_READ(_stats);
+  int16_t idx = KEY_IDX_UNDEF;
+  int16_t count;
+
+  // work out which key is pressed
+  if (_portCount != 0)
+    count = scanPorts(idx);
+  else
+    count = scanPins(idx);
+
+  if (count == 1) _lastKey = _pins[idx];
 
+  return(processKey(*this, _profile, count, idx, now));
+}
 // -----------------------------------------------
-// MD_UISwitch_Digital methods
+
 // -----------------------------------------------
-void MD_UISwitch_Digital::begin(void)
+// MD_UISwitch_User methods
+// -----------------------------------------------
+void MD_UISwitch_User::begin(void)
 {
-  UI_PRINT("\nUISwitch_Digital begin() ", _pinCount);
-  UI_PRINTS(" pins");
-
-  for (uint8_t i = 0; i < _pinCount; i++)
-    pinMode(_pins[i], _onState == LOW ? INPUT_PULLUP : INPUT);
+  UI_PRINT("\nUISwitch_User begin() ", _idCount);
+  UI_PRINTS(" ids");
 }
 
-MD_UISwitch::keyResult_t MD_UISwitch_Digital::read(void)
+MD_UISwitch::keyResult_t MD_UISwitch_User::read(uint32_t now)
 {
-  bool b = false;
+  UI_STAT_READ(_stats);
   int16_t idx = KEY_IDX_UNDEF;
   int16_t count = 0;
 
   // work out which key is pressed
-  for (uint8_t i = 0; i < _pinCount; i++)
+  if (_cbBulk != nullptr)
   {
-    if (digitalRead(_pins[i]) == _onState)
+    uint32_t mask = _cbBulk();   // all the ids in one call
+
+    for (uint8_t i = 0; i < _idCount && mask != 0; i++)
     {
-      if (idx == KEY_IDX_UNDEF) idx = i;  // only record the first one
-      count++;
+      if (_ids[i] < 32 && (mask & (1UL << _ids[i])))
+      {
+        if (idx == KEY_IDX_UNDEF) idx = i;  // only record the first one
+        count++;
+      }
     }
   }
-
-  // if more than one key pressed, don't count anything
-  if (count == 1)   // we have a valid key
+  else
   {
-    // is this the same as the previous key?
-    if (idx != _lastKeyIdx) processFSM(debounce(false, true), true); // reset the debounce and FSM
-
-    b = (idx == _lastKeyIdx);
-    _lastKeyIdx = idx;
-    _lastKey = _pins[idx];
-    //UI_PRINT("\nKey idx ", _lastKeyIdx);
-    //UI_PRINT(" value ", _lastKey);
+    for (uint8_t i = 0; i < _idCount; i++)
+    {
+      if (_cb(_ids[i]))
+      {
+        if (idx == KEY_IDX_UNDEF) idx = i;  // only record the first one
+        count++;
+      }
+    }
   }
 
-  return(processFSM(debounce(b)));
+  if (count == 1) _lastKey = _ids[idx];
+  //UI_PRINT("\nKey idx ", idx);
+
+  return(processKey(*this, _profile, count, idx, now));
 }
 // -----------------------------------------------
 
 // -----------------------------------------------
-// MD_UISwitch_User methods
+// MD_UISwitch_Bank methods
 // -----------------------------------------------
-void MD_UISwitch_User::begin(void)
+MD_UISwitch_Bank::MD_UISwitch_Bank(uint8_t keyCount, MD_UISwitch_User::cbUserData cb, uint8_t *rc, uint16_t *state, uint16_t *time) :
+  _keyCount(keyCount), _cb(cb), _cbWord(nullptr), _rc(rc), _word(nullptr), _state(state), _time(time), _nextKey(0)
 {
-  UI_PRINT("\nUISwitch_User begin() ", _idCount);
-  UI_PRINTS(" ids");
+  for (uint8_t i = 0; i < PROFILE_COUNT - 1; i++)
+    _profTable[i] = _profile;
 }
 
-MD_UISwitch::keyResult_t MD_UISwitch_User::read(void)
+MD_UISwitch_Bank::MD_UISwitch_Bank(uint8_t keyCount, cbBankWord cb, bankWord_t *word, uint16_t *state, uint16_t *time) :
+  _keyCount(keyCount), _cb(nullptr), _cbWord(cb), _rc(nullptr), _word(word), _state(state), _time(time), _nextKey(0)
 {
-  bool b = false;
-  int16_t idx = KEY_IDX_UNDEF;
-  int16_t count = 0;
+  for (uint8_t i = 0; i < PROFILE_COUNT - 1; i++)
+    _profTable[i] = _profile;
+}
 
-  // work out which key is pressed
-  for (uint8_t i = 0; i < _idCount; i++)
+void MD_UISwitch_Bank::begin(void)
+{
+  UI_PRINT("\nUISwitch_Bank begin() ", _keyCount);
+  UI_PRINTS(" keys");
+
+  for (uint8_t i = 0; i < _keyCount; i++)
   {
-    if (_cb(_ids[i]))
+    if (_rc != nullptr) _rc[i] = 0;
+    _state[i] = 0;    // S_IDLE, KEY_NULL, S_WAIT_START, profile 0
+    _time[i] = 0;
+  }
+  if (_word != nullptr)
+  {
+    for (uint8_t w = 0; w < (_keyCount + 31) / 32; w++)
     {
-      if (idx == KEY_IDX_UNDEF) idx = i;  // only record the first one
-      count++;
+      _word[w].db.reset();
+      _word[w].busy = 0;
     }
   }
+  _nextKey = 0;
+}
+
+void MD_UISwitch_Bank::saveProfile(uint8_t p)
+{
+  if (p > 0 && p < PROFILE_COUNT)
+    _profTable[p - 1] = _profile;
+}
+
+void MD_UISwitch_Bank::setKeyProfile(uint8_t key, uint8_t p)
+{
+  if (key < _keyCount && p < PROFILE_COUNT)
+    _state[key] = (_state[key] & ~PK_PROFILE_MASK) | ((uint16_t)p << PK_PROFILE);
+}
+
+MD_UISwitch::keyResult_t MD_UISwitch_Bank::read(uint32_t now)
+{
+  keyEvent_t ev;
+
+  if (read(&ev, 1, now) == 0)
+    return(KEY_NULL);
+
+  _lastKey = ev.key;
+  return(ev.result);
+}
 
-  // if more than one key pressed, don't count anything
-  if (count == 1)   // we have a valid key
+uint8_t MD_UISwitch_Bank::read(keyEvent_t *ev, uint8_t evSize, uint32_t now)
+{
+  UI_STAT_READ(_stats);
+  uint8_t n = 0;
+  dbTiming_t dt = { _dbTiming.tc, 0, 0 };   // no room to keep the step times, so one step per read
+
+  if (_cbWord != nullptr)
+    return(readWords(ev, evSize, now));
+
+  for (uint8_t i = 0; i < _keyCount && n < evSize; i++)
   {
-    // is this the same as the previous key?
-    if (idx != _lastKeyIdx) processFSM(debounce(false, true), true); // reset the debounce and FSM
+    uint8_t key = _nextKey;
+    bool b = _cb(key);
+    uint16_t st = _state[key];
+    uint8_t p = (st >> PK_PROFILE) & 0x3;
+    fsmState_t fsm;
+    dbState_t db;
+    keyResult_t k;
+
+    if (++_nextKey >= _keyCount) _nextKey = 0;
+
+    // an inactive key in its idle state (all fields zero) stays that way
+    if (!b && (st & ~PK_PROFILE_MASK) == 0)
+      continue;
+
+    // unpack the key state, run the same debounce and FSM as other switches ...
+    fsm.state = (state_fsm)((st >> PK_FSM) & 0x7);
+    fsm.kPush = (keyResult_t)((st >> PK_PUSH) & 0x7);
+    fsm.timeActive = now - (uint16_t)((uint16_t)now - _time[key]);
+    db.RCstate = (state_db)((st >> PK_DB) & 0x3);
+    db.prevStatus = (st >> PK_PREV) & 0x1;
+    db.RC = _rc[key];
+
+#if UI_INSTRUMENT
+    {
+      state_db before = db.RCstate;
+      bool d = debounce(db, dt, b, 0);
 
-    b = (idx == _lastKeyIdx);
-    _lastKeyIdx = idx;
-    _lastKey = _ids[idx];
-    //UI_PRINT("\nKey idx ", _lastKeyIdx);
-    //UI_PRINT(" value ", _lastKey);
+      statDebounce(_stats, before, db, d);
+      k = processFSM(fsm, (p == 0) ? _profile : _profTable[p - 1], d, now);
+      statEvent(_stats, k);
+    }
+#else
+    k = processFSM(fsm, (p == 0) ? _profile : _profTable[p - 1], debounce(db, dt, b, 0), now);
+#endif
+    n = addEvents(*this, fsm, k, key, ev, n, evSize);
+
+    // ... and pack it away again
+    _state[key] = ((uint16_t)fsm.state << PK_FSM) | ((uint16_t)fsm.kPush << PK_PUSH) |
+                  ((uint16_t)db.RCstate << PK_DB) | ((uint16_t)db.prevStatus << PK_PREV) |
+                  ((uint16_t)p << PK_PROFILE);
+    _time[key] = (uint16_t)fsm.timeActive;
+    _rc[key] = db.RC;
   }
 
-  return(processFSM(debounce(b)));
+  return(n);
+}
+
+uint8_t MD_UISwitch_Bank::readWords(keyEvent_t *ev, uint8_t evSize, uint32_t now)
+// Read and debounce all the keys a word at a time, then run the FSM only for
+// the keys that are debounced active or still have processing in progress.
+{
+  uint8_t n = 0;
+  uint8_t words = (_keyCount + 31) / 32;
+
+  for (uint8_t w = 0; w < words; w++)
+  {
+    uint32_t sample = _cbWord(w);
+
+    if (w == words - 1 && (_keyCount & 0x1f) != 0)   // drop the bits past the last key
+      sample &= ((uint32_t)1 << (_keyCount & 0x1f)) - 1;
+    _word[w].db.update(sample);
+  }
+
+  for (uint16_t i = 0; i < _keyCount && n < evSize; i++)
+  {
+    uint8_t key = _nextKey;
+    uint8_t bit = key & 0x1f;
+    bankWord_t &kw = _word[key >> 5];
+    uint32_t todo = (kw.db.getState() | kw.busy) >> bit;
+    uint16_t st = _state[key];
+    uint8_t p = (st >> PK_PROFILE) & 0x3;
+    fsmState_t fsm;
+    bool b;
+    keyResult_t k;
+
+    if (todo == 0)
+    {
+      // nothing to do for the rest of this word, so go straight to the next one
+      uint8_t skip = 32 - bit;
+
+      if (skip > _keyCount - key) skip = _keyCount - key;
+      i += skip - 1;
+      _nextKey = (key + skip >= _keyCount) ? 0 : key + skip;
+      continue;
+    }
+
+    if (++_nextKey >= _keyCount) _nextKey = 0;
+
+    if ((todo & 1) == 0)    // idle key
+      continue;
+
+    // unpack the key state and run the FSM on the debounced state
+    b = (kw.db.getState() >> bit) & 1;
+    fsm.state = (state_fsm)((st >> PK_FSM) & 0x7);
+    fsm.kPush = (keyResult_t)((st >> PK_PUSH) & 0x7);
+    fsm.timeActive = now - (uint16_t)((uint16_t)now - _time[key]);
+
+    k = processFSM(fsm, (p == 0) ? _profile : _profTable[p - 1], b, now);
+    UI_STAT(statEvent(_stats, k));
+    n = addEvents(*this, fsm, k, key, ev, n, evSize);
+
+    // Pack it away again. The debounce fields are always S_WAIT_START, with
+    // the last state the FSM saw kept as the previous status for nextDeadline().
+    _state[key] = ((uint16_t)fsm.state << PK_FSM) | ((uint16_t)fsm.kPush << PK_PUSH) |
+                  ((uint16_t)b << PK_PREV) | ((uint16_t)p << PK_PROFILE);
+    _time[key] = (uint16_t)fsm.timeActive;
+
+    if (fsm.state == S_IDLE && fsm.kPush == KEY_NULL)
+      kw.busy &= ~((uint32_t)1 << bit);
+    else
+      kw.busy |= ((uint32_t)1 << bit);
+  }
+
+  return(n);
+}
+
+uint32_t MD_UISwitch_Bank::nextDeadline(uint32_t now)
+{
+  uint32_t t = DEADLINE_NONE;
+
+  // keys part way through the parallel debounce need the next read
+  if (_word != nullptr)
+  {
+    for (uint8_t w = 0; w < (_keyCount + 31) / 32; w++)
+      if (_word[w].db.getCounting() != 0)
+        return(0);
+  }
+
+  for (uint8_t key = 0; key < _keyCount && t != 0; key++)
+  {
+    uint16_t st = _state[key];
+    uint8_t p = (st >> PK_PROFILE) & 0x3;
+    fsmState_t fsm;
+    dbState_t db;
+    uint32_t d;
+
+    if ((st & ~PK_PROFILE_MASK) == 0)   // idle key
+      continue;
+
+    fsm.state = (state_fsm)((st >> PK_FSM) & 0x7);
+    fsm.kPush = (keyResult_t)((st >> PK_PUSH) & 0x7);
+    fsm.timeActive = now - (uint16_t)((uint16_t)now - _time[key]);
+    db.RCstate = (state_db)((st >> PK_DB) & 0x3);
+    db.prevStatus = (st >> PK_PREV) & 0x1;
+    db.RC = 0;      // only non-zero while debouncing, which needs the next read anyway
+
+    d = deadline(fsm, db, (p == 0) ? _profile : _profTable[p - 1], now);
+    if (d < t) t = d;
+  }
+
+  return(t);
 }
 // -----------------------------------------------
 
 // -----------------------------------------------
 // MD_UISwitch_Analog methods
 // -----------------------------------------------
-void MD_UISwitch_Analog::begin(void)
+static bool inWindow(uint16_t v, const MD_UISwitch_Analog::uiAnalogKeys_t &k)
+// True if the value is within the key tolerance window. Written to avoid
+// over or underflow at the ends of the range with 16 bit int.
 {
-  UI_PRINTS("\nUISwitch_Analog begin()");
-  pinMode(_pin, INPUT);
+  uint16_t d = (v > k.adcThreshold) ? v - k.adcThreshold : k.adcThreshold - v;
+
+  return(d <= k.adcTolerance);
 }
 
-MD_UISwitch::keyResult_t MD_UISwitch_Analog::read(void)
+void MD_UISwitch_Analog::buildLookup(const uiAnalogKeys_t *kt, uint8_t ktSize, uint8_t *lut, uint8_t shift)
 {
-  bool b = false;
-  uint16_t v = analogRead(_pin);
-  int16_t idx = KEY_IDX_UNDEF;
+  uint16_t size = lookupSize(shift);
+
+  for (uint16_t i = 0; i < size; i++)
+    lut[i] = LUT_NONE;
+
+  // mark the part of the table covered by each key window
+  for (uint8_t k = 0; k < ktSize; k++)
+  {
+    uint16_t lo = (kt[k].adcThreshold > kt[k].adcTolerance) ? kt[k].adcThreshold - kt[k].adcTolerance : 0;
+    uint32_t hi = (uint32_t)kt[k].adcThreshold + kt[k].adcTolerance;
+
+    if (lo > UI_ANALOG_MAX) continue;   // can never be read
+    if (hi > UI_ANALOG_MAX) hi = UI_ANALOG_MAX;
 
-  // work out what key this is
+    for (uint16_t i = lo >> shift; i <= (hi >> shift); i++)
+    {
+      if (lut[i] == LUT_NONE)
+        lut[i] = k;
+      else
+        lut[i] = LUT_SHARED;
+    }
+  }
+}
+
+void MD_UISwitch_Analog::begin(void)
+{
+  UI_PRINTS("\nUISwitch_Analog begin()");
+  UI_PIN_MODE(_pin, INPUT);
+
+  // check for overlapping key windows
+  _overlap = false;
   for (uint8_t i = 0; i < _ktSize; i++)
   {
-    if ((v >= (_kt[i].adcThreshold - _kt[i].adcTolerance)) &&
-        (v <= (_kt[i].adcThreshold + _kt[i].adcTolerance)))
+    for (uint8_t j = i + 1; j < _ktSize; j++)
     {
-      idx = i;
-      break;
+      uint16_t d = (_kt[i].adcThreshold > _kt[j].adcThreshold) ? 
+        _kt[i].adcThreshold - _kt[j].adcThreshold : _kt[j].adcThreshold - _kt[i].adcThreshold;
+
+      if (d <= (uint16_t)_kt[i].adcTolerance + _kt[j].adcTolerance)
+      {
+        UI_PRINT("\nOverlapping keys ", i);
+        UI_PRINT(" and ", j);
+        _overlap = true;
+      }
     }
   }
 
-  // is this a valid key the same as the previous key?
-  if (idx != KEY_IDX_UNDEF)
+  if (_lut != nullptr)
+    buildLookup(_kt, _ktSize, _lut, _lutShift);
+
+  // reset the filters
+  _histCount = 0;
+  _candIdx = _keyIdx = KEY_IDX_UNDEF;
+  _candCount = _settle;
+}
+
+uint16_t MD_UISwitch_Analog::filter(uint16_t v)
+{
+  uint16_t a, b, m;
+
+  if (_histCount < 2)   // fill up the history first
   {
-    // is this the same as the previous key?
-    if (idx != _lastKeyIdx) processFSM(debounce(false, true), true); // reset the FSM
+    _hist[_histCount++] = v;
+    return(v);
+  }
+
+  a = _hist[0];
+  b = _hist[1];
+  _hist[0] = b;
+  _hist[1] = v;
+
+  // median of a, b and v
+  if (a > b) { m = a; a = b; b = m; }   // now a <= b
+  if (v <= a) return(a);
+  if (v >= b) return(b);
+  return(v);
+}
+
+int16_t MD_UISwitch_Analog::settle(int16_t idx)
+{
+  if (idx != _candIdx)    // start counting a new key
+  {
+    _candIdx = idx;
+    _candCount = 0;
+  }
+  if (_candCount < _settle) _candCount++;
+  if (_candCount >= _settle) _keyIdx = _candIdx;
+
+  return(_keyIdx);
+}
+
+int16_t MD_UISwitch_Analog::findKey(uint16_t v)
+{
+  uint8_t i = LUT_SHARED;
 
-    b = (idx == _lastKeyIdx);
-    _lastKeyIdx = idx;
+  // check the lookup table first, if there is one
+  if (v <= UI_ANALOG_MAX)
+  {
+    if (_lut != nullptr)
+      i = _lut[v >> _lutShift];
+    else if (_lutP != nullptr)
+      i = UI_PGM_READ_BYTE(_lutP + (v >> _lutShift));
+  }
+
+  if (i == LUT_NONE)
+    return(KEY_IDX_UNDEF);
+
+  if (i != LUT_SHARED)
+    return(inWindow(v, _kt[i]) ? i : KEY_IDX_UNDEF);
+
+  // no lookup or more than one key, so search the table
+  for (i = 0; i < _ktSize; i++)
+  {
+    if (inWindow(v, _kt[i]))
+      return(i);
+  }
+
+  return(KEY_IDX_UNDEF);
+}
+
+MD_UISwitch_Analog *MD_UISwitch_Analog::_adcAsync = nullptr;
+
+void MD_UISwitch_Analog::enableAsyncRead(boolean f)
+{
+  if (f && _adcAsync != nullptr && _adcAsync != this)
+    return;   // another switch is using the mode
+
+  if (_async) adcWait();
+  if (f)
+  {
+    _adcAsync = this;
+    UI_ANALOG_READ(_pin);   // let the core set up the ADC and reference
+  }
+  else if (_adcAsync == this)
+    _adcAsync = nullptr;
+
+  _async = f;
+  _adcBusy = _adcHeld = false;
+}
+
+void MD_UISwitch_Analog::adcWait(void)
+// Wait for any conversion started by the async switch and keep the result
+// for it, so that the ADC can be used
+{
+  MD_UISwitch_Analog *s = _adcAsync;
+
+  if (s == nullptr || !s->_adcBusy)
+    return;
+
+  UI_ANALOG_WAIT();
+  s->_adcValue = UI_ANALOG_RESULT(s->_pin);
+  s->_adcHeld = true;
+  s->_adcBusy = false;
+}
+
+MD_UISwitch::keyResult_t MD_UISwitch_Analog::read(uint32_t now)
+{
+  UI_STAT_READ(_stats);
+  uint16_t v = 0;
+  int16_t idx;
+
+  if (!_async)
+  {
+    adcWait();
+    v = UI_ANALOG_READ(_pin);
+  }
+  else
+  {
+    bool sample = _adcBusy || _adcHeld;
+
+    // collect the previous conversion, if it is done, then start the next
+    if (_adcBusy && !UI_ANALOG_READY())
+      return(KEY_NULL);
+
+    if (sample) v = _adcHeld ? _adcValue : UI_ANALOG_RESULT(_pin);
+    _adcHeld = false;
+    UI_ANALOG_START(_pin);
+    _adcBusy = true;
+
+    if (!sample)    // nothing to process on the first call
+      return(KEY_NULL);
+  }
+
+  if (_median) v = filter(v);
+  idx = findKey(v);
+  if (_settle > 1) idx = settle(idx);
+
+  if (idx != KEY_IDX_UNDEF)
+  {
     _lastKey = _kt[idx].value;
-    UI_PRINT("\nKey idx ", _lastKeyIdx);
+    UI_PRINT("\nKey idx ", idx);
     UI_PRINT(" value ", _lastKey);
   }
 
-  return(processFSM(debounce(b)));
+  return(processKey(*this, _profile, (idx != KEY_IDX_UNDEF) ? 1 : 0, idx, now));
 }
 // -----------------------------------------------
 
@@ -437,55 +909,425 @@ void MD_UISwitch_Matrix::begin(void)
 {
   UI_PRINTS("\nUISwitch_Matrix begin()");
 
-  // initialize the hardware
-  for (uint8_t i = 0; i < _rows; i++) 
-    pinMode(_rowPin[i], INPUT_PULLUP);
+  uint8_t nDrive = _driveRows ? _rows : _cols;
+  uint8_t nSense = _driveRows ? _cols : _rows;
+  uint8_t *drivePin = _driveRows ? _rowPin : _colPin;
+  uint8_t *sensePin = _driveRows ? _colPin : _rowPin;
+
+  // initialize the hardware, the driven lines are high impedance until scanned
+  for (uint8_t i = 0; i < nSense; i++) 
+    UI_PIN_MODE(sensePin[i], INPUT_PULLUP);
+  for (uint8_t i = 0; i < nDrive; i++)
+    UI_PIN_MODE(drivePin[i], INPUT);
+
+  _portIO = false;
+#if UI_PORT_DRIVE
+  // look up the port registers for every line
+  _portIO = (nDrive <= UI_MATRIX_LINES && nSense <= UI_MATRIX_LINES);
+  _drivePorts = 0;
+  for (uint8_t i = 0; _portIO && i < nDrive; i++)
+  {
+    volatile UI_PORT_TYPE *reg = UI_PORT_MODE(drivePin[i]);
+    uint8_t j = 0;
+
+    while (j < _drivePorts && _driveMode[j] != reg)
+      j++;
+    if (j == _drivePorts)   // new output port
+    {
+      _driveMode[_drivePorts] = reg;
+      _driveOut[_drivePorts] = UI_PORT_OUTPUT(drivePin[i]);
+      _driveAll[_drivePorts] = 0;
+      _drivePorts++;
+    }
+    _driveIdx[i] = j;
+    _driveMask[i] = UI_PORT_MASK(drivePin[i]);
+    _driveAll[j] |= _driveMask[i];
+    _portIO = (reg != nullptr && _driveOut[j] != nullptr);
+  }
+  _sensePorts = 0;
+  for (uint8_t i = 0; _portIO && i < nSense; i++)
+  {
+    volatile UI_PORT_TYPE *reg = UI_PORT_INPUT(sensePin[i]);
+    uint8_t j = 0;
+
+    while (j < _sensePorts && _senseIn[j] != reg)
+      j++;
+    if (j == _sensePorts)   // new input port
+      _senseIn[_sensePorts++] = reg;
+    _senseIdx[i] = j;
+    _senseMask[i] = UI_PORT_MASK(sensePin[i]);
+    _portIO = (reg != nullptr);
+  }
 
-  // columns initialize during scanning
-  //for (uint8_t i = 0; i < _rows; i++)
-  //  pinMode(_colPin[i], OUTPUT);
+  // with the output bit clear, setting the mode bit drives the line LOW
+  for (uint8_t i = 0; _portIO && i < _drivePorts; i++)
+    UI_PORT_CLEAR(_driveOut[i], _driveAll[i]);
+#endif
+  _frameLine = 0;
+  UI_PRINT(" drive ", _driveRows ? 'R' : 'C');
+  UI_PRINT(" ports ", _portIO);
 }
 
-MD_UISwitch::keyResult_t MD_UISwitch_Matrix::read(void)
+bool MD_UISwitch_Matrix::probe(void)
+// Any key pressed connects one of the driven lines to a line that is read.
+// As all the driven lines are LOW together there is no conflict between them.
 {
   bool b = false;
-  int16_t idx = KEY_IDX_UNDEF;
-  int16_t count = 0;
+  uint8_t nDrive = _driveRows ? _rows : _cols;
+  uint8_t nSense = _driveRows ? _cols : _rows;
 
-  // scan the keypad and stop at the first key detected
-  for (uint8_t c = 0; c < _cols; c++) 
+  if (_portIO)
   {
-    pinMode(_colPin[c], OUTPUT);
-    digitalWrite(_colPin[c], LOW);	    // column pulse
-    for (uint8_t r = 0; r < _rows; r++)
+#if UI_PORT_DRIVE
+    UI_PORT_TYPE v[UI_MATRIX_LINES];
+
+    for (uint8_t i = 0; i < _drivePorts; i++)
+      UI_PORT_SET(_driveMode[i], _driveAll[i]);     // all lines LOW
+    for (uint8_t i = 0; i < _sensePorts; i++)
+      v[i] = UI_PORT_READ(_senseIn[i]);
+    for (uint8_t i = 0; i < _drivePorts; i++)
     {
-      if (digitalRead(_rowPin[r]) == LOW)
+      UI_PORT_SET(_driveOut[i], _driveAll[i]);      // end pulse
+      UI_PORT_CLEAR(_driveMode[i], _driveAll[i]);   // set high impedance
+      UI_PORT_CLEAR(_driveOut[i], _driveAll[i]);
+    }
+    for (uint8_t s = 0; s < nSense && !b; s++)
+      b = ((v[_senseIdx[s]] & _senseMask[s]) == 0);
+#endif
+  }
+  else
+  {
+    uint8_t *drivePin = _driveRows ? _rowPin : _colPin;
+    uint8_t *sensePin = _driveRows ? _colPin : _rowPin;
+
+    for (uint8_t d = 0; d < nDrive; d++)
+    {
+      UI_PIN_MODE(drivePin[d], OUTPUT);
+      UI_DIGITAL_WRITE(drivePin[d], LOW);
+    }
+    for (uint8_t s = 0; s < nSense && !b; s++)
+      b = (UI_DIGITAL_READ(sensePin[s]) == LOW);
+    for (uint8_t d = 0; d < nDrive; d++)
+    {
+      UI_DIGITAL_WRITE(drivePin[d], HIGH);
+      UI_PIN_MODE(drivePin[d], INPUT);
+    }
+  }
+
+  return(b);
+}
+
+uint16_t MD_UISwitch_Matrix::scan(uint8_t *active, uint8_t size)
+// Scan the keypad and save the index of the first size keys detected.
+// Return the total number of keys detected.
+{
+  return(scanLines(0, _driveRows ? _rows : _cols, active, size, 0));
+}
+
+uint16_t MD_UISwitch_Matrix::scanLines(uint8_t first, uint8_t last, uint8_t *active, uint8_t size, uint16_t count)
+// Scan the driven lines from first up to last, adding the keys detected to 
+// the count already found. Return the new count.
+{
+  if (_portIO)
+    return(scanPorts(first, last, active, size, count));
+  else
+    return(scanPins(first, last, active, size, count));
+}
+
+uint8_t MD_UISwitch_Matrix::getScanCalls(void)
+{
+  uint8_t nDrive = _driveRows ? _rows : _cols;
+
+  if (_slice == 0 || _slice >= nDrive)
+    return(1);
+
+  return((nDrive + _slice - 1) / _slice);
+}
+
+bool MD_UISwitch_Matrix::scanSlice(uint8_t size, bool idle)
+// Scan the next _slice lines into _frameKeys, return true when the matrix
+// has been completely scanned and _frameCount holds the keys found.
+{
+  uint8_t nDrive = _driveRows ? _rows : _cols;
+  uint8_t last;
+
+  if (_frameLine == 0)    // start of a new scan
+  {
+    _frameCount = 0;
+    if (idle && !probe())
+      return(true);
+  }
+
+  last = (nDrive - _frameLine > _slice) ? _frameLine + _slice : nDrive;
+  _frameCount = scanLines(_frameLine, last, _frameKeys, size, _frameCount);
+  _frameLine = (last == nDrive) ? 0 : last;
+
+  return(_frameLine == 0);
+}
+
+uint16_t MD_UISwitch_Matrix::scanPins(uint8_t first, uint8_t last, uint8_t *active, uint8_t size, uint16_t count)
+{
+  uint8_t nSense = _driveRows ? _cols : _rows;
+  uint8_t *drivePin = _driveRows ? _rowPin : _colPin;
+  uint8_t *sensePin = _driveRows ? _colPin : _rowPin;
+
+  for (uint8_t d = first; d < last; d++) 
+  {
+    UI_PIN_MODE(drivePin[d], OUTPUT);
+    UI_DIGITAL_WRITE(drivePin[d], LOW);	    // line pulse
+    for (uint8_t s = 0; s < nSense; s++)
+    {
+      if (UI_DIGITAL_READ(sensePin[s]) == LOW)
+      {
+        if (count < size) active[count] = keyIndex(d, s);
+        count++;
+        UI_PRINT("\nD:", d);
+        UI_PRINT(" S:", s);
+      }
+    }
+    UI_DIGITAL_WRITE(drivePin[d], HIGH);    // end line pulse
+    UI_PIN_MODE(drivePin[d], INPUT);        // set high impedance
+  }
+
+  return(count);
+}
+
+uint16_t MD_UISwitch_Matrix::scanPorts(uint8_t first, uint8_t last, uint8_t *active, uint8_t size, uint16_t count)
+{
+#if UI_PORT_DRIVE
+  uint8_t nSense = _driveRows ? _cols : _rows;
+  UI_PORT_TYPE v[UI_MATRIX_LINES];
+
+  for (uint8_t d = first; d < last; d++) 
+  {
+    volatile UI_PORT_TYPE *mode = _driveMode[_driveIdx[d]];
+    volatile UI_PORT_TYPE *out = _driveOut[_driveIdx[d]];
+
+    UI_PORT_SET(mode, _driveMask[d]);    // line pulse, output bit is LOW
+    for (uint8_t i = 0; i < _sensePorts; i++)
+      v[i] = UI_PORT_READ(_senseIn[i]);
+    for (uint8_t s = 0; s < nSense; s++)
+    {
+      if ((v[_senseIdx[s]] & _senseMask[s]) == 0)
       {
-        if (idx == KEY_IDX_UNDEF) idx = (r * _cols) + c;
+        if (count < size) active[count] = keyIndex(d, s);
         count++;
-        UI_PRINT("\nC:", c);
-        UI_PRINT(" R:", r);
-        UI_PRINT(" idx:", idx);
+        UI_PRINT("\nD:", d);
+        UI_PRINT(" S:", s);
       }
     }
-    digitalWrite(_colPin[c], HIGH);     // end column pulse
-    pinMode(_colPin[c], INPUT);         // set high impedance
+    UI_PORT_SET(out, _driveMask[d]);     // end line pulse
+    UI_PORT_CLEAR(mode, _driveMask[d]);  // set high impedance
+    UI_PORT_CLEAR(out, _driveMask[d]);
   }
+#else
+  (void)first;
+  (void)last;
+  (void)active;
+  (void)size;
+#endif
+
+  return(count);
+}
+
+bool MD_UISwitch_Matrix::ghostCheck(uint8_t *active, uint8_t count)
+// A ghost key appears at the 4th corner of a rectangle when the keys at the
+// other three corners are pressed. This needs two keys in the same row and a
+// third key in the same column as one of them.
+{
+  for (uint8_t i = 0; i < count; i++)
+    for (uint8_t j = i + 1; j < count; j++)
+    {
+      if (active[i] / _cols != active[j] / _cols)   // not the same row
+        continue;
+
+      for (uint8_t k = 0; k < count; k++)
+        if (k != i && k != j &&
+            (active[k] % _cols == active[i] % _cols || active[k] % _cols == active[j] % _cols))
+          return(true);
+    }
+
+  return(false);
+}
 
-  // if more than one key pressed, don't count anything
-  if (count == 1)  // we have a valid key
+void MD_UISwitch_Matrix::enableNKRO(keySlot_t *slot, uint8_t count)
+{
+  if (slot == nullptr || count == 0)
+  {
+    _slot = nullptr;
+    _slotCount = 0;
+  }
+  else
   {
-    // is this the same as the previous key?
-    if (idx != _lastKeyIdx) processFSM(debounce(false, true), true); // reset the FSM
+    _slot = slot;
+    _slotCount = count;
+    for (uint8_t i = 0; i < _slotCount; i++)
+      _slot[i].idx = KEY_SLOT_FREE;
+  }
+  _ghost = false;
+}
+
+MD_UISwitch::keyResult_t MD_UISwitch_Matrix::read(uint32_t now)
+{
+  uint8_t idx = 0;
+  uint16_t count;
 
-    b = (idx == _lastKeyIdx);
-    _lastKeyIdx = idx;
+  // NKRO mode returns the first event, the rest are picked up by the next calls
+  if (_slot != nullptr)
+  {
+    keyEvent_t ev;
+
+    if (read(&ev, 1, now) == 0)
+      return(KEY_NULL);
+
+    _lastKey = ev.key;
+    return(ev.result);
+  }
+
+  UI_STAT_READ(_stats);
+  if (_slice != 0)   // incremental scan, process the keys once it is complete
+  {
+    if (!scanSlice(1, isIdle(_fsm, _db)))
+      return(KEY_NULL);
+    count = _frameCount;
+    idx = _frameKeys[0];
+  }
+  else if (isIdle(_fsm, _db) && !probe())   // only scan the whole matrix if the probe finds a key
+    count = 0;
+  else
+    count = scan(&idx, 1);
+
+  if (count == 1)
+  {
     _lastKey = _kt[idx];
-    UI_PRINT("\nKey idx ", _lastKey);
+    UI_PRINT("\nKey idx ", idx);
     UI_PRINT(" value ", _lastKey);
   }
 
-  return(processFSM(debounce(b)));
+  return(processKey(*this, _profile, count, idx, now));
+}
+
+uint8_t MD_UISwitch_Matrix::read(keyEvent_t *ev, uint8_t evSize, uint32_t now)
+{
+  uint8_t buf[NKRO_SCAN_MAX];
+  uint8_t *active = buf;
+  uint16_t count;
+  uint8_t n = 0;
+  uint32_t us;
+  bool tracking = false;
+
+  if (_slot == nullptr)   // single key mode
+    return(MD_UISwitch::read(ev, evSize, now));
+
+  UI_STAT_READ(_stats);
+  // only scan the whole matrix if a key is being tracked or the probe finds one
+  for (uint8_t i = 0; i < _slotCount && !tracking; i++)
+    tracking = (_slot[i].idx != KEY_SLOT_FREE);
+
+  if (_slice != 0)   // incremental scan, process the keys once it is complete
+  {
+    if (!scanSlice(NKRO_SCAN_MAX, !tracking))
+      return(n);
+    active = _frameKeys;
+    count = _frameCount;
+  }
+  else if (!tracking && !probe())
+  {
+    _ghost = false;
+    return(n);
+  }
+  else
+    count = scan(active, NKRO_SCAN_MAX);
+  _ghost = (count > NKRO_SCAN_MAX) || (_ghostCheck && ghostCheck(active, count));
+  if (count > NKRO_SCAN_MAX) count = NKRO_SCAN_MAX;
+  us = dbTime(_dbTiming);   // one time sample for all the keys
+
+  // run the debounce and FSM for the keys being tracked
+  for (uint8_t i = 0; i < _slotCount && n < evSize; i++)
+  {
+    keySlot_t *ks = &_slot[i];
+    keyResult_t k;
+    bool b = false;
+
+    if (ks->idx == KEY_SLOT_FREE) continue;
+
+    for (uint8_t j = 0; j < count && !b; j++)
+      b = (active[j] == ks->idx);
+
+#if UI_INSTRUMENT
+    {
+      state_db before = ks->db.RCstate;
+      bool d = debounce(ks->db, _dbTiming, b, us);
+
+      statDebounce(_stats, before, ks->db, d);
+      k = processFSM(ks->fsm, _profile, d, now);
+      statEvent(_stats, k);
+    }
+#else
+    k = processFSM(ks->fsm, _profile, debounce(ks->db, _dbTiming, b, us), now);
+#endif
+    n = addEvents(*this, ks->fsm, k, _kt[ks->idx], ev, n, evSize);
+
+    // free the slot once the key is released and there is nothing more to report
+    if (!b && isIdle(ks->fsm, ks->db))
+      ks->idx = KEY_SLOT_FREE;
+  }
+
+  // allocate slots for newly pressed keys, unless this could be a ghost
+  if (!_ghost)
+  {
+    for (uint8_t j = 0; j < count; j++)
+    {
+      uint8_t freeSlot = KEY_SLOT_FREE;
+      bool found = false;
+
+      for (uint8_t i = 0; i < _slotCount && !found; i++)
+      {
+        found = (_slot[i].idx == active[j]);
+        if (_slot[i].idx == KEY_SLOT_FREE && freeSlot == KEY_SLOT_FREE) freeSlot = i;
+      }
+
+      if (!found && freeSlot != KEY_SLOT_FREE)  // new key, if there is room for it
+      {
+        UI_PRINT("\nNKRO slot ", freeSlot);
+        UI_PRINT(" idx ", active[j]);
+        _slot[freeSlot].idx = active[j];
+        debounce(_slot[freeSlot].db, _dbTiming, false, us, true);
+        processFSM(_slot[freeSlot].fsm, _profile, false, now, true);
+      }
+    }
+  }
+
+  return(n);
+}
+
+uint32_t MD_UISwitch_Matrix::nextDeadline(uint32_t now)
+{
+  uint32_t t = DEADLINE_NONE;
+
+  if (_frameLine != 0)    // part way through an incremental scan
+    return(0);
+
+  if (_slot == nullptr)   // single key mode
+    return(MD_UISwitch::nextDeadline(now));
+
+  for (uint8_t i = 0; i < _slotCount && t != 0; i++)
+  {
+    keySlot_t *ks = &_slot[i];
+    uint32_t d;
+
+    if (ks->idx == KEY_SLOT_FREE) continue;
+
+    // a key in a slot that is completely idle has only just been allocated,
+    // or is about to be freed, and needs the next read
+    if (isIdle(ks->fsm, ks->db))
+      d = 0;
+    else
+      d = deadline(ks->fsm, ks->db, _profile, now);
+    if (d < t) t = d;
+  }
+
+  return(t);
 }
 // -----------------------------------------------
 
@@ -496,64 +1338,255 @@ void MD_UISwitch_4017KM::begin(void)
 {
   UI_PRINTS("\nUISwitch_4017KM begin()");
 
+  _frameStep = 0;
+
   // initialize the hardware
-  digitalWrite(_pinClk, LOW);
-  pinMode(_pinClk, OUTPUT);
-  pinMode(_pinKey, INPUT);
+  UI_DIGITAL_WRITE(_pinClk, LOW);
+  UI_PIN_MODE(_pinClk, OUTPUT);
+  UI_PIN_MODE(_pinKey, INPUT);
   if (_pinRst != 0)
   {
-    pinMode(_pinRst, OUTPUT);
-    digitalWrite(_pinRst, LOW);
+    UI_PIN_MODE(_pinRst, OUTPUT);
+    UI_DIGITAL_WRITE(_pinRst, LOW);
+  }
+  if (_pinProbe != 0)
+  {
+    UI_PIN_MODE(_pinProbe, OUTPUT);
+    UI_DIGITAL_WRITE(_pinProbe, LOW);
   }
 }
 
 void MD_UISwitch_4017KM::reset(void)
 {
-  digitalWrite(_pinRst, HIGH);
-  delayMicroseconds(1);
-  digitalWrite(_pinRst, LOW);
+  UI_DIGITAL_WRITE(_pinRst, HIGH);
+  UI_DELAY_US(1);
+  UI_DIGITAL_WRITE(_pinRst, LOW);
 }
 
 void MD_UISwitch_4017KM::clock(void)
 {
-  digitalWrite(_pinClk, HIGH);
-  // delayMicroseconds(1); // may not be needed!
-  digitalWrite(_pinClk, LOW);
+  UI_DIGITAL_WRITE(_pinClk, HIGH);
+  // UI_DELAY_US(1); // may not be needed!
+  UI_DIGITAL_WRITE(_pinClk, LOW);
 }
 
-MD_UISwitch::keyResult_t MD_UISwitch_4017KM::read(void)
+bool MD_UISwitch_4017KM::probe(void)
 {
-  bool b = false;
-  int16_t idx = KEY_IDX_UNDEF;
-  int16_t count = 0;
+  bool b;
 
-  reset();
+  UI_DIGITAL_WRITE(_pinProbe, HIGH);
+  b = (UI_DIGITAL_READ(_pinKey) == HIGH);
+  UI_DIGITAL_WRITE(_pinProbe, LOW);
+
+  return(b);
+}
+
+MD_UISwitch::keyResult_t MD_UISwitch_4017KM::read(uint32_t now)
+{
+  UI_STAT_READ(_stats);
+  uint8_t last;
 
-  // scan the keypad and stop at the first key detected
-  for (int16_t i = 0; i<_numKeys; i++)
+  if (_frameStep == 0)    // start of a new scan
+  {
+    _frameCount = 0;
+    _frameIdx = KEY_IDX_UNDEF;
+
+    // only clock through the keys if there is no probe pin or the probe finds a key
+    if (_pinProbe != 0 && isIdle(_fsm, _db) && !probe())
+      return(processKey(*this, _profile, 0, KEY_IDX_UNDEF, now));
+
+    reset();
+  }
+
+  // scan the next part of the keypad and remember the first key detected
+  last = (_slice == 0 || _numKeys - _frameStep <= _slice) ? _numKeys : _frameStep + _slice;
+  for (uint8_t i = _frameStep; i < last; i++)
   {
     // read and advance the counter	
-    if (digitalRead(_pinKey) == HIGH)
+    if (UI_DIGITAL_READ(_pinKey) == HIGH)
     {
-      if (idx == KEY_IDX_UNDEF) idx = i;
-      count++;
+      if (_frameIdx == KEY_IDX_UNDEF) _frameIdx = i;
+      _frameCount++;
     }
     clock();    // advance the 4017 counter
   }
 
-  // if more than one key pressed, don't count anything
-  if (count == 1)  // we have a valid key
-  {
-    // is this the same as the previous key?
-    if (idx != _lastKey) processFSM(debounce(false, true), true); // reset the FSM
+  _frameStep = (last == _numKeys) ? 0 : last;
+  if (_frameStep != 0)    // keys processed once the scan is complete
+    return(KEY_NULL);
 
-    b = (idx == _lastKeyIdx);
-    _lastKeyIdx = idx;
-    _lastKey = idx;
+  if (_frameCount == 1)
+  {
+    _lastKey = _frameIdx;
     UI_PRINT("\nKey idx ", _lastKey);
-    UI_PRINT(" value ", _lastKey);
   }
 
-  return(processFSM(debounce(b)));
+  return(processKey(*this, _profile, _frameCount, _frameIdx, now));
+}
+// -----------------------------------------------
+// MD_UISwitch_Queue methods
+// -----------------------------------------------
+MD_UISwitch_Queue::MD_UISwitch_Queue(queueEvent_t *buf, uint8_t size) :
+  _buf(buf), _head(0), _tail(0), _overflow(0)
+{
+  // use the largest power of 2 that fits in the buffer
+  if (size > 128) size = 128;
+  _mask = 1;
+  while (_mask <= size / 2) _mask <<= 1;
+  _mask--;
+  if (size == 0) _buf = nullptr;
+}
+
+bool MD_UISwitch_Queue::push(uint8_t key, MD_UISwitch::keyResult_t result, uint32_t time)
+{
+  uint8_t h = _head;
+
+  if (_buf == nullptr || (uint8_t)(h - _tail) > _mask)   // full
+  {
+    _overflow = _overflow + 1;
+    return(false);
+  }
+
+  queueEvent_t *e = &_buf[h & _mask];
+
+  e->time = time;
+  e->key = key;
+  e->result = result;
+  UI_MEMORY_BARRIER();    // event written before it is published
+  _head = h + 1;
+
+  return(true);
+}
+
+MD_UISwitch::keyResult_t MD_UISwitch_Queue::scan(MD_UISwitch &s)
+{
+  uint32_t now = UI_MILLIS();
+  MD_UISwitch::keyResult_t k = s.read(now);
+
+  if (k != MD_UISwitch::KEY_NULL)
+    push(s.getKey(), k, now);
+
+  return(k);
+}
+
+bool MD_UISwitch_Queue::pop(queueEvent_t &e)
+{
+  return(pop(&e, 1) == 1);
+}
+
+uint8_t MD_UISwitch_Queue::pop(queueEvent_t *ev, uint8_t size)
+{
+  uint8_t t = _tail;
+  uint8_t n = (uint8_t)(_head - t);
+
+  UI_MEMORY_BARRIER();    // head read before the events it publishes
+  if (n > size) n = size;
+  for (uint8_t i = 0; i < n; i++)
+    ev[i] = _buf[(uint8_t)(t + i) & _mask];
+  UI_MEMORY_BARRIER();    // events copied before the space is released
+  _tail = t + n;
+
+  return(n);
+}
+
+uint16_t MD_UISwitch_Queue::getOverflow(void)
+{
+  uint16_t v;
+
+  // the producer may change the count part way through a multi-byte read
+  do { v = _overflow; } while (v != _overflow);
+
+  return(v);
+}
+// -----------------------------------------------
+
+// MD_UISwitch_Group methods
+// -----------------------------------------------
+void MD_UISwitch_Group::begin(void)
+{
+  UI_PRINT("\nUISwitch_Group begin() ", _count);
+  UI_PRINTS(" switches");
+
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    _sw[i]->begin();
+    _state[i].wait = true;
+  }
+  _next = 0;
+  _passLeft = 0;
+  _wake = true;
+}
+
+uint8_t MD_UISwitch_Group::read(groupEvent_t *ev, uint8_t evSize, uint32_t now)
+{
+  uint8_t n = 0;
+
+  // Start a pass reading all the switches once any pass still in progress
+  // is finished. A wake() after this starts another pass, as the switches
+  // may already have been read.
+  if (_passLeft == 0 && (_wake || (now - _timeIdle >= _idleTime)))
+  {
+    _wake = false;
+    _timeIdle = now;
+    _passLeft = _count;
+  }
+
+  for (uint8_t i = 0; i < _count && n < evSize; i++)
+  {
+    groupState_t *e = &_state[_next];
+    MD_UISwitch::keyEvent_t kev[EVENT_MAX];
+    uint8_t m;
+    uint32_t d;
+
+    // skip switches waiting for an input change, or with a timer not yet due,
+    // unless they are still to be read in the pass
+    if (_passLeft != 0)
+      _passLeft--;
+    else if (e->wait || (int32_t)(now - e->due) < 0)
+    {
+      if (++_next >= _count) _next = 0;
+      continue;
+    }
+
+    m = _sw[_next]->read(kev, (evSize - n < EVENT_MAX) ? evSize - n : EVENT_MAX, now);
+    for (uint8_t j = 0; j < m; j++)
+    {
+      ev[n].id = _next;
+      ev[n].key = kev[j].key;
+      ev[n++].result = kev[j].result;
+    }
+
+    // work out when this switch next needs attention
+    d = _sw[_next]->nextDeadline(now);
+    e->wait = (d == MD_UISwitch::DEADLINE_NONE);
+    e->due = now + d;
+
+    if (++_next >= _count) _next = 0;
+  }
+
+  return(n);
+}
+
+uint32_t MD_UISwitch_Group::nextDeadline(uint32_t now)
+{
+  uint32_t t = MD_UISwitch::DEADLINE_NONE;
+
+  if (_wake || _passLeft != 0) return(0);
+
+  if (_idleTime != 0)
+    t = (now - _timeIdle >= _idleTime) ? 0 : _idleTime - (now - _timeIdle);
+
+  for (uint8_t i = 0; i < _count && t != 0; i++)
+  {
+    int32_t d;
+
+    if (_state[i].wait) continue;
+
+    d = (int32_t)(_state[i].due - now);
+    if (d <= 0) t = 0;
+    else if ((uint32_t)d < t) t = d;
+  }
+
+  return(t);
 }
 // -----------------------------------------------
@@ -23,9 +23,33 @@ Switch arrangements handled by the library are:
 - Analog resistor ladder switches (MD_Switch_Analog class)
 - Keypad matrix (MD_Switch_Matrix class)
 - Keypad matrix using 4017 IC (MD_Matrix_4017KM class)
+- Large banks of user managed signals (MD_UISwitch_Bank class)
+
+Switches of any type can be managed together as a group (MD_UISwitch_Group class),
+and key events can be passed from an interrupt routine to the main loop through a
+lock-free event queue (MD_UISwitch_Queue class).
+
+Setting UI_INSTRUMENT to 1 compiles in counters and timing for each switch
+object, to measure the read() time and the delay from a key edge to its event
+(see MD_UISwitch::getStats() and MD_UISwitch::getEventTime()).
+
+Setting UI_RECORD to 1 allows the input to a switch to be recorded on the
+target (MD_UISwitch_Recorder class) and replayed through the same debounce and
+FSM off-target (extras/host/MD_UISwitch_Replay.h).
+
+Setting UI_FSM_TABLE to 1 runs the key press FSM from a transition table in
+PROGMEM, shared by every switch profile, instead of the switch statement
+that is compiled for each profile. The switch statement is the default as
+it is faster and drops the code for options a fixed profile does not enable.
+
+Where switches are always used directly, rather than through a pointer to
+the MD_UISwitch base class, the template classes avoid virtual calls. New
+switch types can be built on MD_UISwitch_Static, and MD_UISwitch_DigitalT 
+also fixes the pins and options at compile time.
 
 See Also
 - \subpage pageRevisionHistory
+- \subpage pageHAL
 - \subpage pageCopyright
 - \subpage pageDonation
 
@@ -50,6 +74,34 @@ License along with this library; if not, write to the Free Software
 Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
 
 \page pageRevisionHistory Revision History
+Oct 2026 version 2.3.0
+- Added hardware abstraction macros and host (Linux) simulation HAL
+- Added Benchmark example
+- MD_UISwitch_Digital reads switch pins sharing a hardware port in one register access
+- Added N-Key Rollover mode and ghost detection to MD_UISwitch_Matrix, NKRO example
+- Added MD_UISwitch_Bank for many switches with packed per-key state and shared profiles
+- Added MD_UISwitch_Queue lock-free event queue for interrupt driven scanning, EventQueue example
+- Added nextDeadline() so applications can sleep between timed events, LowPower example
+- Added read(now) to process switches against a given time, and poll() to read a group of switches with one clock read
+- Added MD_UISwitch_Group to read a mix of switch types with one call, Group example
+- Added MD_UISwitch_DigitalT template for switches with pins and options fixed at compile time
+- Added MD_UISwitch_Static template base class for switches without virtual methods, Static example
+- Added optional RAM or PROGMEM lookup table and overlapping window check to MD_UISwitch_Analog, AnalogLookup example
+- Fixed possible MD_UISwitch_Analog key window underflow/overflow with 16 bit int
+- Added enableAsyncRead() to MD_UISwitch_Analog so read() does not wait for the analog conversion
+- Added median filter and settle count to MD_UISwitch_Analog to stop key changes while the ladder voltage settles
+- MD_UISwitch_Matrix scans using the port registers where possible, setDriveRows() to drive the rows instead of the columns
+- MD_UISwitch_Matrix and MD_UISwitch_4017KM (with setProbePin()) check all keys in one step while idle
+- Added setScanSlice() to MD_UISwitch_Matrix and MD_UISwitch_4017KM to spread a scan over several read() calls
+- Added bulk (bit mask) callback option to MD_UISwitch_User to read all the ids in one call
+- Added MD_UISwitch_VDebounce parallel debounce and word callback option to MD_UISwitch_Bank
+- Added setDebounceTime() to time the debounce filter independently of the read() rate, with selectable time constant, host check MD_UISwitch_DebounceCheck
+- Added optional instrumentation (UI_INSTRUMENT) with switch counters, read() time histogram and event times
+- Added optional input recorder (UI_RECORD) MD_UISwitch_Recorder and host replay of recordings
+- read(keyEvent_t*, uint8_t) now returns both events from one input (eg KEY_UP and KEY_PRESS) in the same call, and is available for all switch types
+- Added enableEagerPress() to accept a key press on the first active read, with a lockout for the contact bounce and only the release filtered
+- Added optional (UI_FSM_TABLE) transition table in PROGMEM for the key press FSM, with host equivalence check MD_UISwitch_FSMCheck
+
 Jul 2022 version 2.2.2
 - Fixed bug in matrix lookup index calculation
 - Added SimpleKbd example
@@ -84,7 +136,11 @@ Nov 2017 version 1.0.0
 - New library created to consolidate existing MD_KeySwitch and MD_AButton libraries
  */
 
+#ifdef UISWITCH_HAL_HEADER
+#include UISWITCH_HAL_HEADER
+#else
 #include <Arduino.h>
+#endif
 
 /**
  * \file
@@ -95,6 +151,323 @@ Nov 2017 version 1.0.0
 #define ARRAY_SIZE(a) (sizeof(a)/sizeof((a)[0]))
 #endif
 
+/**
+ * \page pageHAL Hardware Abstraction
+ * All the hardware and clock access in the library is made through the UI_*
+ * macros defined below. By default these map directly onto the Arduino core
+ * functions.
+ *
+ * Any macro can be redefined before this header is included to use an
+ * alternative implementation (eg, a 'fast' digital read library).
+ *
+ * Alternatively, the whole Arduino environment can be replaced by defining
+ * UISWITCH_HAL_HEADER as the name of a header file that provides the Arduino
+ * types, constants and functions used by the library. This allows the library
+ * to be compiled and tested off-target using a simulated clock and simulated
+ * pin and ADC values. A reference implementation for a Linux host is found in
+ * the extras/host folder of the library.
+ */
+#ifndef UI_MILLIS
+#define UI_MILLIS() millis()                            ///< HAL - current time in milliseconds
+#endif
+#ifndef UI_MICROS
+#define UI_MICROS() micros()                            ///< HAL - current time in microseconds
+#endif
+#ifndef UI_PIN_MODE
+#define UI_PIN_MODE(p, m) pinMode((p), (m))             ///< HAL - set the I/O mode for a pin
+#endif
+#ifndef UI_DIGITAL_READ
+#define UI_DIGITAL_READ(p) digitalRead(p)               ///< HAL - read a digital pin
+#endif
+#ifndef UI_DIGITAL_WRITE
+#define UI_DIGITAL_WRITE(p, v) digitalWrite((p), (v))   ///< HAL - write a digital pin
+#endif
+#ifndef UI_ANALOG_READ
+#define UI_ANALOG_READ(p) analogRead(p)                 ///< HAL - read an analog pin
+#endif
+#ifndef UI_DELAY_US
+#define UI_DELAY_US(t) delayMicroseconds(t)             ///< HAL - short blocking delay in microseconds
+#endif
+#ifndef UI_ANALOG_MAX
+#define UI_ANALOG_MAX 1023                              ///< HAL - largest value returned by UI_ANALOG_READ()
+#endif
+#ifndef UI_PGM_READ_BYTE
+#define UI_PGM_READ_BYTE(p) pgm_read_byte(p)            ///< HAL - read a byte from program memory (PROGMEM)
+#endif
+#ifndef UI_PGM_READ_WORD
+#define UI_PGM_READ_WORD(p) pgm_read_word(p)            ///< HAL - read a 16 bit word from program memory (PROGMEM)
+#endif
+/**
+ * \def UI_ANALOG_START
+ * HAL - start an analog conversion on a pin without waiting for the result.
+ * UI_ANALOG_READY() is then true when the conversion is complete, and
+ * UI_ANALOG_RESULT() returns the value, and UI_ANALOG_WAIT() waits for it. Used
+ * by MD_UISwitch_Analog when enableAsyncRead() is set. The ADC registers are used directly on the AVR 
+ * processors in the list below, keeping the reference selected in ADMUX by the
+ * last analogRead(). Otherwise the conversion is done by UI_ANALOG_READ() when
+ * the result is collected.
+ */
+#ifndef UI_ANALOG_START
+#if defined(__AVR_ATmega328P__) || defined(__AVR_ATmega328__) || defined(__AVR_ATmega168__) || \
+    defined(__AVR_ATmega168P__) || defined(__AVR_ATmega88__) || defined(__AVR_ATmega88P__) || \
+    defined(__AVR_ATmega48__) || defined(__AVR_ATmega48P__) || \
+    defined(__AVR_ATmega2560__) || defined(__AVR_ATmega1280__) || defined(__AVR_ATmega32U4__)
+inline void uiAnalogStart(uint8_t pin)    ///< HAL - start an AVR ADC conversion
+{
+  // the same channel selection as the core analogRead()
+  if (pin >= A0) pin -= A0;   // allow for channel or pin numbers
+#if defined(analogPinToChannel)
+  pin = analogPinToChannel(pin);
+#endif
+#if defined(MUX5)
+  ADCSRB = (ADCSRB & ~_BV(MUX5)) | (((pin >> 3) & 0x01) << MUX5);
+#endif
+  ADMUX = (ADMUX & (_BV(REFS1) | _BV(REFS0))) | (pin & 0x07);  // keep the reference
+  ADCSRA |= _BV(ADSC);
+}
+#define UI_ANALOG_START(p) uiAnalogStart(p)           ///< HAL - start an analog conversion
+#define UI_ANALOG_READY() bit_is_clear(ADCSRA, ADSC)  ///< HAL - true if the analog conversion is complete
+#define UI_ANALOG_RESULT(p) (ADC)                     ///< HAL - result of the completed analog conversion
+#else
+#define UI_ANALOG_START(p)                            ///< HAL - start an analog conversion
+#define UI_ANALOG_READY() true                        ///< HAL - true if the analog conversion is complete
+#define UI_ANALOG_RESULT(p) UI_ANALOG_READ(p)         ///< HAL - result of the completed analog conversion
+#endif
+#endif
+#ifndef UI_ANALOG_WAIT
+#define UI_ANALOG_WAIT() do { } while (!UI_ANALOG_READY()) ///< HAL - wait for the analog conversion to complete
+#endif
+#ifndef UI_MEMORY_BARRIER
+#define UI_MEMORY_BARRIER() __asm__ __volatile__("" ::: "memory") ///< HAL - memory ordering barrier between interrupt/thread and main code
+#endif
+
+/**
+ * \def UI_PORT_IO
+ * HAL - set to 1 if the hardware port input registers can be read directly.
+ * This is automatically detected from the Arduino core definitions and
+ * allows switches sharing a hardware port to be read in one access.
+ */
+#ifndef UI_PORT_IO
+#if defined(portInputRegister) && defined(digitalPinToPort) && defined(digitalPinToBitMask)
+#define UI_PORT_IO 1
+#else
+#define UI_PORT_IO 0
+#endif
+#endif
+
+#ifndef UI_PORT_TYPE
+#ifdef __AVR__
+#define UI_PORT_TYPE uint8_t   ///< HAL - data type of a hardware port register
+#else
+#define UI_PORT_TYPE uint32_t  ///< HAL - data type of a hardware port register
+#endif
+#endif
+
+#if UI_PORT_IO
+#ifndef UI_PORT_INPUT
+#define UI_PORT_INPUT(p) ((volatile UI_PORT_TYPE *)portInputRegister(digitalPinToPort(p))) ///< HAL - input register for a pin
+#endif
+#ifndef UI_PORT_MASK
+#define UI_PORT_MASK(p) ((UI_PORT_TYPE)digitalPinToBitMask(p))  ///< HAL - bit mask for a pin in its port register
+#endif
+#ifndef UI_PORT_READ
+#define UI_PORT_READ(r) (*(r))   ///< HAL - read a port input register
+#endif
+#endif
+
+/**
+ * \def UI_PORT_DRIVE
+ * HAL - set to 1 if the port mode and output registers can be written directly
+ * to switch a pin between driven LOW and high impedance. This is enabled by
+ * default for AVR processors, where a pin with both its mode (DDR) and output
+ * (PORT) bits clear is high impedance. Requires UI_PORT_IO.
+ */
+#ifndef UI_PORT_DRIVE
+#if UI_PORT_IO && defined(__AVR__) && defined(portModeRegister) && defined(portOutputRegister)
+#define UI_PORT_DRIVE 1
+#else
+#define UI_PORT_DRIVE 0
+#endif
+#endif
+
+#if UI_PORT_DRIVE
+#ifndef UI_PORT_MODE
+#define UI_PORT_MODE(p) ((volatile UI_PORT_TYPE *)portModeRegister(digitalPinToPort(p)))     ///< HAL - mode register for a pin
+#endif
+#ifndef UI_PORT_OUTPUT
+#define UI_PORT_OUTPUT(p) ((volatile UI_PORT_TYPE *)portOutputRegister(digitalPinToPort(p))) ///< HAL - output register for a pin
+#endif
+#ifndef UI_PORT_SET
+/**
+ * HAL - set the bits in a port register. The read-modify-write is protected from
+ * interrupts changing other bits in the same register, as digitalWrite() does.
+ */
+inline void uiPortSet(volatile UI_PORT_TYPE *r, UI_PORT_TYPE m)
+{
+#ifdef __AVR__
+  uint8_t s = SREG;
+  cli();
+  *r |= m;
+  SREG = s;
+#else
+  *r |= m;
+#endif
+}
+
+/**
+ * HAL - clear the bits in a port register, see uiPortSet().
+ */
+inline void uiPortClear(volatile UI_PORT_TYPE *r, UI_PORT_TYPE m)
+{
+#ifdef __AVR__
+  uint8_t s = SREG;
+  cli();
+  *r &= ~m;
+  SREG = s;
+#else
+  *r &= ~m;
+#endif
+}
+
+#define UI_PORT_SET(r, m) uiPortSet((r), (m))       ///< HAL - set bits in a port register
+#define UI_PORT_CLEAR(r, m) uiPortClear((r), (m))   ///< HAL - clear bits in a port register
+#endif
+#endif
+
+#ifndef UI_MATRIX_LINES
+#define UI_MATRIX_LINES 8   ///< Maximum rows or columns for MD_UISwitch_Matrix to use direct port access
+#endif
+
+#ifndef UI_DIGITAL_PORTS
+#define UI_DIGITAL_PORTS 2  ///< Maximum number of hardware ports read directly by one MD_UISwitch_Digital object
+#endif
+
+#ifndef UI_INSTRUMENT
+#define UI_INSTRUMENT 0     ///< Set to 1 to compile in the switch counters and event timing
+#endif
+
+#ifndef UI_STATS_HIST
+#define UI_STATS_HIST 8     ///< Number of buckets in the read() duration histogram, if UI_INSTRUMENT is set
+#endif
+
+#ifndef UI_RECORD
+#define UI_RECORD 0         ///< Set to 1 to allow switch input to be recorded (see MD_UISwitch_Recorder)
+#endif
+
+#ifndef UI_FSM_TABLE
+#define UI_FSM_TABLE 0      ///< Set to 1 to run the key press FSM from a transition table in PROGMEM instead of a switch statement
+#endif
+
+#if UI_INSTRUMENT
+#define UI_STAT(x) x        ///< Instrumentation code, only compiled in if UI_INSTRUMENT is set
+#define UI_STAT_READ(st) MD_UISwitch::statTimer_t statTimer_(st)  ///< Time the rest of read() into the stats st
+#else
+#define UI_STAT(x)          ///< Instrumentation code, only compiled in if UI_INSTRUMENT is set
+#define UI_STAT_READ(st)    ///< Time the rest of read() into the stats st
+#endif
+
+/**
+* Input recorder class MD_UISwitch_Recorder.
+*
+* Records the input to the debounce and FSM of a switch on each read() into
+* a ring buffer, so that a key press sequence seen in the field can be captured
+* on the target and replayed off-target through the same debounce and FSM
+* (see extras/host/MD_UISwitch_Replay.h).
+*
+* Each sample holds the time passed to read(), the UI_MICROS() time used by the
+* timed debounce for that read, and the key found by the scan. This is everything
+* that the debounce and FSM use, so the replay is bit exact whatever the type of 
+* switch, even if the clock moves on during the read.
+* Reads that find no key while the switch is idle leave the switch unchanged
+* and are not recorded, so the buffer is only used while keys are active. Once
+* the buffer is full the oldest samples are overwritten. Stopping the recording
+* (see enable()) keeps the samples up to that point.
+*
+* The recorder is attached to a switch using setRecorder(), which is only
+* available when UI_RECORD is set to 1. Only switches that report one key at 
+* a time can be recorded, not MD_UISwitch_Bank or MD_UISwitch_Matrix in NKRO mode.
+*
+* The sample buffer is not copied, so it must remain in scope for the life of
+* the object.
+*/
+class MD_UISwitch_Recorder
+{
+public:
+  static const uint8_t KEY_NONE = 0xff;   ///< sample key when the scan did not find a single key
+
+  /**
+  * Recorded sample
+  */
+  typedef struct
+  {
+    uint32_t time;      ///< time passed to read()
+    uint32_t timeUs;    ///< UI_MICROS() time used by the debounce, 0 if the debounce is not timed
+    uint8_t  key;       ///< scan index of the key found, KEY_NONE if none or more than one
+  } sample_t;
+
+  /**
+  * Class Constructor.
+  *
+  * \param buf   the buffer for the samples.
+  * \param size  the number of samples the buffer can hold.
+  */
+  MD_UISwitch_Recorder(sample_t *buf, uint16_t size) : _buf(buf), _size(size), _enabled(true) { clear(); };
+
+  /**
+  * Clear the recording
+  */
+  void clear(void) { _head = _count = 0; _lost = 0; };
+
+  /**
+  * Start or stop recording
+  *
+  * Recording is enabled when the object is created.
+  *
+  * \param f true to record, false to stop recording.
+  */
+  inline void enable(bool f) { _enabled = f; };
+
+  inline uint16_t count(void) const { return(_count); };   ///< Number of samples held
+  inline uint32_t getLost(void) const { return(_lost); };  ///< Number of samples overwritten since clear()
+
+  /**
+  * Get a sample
+  *
+  * \param i the sample number, 0 for the oldest held, up to count()-1.
+  * \return the sample.
+  */
+  inline const sample_t &get(uint16_t i) const
+    { uint16_t n = _head + _size - _count + i; return(_buf[n >= _size ? n - _size : n]); };
+
+  /**
+  * Record a sample
+  *
+  * Called by the switch on each read() that needs recording.
+  *
+  * \param now the time passed to read().
+  * \param us  the UI_MICROS() time passed to the debounce (see MD_UISwitch::dbTime()).
+  * \param key the scan index of the key found, KEY_NONE if none or more than one.
+  */
+  void record(uint32_t now, uint32_t us, uint8_t key)
+  {
+    if (!_enabled) return;
+
+    _buf[_head].time = now;
+    _buf[_head].timeUs = us;
+    _buf[_head].key = key;
+    if (++_head >= _size) _head = 0;
+    if (_count < _size) _count++; else _lost++;
+  };
+
+protected:
+  sample_t *_buf;     ///< sample buffer
+  uint16_t _size;     ///< buffer size in samples
+  uint16_t _head;     ///< next sample to write
+  uint16_t _count;    ///< samples held
+  uint32_t _lost;     ///< samples overwritten
+  bool     _enabled;  ///< true if recording
+};
+
 /**
  * Core object for the MD_UISwitch library
  */
@@ -121,6 +494,118 @@ public:
     KEY_LONGPRESS,   ///< Long press
     KEY_RPTPRESS     ///< Repeated key press (only if enableRepeatResult(true))
   };
+
+  /**
+   * Key event
+   *
+   * Used by switch types that can report events for more than one
+   * key from a single read.
+   */
+  typedef struct
+  {
+    uint8_t     key;     ///< identifier for the key, as would be returned by getKey()
+    keyResult_t result;  ///< the event detected for this key
+  } keyEvent_t;
+
+  /**
+   * Debounce filter time constants
+   *
+   * Select the row of the RC debounce filter table used by the switch (see
+   * setDebounceTime()). Each row has a different filter fraction, and takes
+   * a different number of filter steps to accept a key press.
+   */
+  enum debounceTC_t
+  {
+    DB_TC_QUARTER,       ///< 1/4 fraction, 11 steps
+    DB_TC_EIGHTH,        ///< 1/8 fraction, 23 steps
+    DB_TC_SIXTEENTH,     ///< 1/16 fraction, 43 steps
+    DB_TC_THIRTYSECOND,  ///< 1/32 fraction, 74 steps (default)
+    DB_TC_SIXTYFOURTH    ///< 1/64 fraction, 110 steps
+  };
+
+  /**
+   * Switch counters
+   *
+   * Kept for each switch object when UI_INSTRUMENT is set (see getStats()).
+   * Bucket 0 of the read() duration histogram counts reads under 16us, bucket
+   * n those from 2^(n+3) to 2^(n+4)us, and the last bucket all the longer ones.
+   * The histogram counts stop at their largest value.
+   */
+  typedef struct
+  {
+    uint32_t scans;         ///< number of read() calls
+    uint16_t bounces;       ///< key presses rejected by the debounce filter
+    uint16_t fsmResets;     ///< debounce and FSM resets for a change of key
+    uint16_t events[KEY_RPTPRESS + 1];  ///< events returned, indexed by keyResult_t
+    uint32_t readMin;       ///< shortest read() in microseconds
+    uint32_t readMax;       ///< longest read() in microseconds
+    uint16_t readHist[UI_STATS_HIST]; ///< read() duration histogram
+  } uiStats_t;
+
+  /**
+   * Event times
+   *
+   * The UI_MICROS() times for the last event returned by read(), kept for each
+   * switch object when UI_INSTRUMENT is set (see getEventTime()).
+   */
+  typedef struct
+  {
+    keyResult_t result;     ///< the last event returned
+    uint32_t timeEdge;      ///< the press was first seen by the debounce filter
+    uint32_t timeAccept;    ///< the debounce filter accepted the press
+    uint32_t timeRelease;   ///< the release was seen, 0 if the key is still held
+    uint32_t timeEmit;      ///< read() returned the event
+  } uiEventTime_t;
+
+  /**
+   * Timer and option profile
+   *
+   * The timer values and enabled options that direct the FSM. These are
+   * set using the methods for object parameters and options and can be
+   * shared between keys (see MD_UISwitch_Bank).
+   *
+   * Note that Press time < Long Press Time < Repeat time. No checking is 
+   * done in the library to enforce this relationship.
+   */
+  typedef struct
+  {
+    uint16_t timePress;       ///< press time in milliseconds
+    uint16_t timeDoublePress; ///< double press detection time in milliseconds
+    uint16_t timeLongPress;   ///< long press time in milliseconds
+    uint16_t timeRepeat;      ///< repeat time delay in milliseconds
+    uint8_t  enableFlags;     ///< functions enabled/disabled
+  } uiProfile_t;
+
+  /**
+   * Feature masks
+   *
+   * Combined to select the FSM functions compiled into the template
+   * switch classes (see MD_UISwitch_DigitalT). The bits are the same as
+   * those set by the enable methods.
+   */
+  static const uint8_t FEATURE_REPEAT = 0x01;         ///< repeat key, as enableRepeat()
+  static const uint8_t FEATURE_LONGPRESS = 0x02;      ///< long press, as enableLongPress()
+  static const uint8_t FEATURE_DPRESS = 0x04;         ///< double press, as enableDoublePress()
+  static const uint8_t FEATURE_REPEAT_RESULT = 0x08;  ///< KEY_RPTPRESS for repeats, as enableRepeatResult()
+  static const uint8_t FEATURE_DEFAULT = 0x07;        ///< the options enabled by default in the runtime classes
+
+  /**
+   * Fixed timer and option profile
+   *
+   * Used in place of uiProfile_t by the template switch classes (see
+   * MD_UISwitch_Static). The options are a compile time constant, so the
+   * FSM code for disabled options is removed by the compiler.
+   *
+   * \tparam F the FEATURE_* masks for the enabled options.
+   */
+  template <uint8_t F> struct uiFixedProfile_t
+  {
+    uint16_t timePress;       ///< press time in milliseconds
+    uint16_t timeDoublePress; ///< double press detection time in milliseconds
+    uint16_t timeLongPress;   ///< long press time in milliseconds
+    uint16_t timeRepeat;      ///< repeat time delay in milliseconds
+    static const uint8_t enableFlags = F; ///< functions enabled/disabled
+  };
   /** @} */
 
   //--------------------------------------------------------------
@@ -171,6 +656,68 @@ public:
   */
   virtual keyResult_t read(void) = 0;
 
+  /**
+  * Read input at a given time and return the state of the switch
+  *
+  * Same as read() but the time passed is used for all the FSM timing rather
+  * than reading the clock, so a group of switches can be processed against one
+  * consistent time that is only read once. The library switch classes replace
+  * this method. The default calls read() and ignores the time passed.
+  *
+  * \sa poll() method
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the keyResult_t enumerated value from processFSM()
+  */
+  virtual keyResult_t read(uint32_t now) { (void)now; return(read()); };
+
+  static const uint8_t SAMPLE_EVENT_MAX = 2;  ///< most events one read of a single key switch can return
+
+  /**
+  * Read input and return the key events
+  *
+  * Same as read(keyEvent_t*, uint8_t, uint32_t) using the current UI_MILLIS() time.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \return the number of events placed in the buffer.
+  */
+  uint8_t read(keyEvent_t *ev, uint8_t evSize) { return(read(ev, evSize, UI_MILLIS())); };
+
+  /**
+  * Read input at a given time and return the key events
+  *
+  * Read the switch and return the events detected as key identifier and
+  * keyResult_t pairs. This allows switch types that track more than one key
+  * at a time to return all their events from one call (see MD_UISwitch_Group).
+  *
+  * Some key inputs produce two events, such as KEY_UP followed by KEY_PRESS
+  * when a key is released. read() returns the second event on the next call,
+  * without processing the input read by that call, but this method returns
+  * both events from the same call. For switches that report one key at a time
+  * a buffer of SAMPLE_EVENT_MAX events holds everything one call can return.
+  * If there is not enough room, the second event is returned by the next call.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \param now     the current time, as returned by UI_MILLIS().
+  * \return the number of events placed in the buffer.
+  */
+  virtual uint8_t read(keyEvent_t *ev, uint8_t evSize, uint32_t now);
+
+  /**
+  * Read a collection of switches
+  *
+  * Read all the switches in the array using a single UI_MILLIS() time
+  * and save the result for each switch.
+  *
+  * \param s      array of pointers to the switch objects.
+  * \param count  the number of switches in the array.
+  * \param result array of count elements for the result from each switch.
+  * \return the number of switches with a result other than KEY_NULL.
+  */
+  static uint8_t poll(MD_UISwitch *s[], uint8_t count, keyResult_t *result);
+
   /**
   * Read the key identifier for the last switch
   *
@@ -182,6 +729,51 @@ public:
   virtual uint8_t getKey(void) { return(_lastKey); };
   /** @} */
 
+  //--------------------------------------------------------------
+  /** \name Methods for low power operation.
+  * @{
+  */
+  static const uint32_t DEADLINE_NONE = 0xffffffff;  ///< nextDeadline() value when only an input change can cause an event
+
+  /**
+  * Time to the next timed event
+  *
+  * Return the number of milliseconds until the switch next needs to be read
+  * for a timer driven transition (eg, a long press or repeat) to be detected
+  * on time. If no timer is running, DEADLINE_NONE is returned and nothing will
+  * happen until the switch input changes. The application can sleep or do other
+  * work until the deadline or a pin change, whichever comes first, rather than
+  * continuously calling read().
+  *
+  * Zero is returned if read() needs to be called again straight away, such as
+  * while the debounce filter is running, as this needs consecutive readings.
+  *
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  virtual uint32_t nextDeadline(void) { return(nextDeadline(UI_MILLIS())); };
+
+  /**
+  * Time to the next timed event at a given time
+  *
+  * Same as nextDeadline() but using the time passed rather than reading the clock.
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  virtual uint32_t nextDeadline(uint32_t now);
+
+  /**
+  * Time to the next timed event for a collection of switches
+  *
+  * Return the earliest nextDeadline() for all the switches in the array.
+  *
+  * \param s     array of pointers to the switch objects.
+  * \param count the number of switches in the array.
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  static uint32_t nextDeadline(MD_UISwitch *s[], uint8_t count);
+  /** @} */
+
   //--------------------------------------------------------------
   /** \name Methods for object parameters and options.
   * @{
@@ -198,7 +790,7 @@ public:
   *
   * \param t the specified time in milliseconds.
   */
-  inline void setPressTime(uint16_t t) { _timePress = t; };
+  inline void setPressTime(uint16_t t) { _profile.timePress = t; };
 
   /**
    * Set the double press detection time
@@ -210,7 +802,7 @@ public:
    *
    * \param t the specified time in milliseconds.
    */
-  inline void setDoublePressTime(uint16_t t) { _timeDoublePress = t; enableDoublePress(true); };
+  inline void setDoublePressTime(uint16_t t) { _profile.timeDoublePress = t; enableDoublePress(true); };
 
   /**
    * Set the long press detection time
@@ -226,7 +818,7 @@ public:
    *
    * \param t the specified time in milliseconds.
    */
-  inline void setLongPressTime(uint16_t t) { _timeLongPress = t; enableLongPress(true); };
+  inline void setLongPressTime(uint16_t t) { _profile.timeLongPress = t; enableLongPress(true); };
 
   /**
    * Set the repeat time
@@ -241,7 +833,58 @@ public:
    *
    * \param t the specified time in milliseconds.
    */
-  inline void setRepeatTime(uint16_t t) { _timeRepeat = t; enableRepeat(true); };
+  inline void setRepeatTime(uint16_t t) { _profile.timeRepeat = t; enableRepeat(true); };
+
+  /**
+   * Set the debounce time
+   *
+   * By default the debounce filter takes one step each time the switch is
+   * read, so the time taken to accept a key press depends on how often read()
+   * is called - 74 reads with the default time constant. Once a debounce time
+   * is set, the filter takes a step for each part of that time that has elapsed
+   * since the last step, so a key press takes the same time to be accepted
+   * however often read() is called. read() should be called several times
+   * within the debounce time for the filter to see any contact bounce.
+   *
+   * The time constant selects the row of the filter table. The shorter time
+   * constants take fewer steps, so respond to a bounce more strongly.
+   *
+   * \param t  the debounce time in milliseconds, 0 for one step per read (default).
+   * \param tc the filter time constant.
+   */
+  inline void setDebounceTime(uint16_t t, debounceTC_t tc = DB_TC_THIRTYSECOND) { setDebounce(_dbTiming, (uint32_t)t * 1000, tc); };
+
+  /**
+   * Set the debounce time in microseconds
+   *
+   * Same as setDebounceTime() with the time set in microseconds. The filter
+   * step time is the debounce time divided by the steps the filter takes to
+   * accept a clean key press, and is at least 1 microsecond. A shorter 
+   * debounce time is rounded up to this.
+   *
+   * \param t  the debounce time in microseconds, 0 for one step per read (default).
+   * \param tc the filter time constant.
+   */
+  inline void setDebounceTimeUs(uint16_t t, debounceTC_t tc = DB_TC_THIRTYSECOND) { setDebounce(_dbTiming, t, tc); };
+
+  /**
+   * Enable eager press debounce
+   *
+   * The debounce filter normally has to see a key active for the whole
+   * debounce time before the key press is accepted, so KEY_DOWN always lags
+   * the press by the filter time. In eager mode the press is accepted on the
+   * first read that finds the key active, and the input is then ignored for
+   * the lockout time so that the contact bounce that follows is not seen as
+   * a release. Only the release goes through the debounce filter, and takes
+   * the debounce time (see setDebounceTime()) once the key stays inactive.
+   *
+   * This suits keys that must act at once, such as jog or stop buttons. As
+   * the press is not filtered, noise on an input is seen as a short press.
+   *
+   * \param f true to enable eager press, false to filter the press (default).
+   * \param t the lockout time in milliseconds, up to 65ms.
+   */
+  inline void enableEagerPress(bool f, uint8_t t = KEY_LOCKOUT_TIME) { setLockout(_dbTiming, f, t); };
 
   /**
    * Enable double press detection
@@ -252,7 +895,7 @@ public:
    *
    * \param f true to enable, false to disable.
    */
-  inline void enableDoublePress(boolean f) { (f) ? bitSet(_enableFlags, DPRESS_ENABLE) : bitClear(_enableFlags, DPRESS_ENABLE); };
+  inline void enableDoublePress(boolean f) { (f) ? bitSet(_profile.enableFlags, DPRESS_ENABLE) : bitClear(_profile.enableFlags, DPRESS_ENABLE); };
 
   /**
    * Enable long press detection
@@ -265,7 +908,7 @@ public:
    *
    * \param f true to enable, false to disable.
    */
-  inline void enableLongPress(boolean f) { (f) ? bitSet(_enableFlags, LONGPRESS_ENABLE) : bitClear(_enableFlags, LONGPRESS_ENABLE); };
+  inline void enableLongPress(boolean f) { (f) ? bitSet(_profile.enableFlags, LONGPRESS_ENABLE) : bitClear(_profile.enableFlags, LONGPRESS_ENABLE); };
 
   /**
    * Enable repeat detection
@@ -277,7 +920,7 @@ public:
    *
    * \param f true to enable, false to disable.
    */
-  inline void enableRepeat(boolean f) { (f) ? bitSet(_enableFlags, REPEAT_ENABLE) : bitClear(_enableFlags, REPEAT_ENABLE); };
+  inline void enableRepeat(boolean f) { (f) ? bitSet(_profile.enableFlags, REPEAT_ENABLE) : bitClear(_profile.enableFlags, REPEAT_ENABLE); };
 
   /**
    * Modify repeat notification
@@ -289,8 +932,56 @@ public:
    *
    * \param f true to enable, false to disable (default).
    */
-  inline void enableRepeatResult(boolean f) { (f) ? bitSet(_enableFlags, REPEAT_RESULT_ENABLE) : bitClear(_enableFlags, REPEAT_RESULT_ENABLE); };
+  inline void enableRepeatResult(boolean f) { (f) ? bitSet(_profile.enableFlags, REPEAT_RESULT_ENABLE) : bitClear(_profile.enableFlags, REPEAT_RESULT_ENABLE); };
+  /** @} */
+
+#if UI_INSTRUMENT
+  //--------------------------------------------------------------
+  /** \name Methods for instrumentation, if UI_INSTRUMENT is set.
+  * @{
+  */
+  /**
+  * Get the switch counters
+  *
+  * The counters are kept from when the object was created or clearStats()
+  * was last called. Switches that track more than one key at a time 
+  * (MD_UISwitch_Bank and MD_UISwitch_Matrix in NKRO mode) count the bounces
+  * and events for all their keys.
+  *
+  * \return the counters for the switch.
+  */
+  inline const uiStats_t &getStats(void) const { return(_stats); };
+
+  /**
+  * Get the times for the last event
+  *
+  * Valid after read() returns an event. The delay from the press to the event
+  * is (timeEmit - timeEdge), and any part of that after the press was
+  * debounced is (timeEmit - timeAccept). Only kept for switches that report one
+  * key at a time.
+  *
+  * \return the times for the last event.
+  */
+  inline const uiEventTime_t &getEventTime(void) const { return(_evTime); };
+
+  /**
+  * Clear the switch counters
+  */
+  inline void clearStats(void) { statClear(_stats); };
   /** @} */
+#endif
+
+#if UI_RECORD
+  /**
+  * Attach an input recorder
+  *
+  * Record the input to the debounce and FSM on each read() (see
+  * MD_UISwitch_Recorder). Only available if UI_RECORD is set.
+  *
+  * \param rec the recorder, nullptr to stop recording.
+  */
+  inline void setRecorder(MD_UISwitch_Recorder *rec) { _rec = rec; };
+#endif
 
 protected:
   // Default values for timed events.
@@ -299,6 +990,7 @@ protected:
   static const uint16_t KEY_DPRESS_TIME = 250;     ///< Default double press time between presses in milliseconds
   static const uint16_t KEY_LONGPRESS_TIME = 600;  ///< Default long press detection time in milliseconds
   static const uint16_t KEY_REPEAT_TIME = 300;     ///< Default time between repeats in in milliseconds
+  static const uint8_t  KEY_LOCKOUT_TIME = 10;     ///< Default eager press lockout time in milliseconds
   static const uint8_t  KEY_ACTIVE_STATE = LOW;    ///< Default key is active low - transition high to low detection
 
   // Bit enable/disable
@@ -323,12 +1015,6 @@ protected:
     S_WAIT        ///< Waiting for key to be released after long press is detected
   };
 
-  // FSM persistent values
-  state_fsm _state;       ///< the FSM current state
-  keyResult_t _kPush;     ///< storage for pushed key in FSM
-  uint32_t  _timeActive;  ///< the millis() time switch was last activated
-  uint8_t   _enableFlags; ///< functions enabled/disabled
-
   /**
   * Debouncing state values
   *
@@ -338,29 +1024,71 @@ protected:
   { 
     S_WAIT_START,   ///< Waiting for the debouncing to start
     S_DEBOUNCE,     ///< Currently debouncing state
-    S_WAIT_RELEASE  ///< Waiting for the next transition to be detected
+    S_WAIT_RELEASE, ///< Waiting for the next transition to be detected
+    S_RELEASED      ///< Release detected, otherwise the same as S_WAIT_START
   };
 
-  // Debouncing persistent values
-  uint8_t _RC = 0;    ///< RC integrator value
-  bool _prevStatus;   ///< previous 'active' status for edge detection
-  state_db _RCstate;  ///< current RC debouning state
-
-
-  // Note that Press time < Long Press Time < Repeat time. No checking is done in the
-  // library to enforce this relationship.
-  uint16_t  _timePress;     ///< press time in milliseconds
-  uint16_t  _timeDoublePress; ///< double press detection time in milliseconds
-  uint16_t  _timeLongPress; ///< long press time in milliseconds
-  uint16_t  _timeRepeat;    ///< repeat time delay in milliseconds
-  
-  uint8_t   _lastKey;       ///< persists the last key value until a new one is detected
-  int16_t   _lastKeyIdx;    ///< internal index of the last key read
-
   /**
-  * Process the key using FSM
+  * FSM persistent values
   *
-  * Process the key read using a finite state machine to detect the current
+  * Everything the FSM needs to remember about one key between calls.
+  */
+  typedef struct
+  {
+    state_fsm   state;      ///< the FSM current state
+    keyResult_t kPush;      ///< storage for pushed key in FSM
+    uint32_t    timeActive; ///< the millis() time switch was last activated
+  } fsmState_t;
+
+  /**
+  * Debouncing persistent values
+  *
+  * Everything the debounce filter needs to remember about one key between calls.
+  */
+  typedef struct
+  {
+    uint8_t  RC;          ///< RC integrator value
+    bool     prevStatus;  ///< previous 'active' status for edge detection
+    state_db RCstate;     ///< current RC debouncing state
+    uint32_t timeStep;    ///< UI_MICROS() time of the last filter step, if timed
+  } dbState_t;
+
+  /**
+  * Debouncing settings
+  *
+  * The time constant and step time for the debounce filter, shared by all
+  * the keys of a switch.
+  */
+  typedef struct
+  {
+    debounceTC_t tc;      ///< filter time constant table row
+    uint16_t     tick;    ///< microseconds per filter step, 0 for one step per read
+    uint16_t     lockout; ///< eager press lockout time in microseconds, 0 to filter the press
+  } dbTiming_t;
+
+  template <class D, class P> friend class MD_UISwitch_Static;
+
+  fsmState_t  _fsm;         ///< FSM state for the switch
+  dbState_t   _db;          ///< debouncing state for the switch
+  dbTiming_t  _dbTiming;    ///< debounce time constant and step time for the switch
+#if UI_INSTRUMENT
+  uiStats_t     _stats;     ///< counters for the switch
+  uiEventTime_t _evTime;    ///< times for the last event
+  bool          _statActive; ///< debounced state last seen, for the event times
+#endif
+#if UI_RECORD
+  MD_UISwitch_Recorder *_rec; ///< input recorder, nullptr if none
+#endif
+  uiProfile_t _profile;     ///< timer values and enabled options for the switch
+
+  uint8_t   _lastKey;       ///< persists the last key value until a new one is detected
+  int16_t   _lastKeyIdx;    ///< internal index of the last key read
+  bool      _newKey;        ///< last read found a new key, not passed to the debounce until the next read
+
+  /**
+  * Process the key using FSM
+  *
+  * Process the key read using a finite state machine to detect the current
   * type of keypress and return one of the keypress types.
   *
   * The timing for each keypress starts when the first transition of the
@@ -376,7 +1104,80 @@ protected:
   * \param reset  an optional identifier to reset the FSM.
   * \return one of the keyResult_t enumerated values.
   */
-  keyResult_t processFSM(bool swState, bool reset = false);
+  keyResult_t processFSM(bool swState, bool reset = false) { return(processFSM(_fsm, _profile, swState, UI_MILLIS(), reset)); };
+
+  /**
+  * Process the key using FSM - separate key state
+  *
+  * Same as processFSM(bool, bool) but using the FSM state passed rather than 
+  * the switch object's own state. This allows objects that track more than one
+  * key at a time to run an FSM for each key using the same timer and option values.
+  *
+  * \param fsm    the FSM state for the key.
+  * \param swState true if the switch is active, false otherwise.
+  * \param reset  an optional identifier to reset the FSM.
+  * \return one of the keyResult_t enumerated values.
+  */
+  keyResult_t processFSM(fsmState_t &fsm, bool swState, bool reset = false) { return(processFSM(fsm, _profile, swState, UI_MILLIS(), reset)); };
+
+  /**
+  * Process the key using FSM - separate key state, profile and time
+  *
+  * Same as processFSM(fsmState_t&, bool, bool) but also using the timer and 
+  * option values passed rather than the switch object's own settings, and
+  * the time passed rather than reading the clock.
+  *
+  * The profile is either a uiProfile_t or, for the template switch classes,
+  * a uiFixedProfile_t. The FSM code is in this header, so it is compiled for
+  * each profile type used.
+  *
+  * \tparam P     the profile type.
+  * \param fsm    the FSM state for the key.
+  * \param prof   the timer and option values for the key.
+  * \param swState true if the switch is active, false otherwise.
+  * \param now    the current UI_MILLIS() time.
+  * \param reset  an optional identifier to reset the FSM.
+  * \return one of the keyResult_t enumerated values.
+  */
+  template <typename P>
+  static keyResult_t processFSM(fsmState_t &fsm, const P &prof, bool swState, uint32_t now, bool reset = false);
+
+#if UI_FSM_TABLE
+  // FSM transition table (see MD_UISwitch.cpp)
+  static const uint8_t FSM_EVENT = 3;     ///< fsmTable bit position of the event returned
+  static const uint8_t FSM_PUSH = 6;      ///< fsmTable bit position of the event pushed for the next step
+  static const uint8_t FSM_TIMER = 9;     ///< fsmTable bit set to restart the state timer
+  static const uint8_t FSM_TIMED = 0x80;  ///< fsmIndex bit set for a state with a timer
+  static const uint8_t fsmIndex[];        ///< where to find the transitions for each FSM state in fsmTable
+  static const uint16_t fsmTable[];       ///< FSM transitions, in PROGMEM
+
+  /**
+  * Take one FSM step
+  *
+  * Look up the transition in fsmTable for the current state, options,
+  * input and timer, and apply it.
+  *
+  * \param fsm     the FSM state for the key.
+  * \param d       the fsmIndex entry for the current state.
+  * \param flags   the enabled options (enableFlags).
+  * \param b       true if the switch is active, false otherwise.
+  * \param expired true if the timer for the state has expired.
+  * \param now     the current UI_MILLIS() time.
+  * \return one of the keyResult_t enumerated values.
+  */
+  static keyResult_t fsmStep(fsmState_t &fsm, uint8_t d, uint8_t flags, bool b, bool expired, uint32_t now);
+#endif
+
+  /**
+  * Timer limit for an FSM state
+  *
+  * \tparam P     the profile type, as for processFSM().
+  * \param state  the FSM state, one with a timer.
+  * \param prof   the timer values for the key.
+  * \return the time from the FSM timeActive at which the state timer has expired.
+  */
+  template <typename P>
+  static uint32_t timerLimit(state_fsm state, const P &prof);
 
   /**
   * Switch debounce using Edge Detection & Resistor-Capacitor Digital Filter.
@@ -389,9 +1190,688 @@ protected:
   * \param reset  an optional identifier to reset the debounce detection.
   * \return true if the switch is 'debounced' active, false otherwise.
   */
-  bool debounce(bool curStatus, bool reset = false);
+  bool debounce(bool curStatus, bool reset = false) { return(debounce(_db, _dbTiming, curStatus, dbTime(_dbTiming), reset)); };
+
+  /**
+  * Switch debounce - separate key state
+  *
+  * Same as debounce(bool, bool) but using the debouncing state passed rather
+  * than the switch object's own state, and the time passed rather than 
+  * reading the clock. The time is read once for each read() of the switch 
+  * (see dbTime()), so every key in the read sees the same time.
+  *
+  * \param db  the debouncing state for the key.
+  * \param dt  the debounce time constant and step time for the key.
+  * \param curStatus  current active status for the switch.
+  * \param us  the UI_MICROS() time of the read, only used if the debounce is timed.
+  * \param reset  an optional identifier to reset the debounce detection.
+  * \return true if the switch is 'debounced' active, false otherwise.
+  */
+  static bool debounce(dbState_t &db, const dbTiming_t &dt, bool curStatus, uint32_t us, bool reset = false);
+
+  /**
+  * Time for the debounce
+  *
+  * \param dt  the debounce time constant and step time for the key.
+  * \return the UI_MICROS() time if the debounce is timed, otherwise 0 without reading the clock.
+  */
+  static uint32_t dbTime(const dbTiming_t &dt) { return((dt.tick != 0 || dt.lockout != 0) ? UI_MICROS() : 0); };
+
+  /**
+  * Timed debounce filter steps
+  *
+  * Work out the number of filter steps due since the last one and move the
+  * step time on by that many steps. The elapsed time is 32 bits, and a gap 
+  * of more than 0xffff steps counts as 0xffff, which is more than the filter
+  * needs to reach either threshold.
+  *
+  * \param db  the debouncing state for the key.
+  * \param dt  the debounce time constant and step time for the key, with a step time set.
+  * \param us  the UI_MICROS() time of the read.
+  * \return the number of filter steps to take.
+  */
+  static uint16_t dbSteps(dbState_t &db, const dbTiming_t &dt, uint32_t us);
+
+  static const uint8_t dbTable[][4];  ///< RC filter constants for each debounceTC_t, in PROGMEM
+
+  /**
+  * Set up the debounce timing
+  *
+  * Work out the step time for the debounce filter to accept a key press
+  * in the time given with the time constant selected.
+  *
+  * \param dt  the debounce settings to set.
+  * \param us  the debounce time in microseconds, 0 for one step per read. 
+  *            Otherwise the step time is at least 1 microsecond.
+  * \param tc  the filter time constant.
+  */
+  static void setDebounce(dbTiming_t &dt, uint32_t us, debounceTC_t tc);
+
+  /**
+  * Set up the eager press lockout
+  *
+  * \param dt  the debounce settings to set.
+  * \param f   true for eager press, false to filter the press.
+  * \param t   the lockout time in milliseconds, limited to 65ms.
+  */
+  static void setLockout(dbTiming_t &dt, bool f, uint8_t t);
+
+  /**
+  * Time to the next timed FSM transition
+  *
+  * Work out the time until a timer for the key expires, given the FSM
+  * and debounce states. Used to implement nextDeadline().
+  *
+  * \tparam P    the profile type, as for processFSM().
+  * \param fsm   the FSM state for the key.
+  * \param db    the debouncing state for the key.
+  * \param prof  the timer and option profile for the key.
+  * \param now   the current UI_MILLIS() time.
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  template <typename P>
+  static uint32_t deadline(const fsmState_t &fsm, const dbState_t &db, const P &prof, uint32_t now);
+
+  /**
+  * Check if a key is idle
+  *
+  * A key is idle when the debounce and FSM are both waiting for the next key
+  * press and the FSM has no result waiting to be returned.
+  *
+  * \param fsm the FSM state for the key.
+  * \param db  the debouncing state for the key.
+  * \return true if the key is idle.
+  */
+  static bool isIdle(const fsmState_t &fsm, const dbState_t &db) 
+    { return(fsm.state == S_IDLE && fsm.kPush == KEY_NULL && db.RCstate == S_WAIT_START); };
+
+  /**
+  * Process the result of a single key scan
+  *
+  * The common part of read() for switches that report one key at a time.
+  * The debounce and FSM are reset when a different key is found, and only
+  * a single key found counts as the switch being active.
+  *
+  * The caller sets the last key value (returned by getKey()) if a single
+  * key is found.
+  *
+  * \tparam S    the switch class, MD_UISwitch or MD_UISwitch_Static.
+  * \tparam P    the profile type, as for processFSM().
+  * \param s     the switch object holding the key state.
+  * \param prof  the timer and option values for the switch.
+  * \param count the number of keys found active by the scan.
+  * \param idx   the index of the first key found, if count is not 0.
+  * \param now   the current UI_MILLIS() time.
+  * \return one of the keyResult_t enumerated values.
+  */
+  template <class S, typename P>
+  static keyResult_t processKey(S &s, const P &prof, int16_t count, int16_t idx, uint32_t now)
+  {
+    uint32_t us = dbTime(s._dbTiming);   // one time sample for the whole read
+    bool b = false;
+
+#if UI_RECORD
+    // a read with no key leaves an idle switch unchanged, so is not needed for the replay
+    if (s._rec != nullptr && (count == 1 || !isIdle(s._fsm, s._db) || s._db.prevStatus))
+      s._rec->record(now, us, (count == 1) ? (uint8_t)idx : MD_UISwitch_Recorder::KEY_NONE);
+#endif
+    s._newKey = false;
+    // if more than one key pressed, don't count anything
+    if (count == 1)
+    {
+      if (idx != s._lastKeyIdx)   // reset the debounce and FSM
+      {
+        debounce(s._db, s._dbTiming, false, us, true);
+        processFSM(s._fsm, prof, false, now, true);
+        UI_STAT(s._stats.fsmResets++);
+      }
+
+      b = (idx == s._lastKeyIdx);
+      s._newKey = !b;   // a new key is only debounced from the next read
+      s._lastKeyIdx = idx;
+    }
+
+#if UI_INSTRUMENT
+    state_db before = s._db.RCstate;
+    keyResult_t k;
+
+    b = debounce(s._db, s._dbTiming, b, us);
+    statDebounce(s._stats, before, s._db, b);
+    statEventTime(s._evTime, s._statActive, before, s._db, b);
+    k = processFSM(s._fsm, prof, b, now);
+    statEvent(s._stats, k);
+    if (k != KEY_NULL)
+    {
+      s._evTime.result = k;
+      s._evTime.timeEmit = UI_MICROS();
+    }
+    return(k);
+#else
+    return(processFSM(s._fsm, prof, debounce(s._db, s._dbTiming, b, us), now));
+#endif
+  };
+
+  /**
+  * Add the events from one FSM step to a buffer
+  *
+  * Adds the result from processFSM() and any second event the FSM pushed for
+  * the same input, so that both are returned together. A pushed event that
+  * does not fit is left in the FSM, to be returned by its next step.
+  * There must be room in the buffer for at least one event.
+  *
+  * \tparam S    the switch class, MD_UISwitch or MD_UISwitch_Static.
+  * \param s     the switch object, for the counters.
+  * \param fsm   the FSM state for the key.
+  * \param k     the result from processFSM().
+  * \param key   the key identifier for the events.
+  * \param ev    the event buffer.
+  * \param n     the number of events already in the buffer.
+  * \param evSize the number of events the buffer can hold.
+  * \return the number of events in the buffer.
+  */
+  template <class S>
+  static uint8_t addEvents(S &s, fsmState_t &fsm, keyResult_t k, uint8_t key, keyEvent_t *ev, uint8_t n, uint8_t evSize)
+  {
+    (void)s;
+    if (k != KEY_NULL)
+    {
+      ev[n].key = key;
+      ev[n++].result = k;
+    }
+
+    if (fsm.kPush != KEY_NULL && n < evSize)
+    {
+      UI_STAT(statEvent(s._stats, fsm.kPush));
+      ev[n].key = key;
+      ev[n++].result = fsm.kPush;
+      fsm.kPush = KEY_NULL;
+    }
+
+    return(n);
+  };
+
+  /**
+  * Read a single key switch and return the key events
+  *
+  * The common part of read(keyEvent_t*, uint8_t, uint32_t) for switches that
+  * report one key at a time. An event still pushed by an earlier read() is
+  * returned first, so that the FSM processes this input rather than just
+  * returning the pushed event.
+  *
+  * \tparam S    the switch class, MD_UISwitch or MD_UISwitch_Static.
+  * \param s     the switch object.
+  * \param ev    the event buffer.
+  * \param evSize the number of events the buffer can hold.
+  * \param now   the current UI_MILLIS() time.
+  * \return the number of events placed in the buffer.
+  */
+  template <class S>
+  static uint8_t readEvents(S &s, keyEvent_t *ev, uint8_t evSize, uint32_t now)
+  {
+    uint8_t n = 0;
+    keyResult_t k;
+
+    if (evSize == 0) return(0);
+
+    if (s._fsm.kPush != KEY_NULL)
+    {
+      UI_STAT(statEvent(s._stats, s._fsm.kPush));
+      ev[n].key = s.getKey();
+      ev[n++].result = s._fsm.kPush;
+      s._fsm.kPush = KEY_NULL;
+      if (n >= evSize) return(n);
+    }
+
+    k = s.read(now);
+
+    return(addEvents(s, s._fsm, k, s.getKey(), ev, n, evSize));
+  };
+
+#if UI_INSTRUMENT
+  /**
+  * Times a read() call
+  *
+  * Records the time from its creation to the end of the block in the switch
+  * counters. Created by UI_STAT_READ() at the start of read().
+  */
+  class statTimer_t
+  {
+  public:
+    statTimer_t(uiStats_t &st) : _st(st), _t0(UI_MICROS()) {};   ///< start timing
+    ~statTimer_t() { statRead(_st, UI_MICROS() - _t0); };      ///< record the time
+
+  protected:
+    uiStats_t &_st;   ///< counters to update
+    uint32_t  _t0;    ///< start time
+  };
+
+  static void statClear(uiStats_t &st);   ///< reset the counters
+  static void statRead(uiStats_t &st, uint32_t t);  ///< count a read() taking t microseconds
+  static void statEvent(uiStats_t &st, keyResult_t k) { if (k != KEY_NULL) st.events[k]++; }; ///< count an event
+  static void statDebounce(uiStats_t &st, state_db before, const dbState_t &db, bool b)  ///< count a rejected press
+    { if (before == S_DEBOUNCE && db.RCstate == S_WAIT_RELEASE && !b) st.bounces++; };
+  static void statEventTime(uiEventTime_t &et, bool &active, state_db before, const dbState_t &db, bool b);  ///< track the press and release times
+#endif
 };
 
+// --- MD_UISwitch debounce and FSM
+// These are defined here rather than in MD_UISwitch.cpp so that they are
+// compiled with each switch class that uses them and can be inlined into its
+// read(), with the option tests of a fixed profile resolved at compile time.
+
+inline uint16_t MD_UISwitch::dbSteps(dbState_t &db, const dbTiming_t &dt, uint32_t us)
+{
+  uint32_t gap = us - db.timeStep;
+  uint16_t steps;
+
+  if (gap <= 0xffff)    // the usual case, with a 16 bit division
+    steps = (uint16_t)gap / dt.tick;
+  else                  // a long gap between reads
+  {
+    gap /= dt.tick;
+    steps = (gap > 0xffff) ? 0xffff : (uint16_t)gap;
+  }
+  db.timeStep += (uint32_t)steps * dt.tick;
+
+  return(steps);
+}
+
+inline bool MD_UISwitch::debounce(dbState_t &db, const dbTiming_t &dt, bool curStatus, uint32_t us, bool reset)
+/*
+  Switch debounce using Edge Detection & Resistor-Capacitor Digital Filter.
+
+  This Digital filter mimics an analogue RC filter with first-order
+  recursive low pass filter. It has good EMI filtering and quick response,
+  with a nearly continuous output like an analogue circuit.
+
+  Based on Elio Mazzocca, Contact-debouncing algorithm emulates Schmitt trigger.
+  Based on Oregon State University, Debounce switches algorithm.
+  Based on John Youngquist, Debouncing Switches and Encoders.
+  Version by Andrew M. Kollosche, 2015-2018 at http://www.ganssle.com/tem/tem366.html
+
+  Time-Constant  TCSHIFT, TC,  UTH,  LTH, Approx execute times on a PIC16 @ 2MHz.
+  Quarter           2,    63,  242,   15,  1ms.
+  Eight             3,    31,  238,   12,  2ms.
+  Sixteenth         4,    15,  230,   10,  3ms.
+  Thirty-second     5,     7,  215,    7,  9ms.
+  Sixty-forth       6,     3,  184,    3,  15ms.
+
+  Note: Thresholds count for each RC time-constant,
+  is calculated on 3 time-constants or for Upper threshold is 96% and
+  3% for Lower Threshold.
+
+  The filter normally takes one step per call. With a step time set, it 
+  takes one step for each step time elapsed since the last one instead,
+  using the current status for all of them (see dbSteps()).
+
+  In eager press mode (lockout time set) the press is accepted on the edge,
+  S_DEBOUNCE holds it for the lockout time whatever the input, and the RC
+  filter then runs on the inactive status in S_WAIT_RELEASE to find the release.
+*/
+{
+  // --- These constants are a consistent set from the table above
+  const uint8_t *row = dbTable[dt.tc];
+  const uint8_t TC_SHIFT = UI_PGM_READ_BYTE(row + 0); // bit shift for fraction
+  const uint8_t TC = UI_PGM_READ_BYTE(row + 1);       // RC time constant
+  const uint8_t UTH = UI_PGM_READ_BYTE(row + 2);      // Upper Threshold  for 'on'
+  const uint8_t LTH = UI_PGM_READ_BYTE(row + 3);      // Lower Threshold for 'off'
+  // ---
+
+  // handle the reset
+  if (reset)
+  {
+    db.RC = 0;
+    db.prevStatus = false;
+    db.RCstate = S_WAIT_START;
+  }
+
+  bool b = db.prevStatus; // return status value
+
+  //edge detector from 'inactive' to 'active'
+  switch (db.RCstate)
+  {
+    case S_WAIT_START: // wait for 'inactive' to 'active' transition
+    case S_RELEASED:
+    {
+      db.RCstate = (!db.prevStatus && curStatus) ? S_DEBOUNCE : S_WAIT_START;
+      db.prevStatus = curStatus;
+      if (dt.tick != 0 || dt.lockout != 0) db.timeStep = us;  // steps are timed from here
+      if (dt.lockout != 0 && db.RCstate == S_DEBOUNCE) b = true;   // eager press, accepted on the edge
+    }
+    break;
+
+    case S_DEBOUNCE:  // RC debounce
+    {
+      if (dt.lockout == 0)
+      {
+        uint16_t steps = 1;
+
+        if (dt.tick != 0)
+          steps = dbSteps(db, dt, us);
+
+        b = false;
+        while (steps-- > 0)
+        {
+          //first compute RCnew = RCold * fraction. Using shift and subtraction.
+          uint8_t temp = db.RC >> TC_SHIFT;
+          db.RC = db.RC - temp;   // subtract fraction for result.
+
+          if (curStatus)    // still an active switch
+            db.RC += TC;       // add in the time constant
+          else
+            if (db.RC > 0) db.RC--; // 'leak' and decay the value
+
+          //check upper & lower threshold.
+          b = (db.RC > UTH);     // upper threshold means we have a valid result
+          if (b or db.RC < LTH)  // got result or lower threshold
+          {
+            db.RC = 0;               // reset RC value
+            db.RCstate = S_WAIT_RELEASE; // move on to next state
+            break;
+          }
+        }
+        break;
+      }
+
+      // eager press lockout, ignore the input until it is over
+      b = true;
+      if (us - db.timeStep < dt.lockout)   // 32 bit elapsed time, so a long gap ends it
+        break;
+      db.RCstate = S_WAIT_RELEASE;
+    }
+    // fall through - a key released during the lockout starts the release filter now
+
+    case S_WAIT_RELEASE:  // waiting for switch release
+    default:
+    {
+      if (dt.lockout != 0)  // eager press, RC filter the inactive status for the release
+      {
+        uint16_t steps = 1;
+
+        if (curStatus && db.RC == 0)  // still held, the release steps are timed from here
+        {
+          steps = 0;
+          db.timeStep = us;
+        }
+        else if (db.RC == 0)  // first release read, one step so nextDeadline() asks for more
+          db.timeStep = us;
+        else if (dt.tick != 0)
+          steps = dbSteps(db, dt, us);
+
+        while (steps-- > 0 && b)
+        {
+          uint8_t temp = db.RC >> TC_SHIFT;
+          db.RC = db.RC - temp;
+
+          if (!curStatus)   // still released
+            db.RC += TC;
+          else
+            if (db.RC > 0) db.RC--;
+
+          if (db.RC > UTH)  // upper threshold means the release is valid
+          {
+            b = db.prevStatus = false;
+            db.RC = 0;
+            db.RCstate = S_RELEASED;
+          }
+        }
+      }
+      else if (!curStatus)
+        db.RCstate = S_RELEASED;
+    }
+    break;
+  }
+
+  // UIPRINTS((b) ? "-> DOWN" : "<- UP");
+
+  return (b);
+}
+
+template <typename P>
+uint32_t MD_UISwitch::timerLimit(state_fsm state, const P &prof)
+// The time from fsm.timeActive at which the timer for a timed state expires
+{
+  switch (state)
+  {
+  case S_PRESS:   return((uint32_t)prof.timePress + 1);
+  case S_PRESSL:  return((uint32_t)prof.timeLongPress + 1);
+  case S_REPEAT:  return(prof.timeRepeat);
+  case S_PRESS2A: return((uint32_t)prof.timeDoublePress + 1);
+  case S_PRESS2B: return((uint32_t)prof.timePress * 2);
+  default:        return(0);
+  }
+}
+
+#if UI_FSM_TABLE
+template <typename P>
+MD_UISwitch::keyResult_t MD_UISwitch::processFSM(fsmState_t &fsm, const P &prof, bool b, uint32_t now, bool reset)
+// Return one of the keypress types depending on what has been detected
+// in the FSM logic
+{
+  keyResult_t k = KEY_NULL;
+  uint8_t d;
+  bool expired;
+
+  if (reset)
+  {
+    fsm.state = S_IDLE;
+    fsm.kPush = KEY_NULL;
+    return(k);
+  }
+
+  // If we have previously pushed something return that status now
+  if (fsm.kPush != KEY_NULL)
+  {
+    k = fsm.kPush;
+    fsm.kPush = KEY_NULL;
+    return(k);
+  }
+
+  // Now run the FSM with the input and the state timer, if it has one
+  d = UI_PGM_READ_BYTE(&fsmIndex[fsm.state]);
+  expired = (d & FSM_TIMED) && (now - fsm.timeActive >= timerLimit(fsm.state, prof));
+
+  return(fsmStep(fsm, d, prof.enableFlags, b, expired, now));
+}
+#else
+template <typename P>
+MD_UISwitch::keyResult_t MD_UISwitch::processFSM(fsmState_t &fsm, const P &prof, bool b, uint32_t now, bool reset)
+// Return one of the keypress types depending on what has been detected
+// in the FSM logic
+{
+  keyResult_t k = KEY_NULL;
+
+  if (reset)
+  {
+    fsm.state = S_IDLE;
+    fsm.kPush = KEY_NULL;
+    return(k);
+  }
+
+  // If we have previously pushed something return that status now
+  if (fsm.kPush != KEY_NULL)
+  {
+    k = fsm.kPush;
+    fsm.kPush = KEY_NULL;
+    return(k);
+  }
+
+  // Now run the FSM with the input
+  switch (fsm.state)
+  {
+  case S_IDLE:    // waiting for first transition
+    if (b)
+    {
+      fsm.state = S_PRESS;
+      fsm.timeActive = now;
+      k = KEY_DOWN;
+    }
+    break;
+
+  case S_PRESS:   // press?
+    // Key off before a long press registered, so it is either double press or a press.
+    if (!b)
+    {
+      k = KEY_UP;
+      if (bitRead(prof.enableFlags, DPRESS_ENABLE))  // DPRESS allowed
+      {
+        fsm.state = S_PRESS2A;
+        fsm.timeActive = now;
+      }
+      else      // this is just a press
+      {
+        fsm.kPush = KEY_PRESS;
+        fsm.state = S_IDLE;
+      }
+    }
+
+    // if the switch is still on and we have run out of press time ...
+    if (now - fsm.timeActive > prof.timePress)
+    {
+      fsm.timeActive = now;   // reset for repeat timer base
+      // ... we either have a long press or are 
+      // heading towards repeats if they are enabled
+      if (bitRead(prof.enableFlags, LONGPRESS_ENABLE)) 
+        fsm.state = S_PRESSL;
+      else if (bitRead(prof.enableFlags, REPEAT_ENABLE))
+      {
+        k = KEY_PRESS;
+        fsm.state = S_REPEAT;
+      }
+      else // nothing else that can be done as we have no time left!
+      {
+        k = KEY_PRESS;
+        fsm.state = S_WAIT;
+      }
+    }
+    break;
+
+  case S_PRESSL:  // long press or auto repeat?
+    // It is a long press if
+    // - Key off before a repeat press is registered, or
+    // - Auto repeat is disabled
+    // Set the return code and go back to waiting
+    if (!b)
+    {
+      fsm.kPush = KEY_LONGPRESS;
+      k = KEY_UP;
+      fsm.state = S_IDLE;
+      break;
+    }
+
+    if (now - fsm.timeActive > prof.timeLongPress)
+    {
+      if (bitRead(prof.enableFlags, REPEAT_ENABLE))
+      {
+        k = KEY_PRESS;      // the first of the repeats
+        fsm.state = S_REPEAT;  // handle the rest of them
+        fsm.timeActive = now;  // set the new baseline time.
+      }
+      else  // no repeats - register the long press and wait for release
+      {
+        k = KEY_LONGPRESS;
+        fsm.state = S_WAIT;
+      }
+    }
+    break;
+
+  case S_REPEAT: // repeat?
+    // Key off before another repeat press is registered, so we have finished.
+    // Go back to waiting
+    if (!b)
+    {
+      k = KEY_UP;
+      fsm.state = S_IDLE;
+    }
+    else    // if (b)
+    {
+      // if the switch is still on and we have not run out of repeat time, then
+      // just wait for the timer to expire.
+      if ((now - fsm.timeActive) < prof.timeRepeat)
+        break;
+
+      // we are now sure we have a repeat, set the return code and remain in this
+      // state checking for further repeats if enabled
+      k = bitRead(prof.enableFlags, REPEAT_RESULT_ENABLE) ? KEY_RPTPRESS : KEY_PRESS;
+      fsm.timeActive = now;	// next key repeat time starts now
+    }
+    break;
+
+  case S_PRESS2A:   // Wait for key to be pressed again in double press sequence
+    if (b)
+    {
+      k = KEY_DOWN;
+      fsm.state = S_PRESS2B;		// switch detected, initiate second
+      fsm.timeActive = now;
+    }
+
+    // Check if we didn't get a second press within time - 
+    // then this was just a press and wait for key release
+    if (now - fsm.timeActive  > prof.timeDoublePress)
+    {
+      k = KEY_PRESS;
+      fsm.state = (b) ? S_WAIT : S_IDLE;
+    }
+    break;
+
+  case S_PRESS2B:   // Wait for key to be released in double press sequence
+    if (!b)
+    {
+      k = KEY_UP;
+      fsm.kPush = KEY_DPRESS;
+      fsm.state = S_IDLE;
+    }
+
+    // we didn't get a second release within time then this was just a press
+    // and we wait for the key to be released
+    if (now - fsm.timeActive >= prof.timePress*2)
+    {
+      fsm.kPush = KEY_PRESS;
+      fsm.state = (b) ? S_WAIT : S_IDLE;
+    }
+    break;
+
+  case S_WAIT:
+  default:
+    // After completing while still key active, allow the user to release the switch
+    // to meet starting conditions for S_IDLE
+    if (!b)
+    {
+      k = KEY_UP;
+      fsm.state = S_IDLE;
+    }
+    break;
+  }
+
+  return(k);
+}
+#endif
+
+template <typename P>
+uint32_t MD_UISwitch::deadline(const fsmState_t &fsm, const dbState_t &db, const P &prof, uint32_t now)
+// Work out when processFSM() will next change state with the switch
+// input unchanged. Must be kept in step with the FSM timer checks.
+{
+  uint32_t elapsed = now - fsm.timeActive;
+  uint32_t limit;
+  bool held = (fsm.state != S_IDLE && fsm.state != S_PRESS2A);
+
+  // Pushed events, debouncing and a release still working through the
+  // debounce (or the eager press release filter) need the next read straight
+  // away. Otherwise the next debounce() result is prevStatus, so the next read
+  // is also needed if this does not match what the FSM last saw.
+  if (fsm.kPush != KEY_NULL || db.RCstate == S_DEBOUNCE || db.RCstate == S_RELEASED || db.RC != 0 || db.prevStatus != held)
+    return(0);
+
+  // only an input change can move on a state with no timer
+  if (fsm.state == S_IDLE || fsm.state == S_WAIT)
+    return(DEADLINE_NONE);
+
+  limit = timerLimit(fsm.state, prof);
+
+  return((elapsed >= limit) ? 0 : limit - elapsed);
+}
+
 /**
 * Extension class MD_UISwitch_Digital.
 *
@@ -403,6 +1883,11 @@ protected:
 * with the internal pull-up enabled. Pull-down switches require an external 
 * pull-down resistor circuit. How the switch type is initialized depends on the
 * parameters passed to the class constructor.
+*
+* Where the hardware port registers can be read directly (see UI_PORT_IO), 
+* begin() groups the switch pins by hardware port and each read() then makes 
+* one register access per port rather than one digitalRead() per pin. If the pins
+* span more than UI_DIGITAL_PORTS ports, digitalRead() is used for every pin.
 */
 class MD_UISwitch_Digital: public MD_UISwitch
 {
@@ -430,7 +1915,7 @@ public:
   * \param onState   the state for the switch to be active
   */
   MD_UISwitch_Digital(uint8_t pin, uint8_t onState = KEY_ACTIVE_STATE) :
-    _pinSimple(pin), _pins(&_pinSimple), _pinCount(1), _onState(onState) {};
+    _pinSimple(pin), _pins(&_pinSimple), _pinCount(1), _onState(onState), _portCount(0) {};
 
   /**
   * Class Constructor - array of pins.
@@ -453,7 +1938,7 @@ public:
   * \param onState   the state for the switch to be active
   */
   MD_UISwitch_Digital(const uint8_t *pins, uint8_t pinCount, uint8_t onState = KEY_ACTIVE_STATE) :
-    _pins(pins), _pinCount(pinCount), _onState(onState) {};
+    _pins(pins), _pinCount(pinCount), _onState(onState), _portCount(0) {};
 
   /**
   * Class Destructor.
@@ -487,7 +1972,19 @@ public:
   *
   * \return one of the keyResult_t enumerated values
   */
-  virtual keyResult_t read(void);
+  virtual keyResult_t read(void) { return(read(UI_MILLIS())); };
+
+  /**
+  * Return the state of the switch at a given time
+  *
+  * \sa MD_UISwitch::read(uint32_t)
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(uint32_t now);
+
+  using MD_UISwitch::read;   // read(keyEvent_t*, uint8_t) key event versions
   /** @} */
 
 protected:
@@ -495,152 +1992,1560 @@ protected:
   const uint8_t *_pins;     ///< pointer to data for one or more pins
   uint8_t       _pinCount;  ///< number of pins defined
   uint8_t       _onState;   ///< digital state for ON
+
+  uint8_t       _portCount; ///< number of port groups in use, 0 if pins are read individually
+  volatile UI_PORT_TYPE *_portReg[UI_DIGITAL_PORTS];  ///< input register for each port group
+  UI_PORT_TYPE  _portMask[UI_DIGITAL_PORTS];          ///< mask of the switch pins in each port group
+
+  int16_t scanPins(int16_t &idx);   ///< read the pins individually, return the active count
+  int16_t scanPorts(int16_t &idx);  ///< read the port groups, return the active count
 };
 
 /**
-* Extension class MD_UISwitch_User.
+* Template base class MD_UISwitch_Static.
 *
-* Implements interface for user defined digital values. This provides the application
-* flexibility to implement switches through I/O extenders and still maintain the same
-* UISwitch interface.
+* Base for switch classes that are used directly rather than through an
+* MD_UISwitch pointer. It has the same methods as MD_UISwitch, but none of 
+* them are virtual. The derived class is passed as the template parameter 
+* D (the Curiously Recurring Template Pattern) so the base can call the 
+* derived class scan directly. The whole read() path can then be inlined
+* into the caller, and the objects do not carry a vtable pointer.
+* 
+* The debounce and FSM are the same as used by the MD_UISwitch classes.
+* 
+* The derived class provides
+* - void begin(void) to initialize the hardware.
+* - int16_t scan(int16_t &idx) to check the keys, returning the number of
+*   keys active and setting idx to the index of the first one found.
+* - uint8_t keyValue(int16_t idx) to return the key identifier for an 
+*   index, which is then returned by getKey().
+* 
+* The scan and keyValue methods are called by the base class, so they
+* need to be public or the base class declared a friend.
 *
-* When the current digital value is required a user defined callback function will be 
-* invoked to return the current active state of the digital I/O identified by specific
-* id. This works very similar to the MD_UISwitch_Digital class but without direct I/O 
-* access.
+* Objects of these classes cannot be used with MD_UISwitch_Group or 
+* MD_UISwitch_Queue, which need the virtual MD_UISwitch classes.
+*
+* \tparam D the derived switch class.
+* \tparam P the profile type. The default MD_UISwitch::uiProfile_t allows the
+*           options to be changed at run time, MD_UISwitch::uiFixedProfile_t 
+*           fixes them at compile time.
 */
-class MD_UISwitch_User : public MD_UISwitch
+template <class D, class P = MD_UISwitch::uiProfile_t>
+class MD_UISwitch_Static
 {
 public:
   //--------------------------------------------------------------
- /**
-  * User data function prototype
+  /** \name Class constructor and destructor.
+  * @{
+  */
+  /**
+  * Class Constructor.
   *
-  * The user data is returned from a callback function. The function must 
-  * return the current value (true if the switch is active, false otherwise) of 
-  * the digital identified by id.
+  * Initialize the timers and options to the default values.
   */
-  typedef bool(*cbUserData)(uint8_t id);
+  MD_UISwitch_Static(void) : _lastKey(0), _lastKeyIdx(-1), _newKey(false)
+  {
+    _profile.timePress = MD_UISwitch::KEY_PRESS_TIME;
+    _profile.timeDoublePress = MD_UISwitch::KEY_DPRESS_TIME;
+    _profile.timeLongPress = MD_UISwitch::KEY_LONGPRESS_TIME;
+    _profile.timeRepeat = MD_UISwitch::KEY_REPEAT_TIME;
+    setOptions(_profile, MD_UISwitch::FEATURE_DEFAULT);
+    MD_UISwitch::setDebounce(_dbTiming, 0, MD_UISwitch::DB_TC_THIRTYSECOND);
+    MD_UISwitch::setLockout(_dbTiming, false, 0);
+    MD_UISwitch::debounce(_db, _dbTiming, false, 0, true);
+    MD_UISwitch::processFSM(_fsm, _profile, false, 0, true);
+#if UI_INSTRUMENT
+    MD_UISwitch::statClear(_stats);
+    _evTime = MD_UISwitch::uiEventTime_t();
+    _statActive = false;
+#endif
+#if UI_RECORD
+    _rec = nullptr;
+#endif
+  };
 
-  /** \name Class constructor and destructor.
+  /**
+  * Class Destructor.
+  */
+  ~MD_UISwitch_Static() {};
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
   * @{
   */
   /**
-  * Class Constructor - single id.
-  *
-  * Instantiate a new instance of the class. The parameters passed are
-  * used to define the interface to the switch.
+  * Return the state of the switch
   *
-  * This form of the constructor is for a single digital id (ie,
-  * one switch).
+  * \sa MD_UISwitch::read()
   *
-  * \param id   the switch identifier for this switch
-  * \param cb   the callback to obtain the digital data state
+  * \return one of the MD_UISwitch::keyResult_t enumerated values
   */
-  MD_UISwitch_User(uint8_t id, cbUserData cb) :
-    _idSimple(id), _ids(&_idSimple), _idCount(1), _cb(cb) {};
+  MD_UISwitch::keyResult_t read(void) { return(read(UI_MILLIS())); };
 
   /**
-  * Class Constructor - array of id.
-  *
-  * Instantiate a new instance of the class. The parameters passed are
-  * used to the interface hardware to the switch.
+  * Return the state of the switch at a given time
   *
-  * This form of the constructor is for an array of digital ids. The
-  * data is not copied from the user code, so the array elements need
-  * to remain in scope and constant for the life of the object.
+  * \sa MD_UISwitch::read(uint32_t)
   *
-  * \param ids      pointer to array of switch identifiers for these switches
-  * \param idCount  the number of id in the ids[] array
-  * \param cb       the callback to obtain the digital data state
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the MD_UISwitch::keyResult_t enumerated values
   */
-  MD_UISwitch_User(uint8_t* ids, uint8_t idCount, cbUserData cb) :
-    _ids(ids), _idCount(idCount), _cb(cb) {};
+  MD_UISwitch::keyResult_t read(uint32_t now)
+  {
+    UI_STAT_READ(_stats);
+    int16_t idx = -1;
+    int16_t count = static_cast<D*>(this)->scan(idx);
+
+    if (count == 1) _lastKey = static_cast<D*>(this)->keyValue(idx);
+
+    return(MD_UISwitch::processKey(*this, _profile, count, idx, now));
+  };
 
   /**
-  * Class Destructor.
+  * Return the key events
   *
-  * Release allocated memory and does the necessary to clean up once the queue is
-  * no longer required.
+  * \sa MD_UISwitch::read(MD_UISwitch::keyEvent_t*, uint8_t, uint32_t)
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \return the number of events placed in the buffer.
   */
-  ~MD_UISwitch_User() {};
+  uint8_t read(MD_UISwitch::keyEvent_t *ev, uint8_t evSize) { return(read(ev, evSize, UI_MILLIS())); };
 
-  /** @} */
-  //--------------------------------------------------------------
-  /** \name Methods for core object control.
-  * @{
+  /**
+  * Return the key events at a given time
+  *
+  * \sa MD_UISwitch::read(MD_UISwitch::keyEvent_t*, uint8_t, uint32_t)
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \param now     the current time, as returned by UI_MILLIS().
+  * \return the number of events placed in the buffer.
   */
+  uint8_t read(MD_UISwitch::keyEvent_t *ev, uint8_t evSize, uint32_t now)
+    { return(MD_UISwitch::readEvents(*this, ev, evSize, now)); };
+
   /**
-  * Initialize the object.
+  * Get the value of the last key
   *
-  * Initialize the object data. This needs to be called during setup() to initialize new
-  * data for the class that cannot be done during the object creation.
+  * \sa MD_UISwitch::getKey()
+  *
+  * \return the identifier of the last switch detected.
   */
-  virtual void begin(void);
+  uint8_t getKey(void) { return(_lastKey); };
 
   /**
-  * Return the state of the switch
+  * Time until the switch next needs to be read
   *
-  * Return one of the keypress types depending on what has been detected.
-  * The timing for each keypress starts when the first transition of the
-  * switch from inactive to active state and is recognized by a finite
-  * state machine whose operation is directed by the timer and option
-  * values specified.
+  * \sa MD_UISwitch::nextDeadline()
   *
-  * \return one of the keyResult_t enumerated values
+  * \return the milliseconds to the next timed event, 0 or MD_UISwitch::DEADLINE_NONE.
   */
-  virtual keyResult_t read(void);
-  /** @} */
+  uint32_t nextDeadline(void) { return(nextDeadline(UI_MILLIS())); };
 
-protected:
+  /**
+  * Time until the switch next needs to be read, from a given time
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the milliseconds to the next timed event, 0 or MD_UISwitch::DEADLINE_NONE.
+  */
+  uint32_t nextDeadline(uint32_t now) { return(_newKey ? 0 : MD_UISwitch::deadline(_fsm, _db, _profile, now)); };
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for object parameters and options.
+  * @{
+  */
+  /**
+  * Set the press time
+  *
+  * \sa MD_UISwitch::setPressTime()
+  *
+  * \param t the specified time in milliseconds.
+  */
+  inline void setPressTime(uint16_t t) { _profile.timePress = t; };
+
+  /**
+  * Set the double press detection time
+  *
+  * \sa MD_UISwitch::setDoublePressTime()
+  *
+  * \param t the specified time in milliseconds.
+  */
+  inline void setDoublePressTime(uint16_t t) { _profile.timeDoublePress = t; enableDoublePress(true); };
+
+  /**
+  * Set the long press detection time
+  *
+  * \sa MD_UISwitch::setLongPressTime()
+  *
+  * \param t the specified time in milliseconds.
+  */
+  inline void setLongPressTime(uint16_t t) { _profile.timeLongPress = t; enableLongPress(true); };
+
+  /**
+  * Set the repeat time
+  *
+  * \sa MD_UISwitch::setRepeatTime()
+  *
+  * \param t the specified time in milliseconds.
+  */
+  inline void setRepeatTime(uint16_t t) { _profile.timeRepeat = t; enableRepeat(true); };
+
+  /**
+  * Set the debounce time
+  *
+  * \sa MD_UISwitch::setDebounceTime()
+  *
+  * \param t  the debounce time in milliseconds, 0 for one step per read (default).
+  * \param tc the filter time constant.
+  */
+  inline void setDebounceTime(uint16_t t, MD_UISwitch::debounceTC_t tc = MD_UISwitch::DB_TC_THIRTYSECOND)
+    { MD_UISwitch::setDebounce(_dbTiming, (uint32_t)t * 1000, tc); };
+
+  /**
+  * Set the debounce time in microseconds
+  *
+  * \sa MD_UISwitch::setDebounceTimeUs()
+  *
+  * \param t  the debounce time in microseconds, 0 for one step per read (default).
+  * \param tc the filter time constant.
+  */
+  inline void setDebounceTimeUs(uint16_t t, MD_UISwitch::debounceTC_t tc = MD_UISwitch::DB_TC_THIRTYSECOND)
+    { MD_UISwitch::setDebounce(_dbTiming, t, tc); };
+
+  /**
+  * Enable eager press debounce
+  *
+  * \sa MD_UISwitch::enableEagerPress()
+  *
+  * \param f true to enable eager press, false to filter the press (default).
+  * \param t the lockout time in milliseconds, up to 65ms.
+  */
+  inline void enableEagerPress(bool f, uint8_t t = MD_UISwitch::KEY_LOCKOUT_TIME)
+    { MD_UISwitch::setLockout(_dbTiming, f, t); };
+
+  /**
+  * Allow double press to be returned
+  *
+  * Ignored if the options are fixed at compile time.
+  *
+  * \sa MD_UISwitch::enableDoublePress()
+  *
+  * \param f true to enable, false to disable.
+  */
+  inline void enableDoublePress(boolean f) { setOption(_profile, MD_UISwitch::FEATURE_DPRESS, f); };
+
+  /**
+  * Allow long press to be returned
+  *
+  * Ignored if the options are fixed at compile time.
+  *
+  * \sa MD_UISwitch::enableLongPress()
+  *
+  * \param f true to enable, false to disable.
+  */
+  inline void enableLongPress(boolean f) { setOption(_profile, MD_UISwitch::FEATURE_LONGPRESS, f); };
+
+  /**
+  * Allow repeat press to be returned
+  *
+  * Ignored if the options are fixed at compile time.
+  *
+  * \sa MD_UISwitch::enableRepeat()
+  *
+  * \param f true to enable, false to disable.
+  */
+  inline void enableRepeat(boolean f) { setOption(_profile, MD_UISwitch::FEATURE_REPEAT, f); };
+
+  /**
+  * Allow repeat press to return KEY_RPTPRESS
+  *
+  * Ignored if the options are fixed at compile time.
+  *
+  * \sa MD_UISwitch::enableRepeatResult()
+  *
+  * \param f true to enable, false to disable.
+  */
+  inline void enableRepeatResult(boolean f) { setOption(_profile, MD_UISwitch::FEATURE_REPEAT_RESULT, f); };
+  /** @} */
+
+#if UI_INSTRUMENT
+  //--------------------------------------------------------------
+  /** \name Methods for instrumentation, if UI_INSTRUMENT is set.
+  * @{
+  */
+  /**
+  * Get the switch counters
+  *
+  * \sa MD_UISwitch::getStats()
+  *
+  * \return the counters for the switch.
+  */
+  inline const MD_UISwitch::uiStats_t &getStats(void) const { return(_stats); };
+
+  /**
+  * Get the times for the last event
+  *
+  * \sa MD_UISwitch::getEventTime()
+  *
+  * \return the times for the last event.
+  */
+  inline const MD_UISwitch::uiEventTime_t &getEventTime(void) const { return(_evTime); };
+
+  /**
+  * Clear the switch counters
+  */
+  inline void clearStats(void) { MD_UISwitch::statClear(_stats); };
+  /** @} */
+#endif
+
+#if UI_RECORD
+  /**
+  * Attach an input recorder
+  *
+  * \sa MD_UISwitch::setRecorder()
+  *
+  * \param rec the recorder, nullptr to stop recording.
+  */
+  inline void setRecorder(MD_UISwitch_Recorder *rec) { _rec = rec; };
+#endif
+
+protected:
+  friend class MD_UISwitch;   // for processKey()
+
+  MD_UISwitch::fsmState_t _fsm;   ///< FSM state for the switch
+  MD_UISwitch::dbState_t  _db;    ///< debouncing state for the switch
+  MD_UISwitch::dbTiming_t _dbTiming; ///< debounce time constant and step time for the switch
+#if UI_INSTRUMENT
+  MD_UISwitch::uiStats_t     _stats;      ///< counters for the switch
+  MD_UISwitch::uiEventTime_t _evTime;     ///< times for the last event
+  bool          _statActive; ///< debounced state last seen, for the event times
+#endif
+#if UI_RECORD
+  MD_UISwitch_Recorder *_rec;  ///< input recorder, nullptr if none
+#endif
+  P         _profile;       ///< timer values and enabled options for the switch
+
+  uint8_t   _lastKey;       ///< persists the last key value until a new one is detected
+  int16_t   _lastKeyIdx;    ///< internal index of the last key read
+  bool      _newKey;        ///< last read found a new key, not passed to the debounce until the next read
+
+  static void setOption(MD_UISwitch::uiProfile_t &p, uint8_t mask, bool f)  ///< change runtime options
+  { if (f) p.enableFlags |= mask; else p.enableFlags &= ~mask; };
+
+  template <uint8_t F>
+  static void setOption(MD_UISwitch::uiFixedProfile_t<F> &, uint8_t, bool) {}; ///< fixed options, nothing to change
+
+  static void setOptions(MD_UISwitch::uiProfile_t &p, uint8_t mask) { p.enableFlags = mask; }; ///< set all runtime options
+
+  template <uint8_t F>
+  static void setOptions(MD_UISwitch::uiFixedProfile_t<F> &, uint8_t) {}; ///< fixed options, nothing to set
+};
+
+/**
+* Template class MD_UISwitch_DigitalT.
+*
+* Compile time version of MD_UISwitch_Digital for applications where the 
+* switch pins, active level and FSM options are fixed when the code is written.
+* 
+* These are given as template parameters, so the compiler can 
+* - unroll the pin scan into a sequence of reads of constant pins,
+* - remove the FSM code for options that are not enabled,
+* - call everything directly rather than through virtual methods 
+*   (see MD_UISwitch_Static).
+* The result is smaller and faster than the equivalent MD_UISwitch_Digital
+* object, but the options cannot be changed at run time. The timer values can 
+* still be changed.
+*
+* The events reported are the same as an MD_UISwitch_Digital object with the 
+* same pins and options.
+*
+* \code
+* // active LOW switches on pins 2 to 5, double press and long press only
+* MD_UISwitch_DigitalT<LOW, MD_UISwitch::FEATURE_DPRESS | MD_UISwitch::FEATURE_LONGPRESS, 2, 3, 4, 5> S;
+* \endcode
+*
+* \tparam ACTIVE   the digital state for the switch to be active (LOW or HIGH).
+* \tparam FEATURES the MD_UISwitch::FEATURE_* masks for the enabled options.
+* \tparam PINS     the digital pins to which the switches are connected.
+*/
+template <uint8_t ACTIVE, uint8_t FEATURES, uint8_t... PINS>
+class MD_UISwitch_DigitalT : 
+  public MD_UISwitch_Static<MD_UISwitch_DigitalT<ACTIVE, FEATURES, PINS...>, MD_UISwitch::uiFixedProfile_t<FEATURES> >
+{
+public:
+  static_assert(sizeof...(PINS) != 0, "MD_UISwitch_DigitalT needs at least one pin");
+  static_assert(FEATURES < 16, "MD_UISwitch_DigitalT FEATURES must be MD_UISwitch::FEATURE_* masks");
+
+  /**
+  * Initialize the object.
+  *
+  * Initialize the pins. This needs to be called during setup().
+  */
+  void begin(void)
+  {
+    bool unroll[] = { initPin(PINS)... };
+    (void)unroll;
+  };
+
+  /**
+  * Scan the switches
+  *
+  * Called by MD_UISwitch_Static::read().
+  *
+  * \param idx set to the index of the first active switch.
+  * \return the number of active switches.
+  */
+  int16_t scan(int16_t &idx)
+  {
+    int16_t count = 0;
+    uint8_t i = 0;
+    bool unroll[] = { scanPin(PINS, i++, idx, count)... };
+
+    (void)unroll;
+    return(count);
+  };
+
+  /**
+  * Pin number for a switch index
+  *
+  * Called by MD_UISwitch_Static::read().
+  *
+  * \param idx the index of the switch.
+  * \return the pin number, returned by getKey().
+  */
+  uint8_t keyValue(int16_t idx)
+  {
+    static const uint8_t pin[] = { PINS... };
+    return(pin[idx]);
+  };
+
+protected:
+  static bool initPin(uint8_t pin)  ///< set the pin mode, one call per pin
+  {
+    UI_PIN_MODE(pin, ACTIVE == LOW ? INPUT_PULLUP : INPUT);
+    return(true);
+  };
+
+  static bool scanPin(uint8_t pin, uint8_t i, int16_t &idx, int16_t &count)  ///< check one pin, one call per pin
+  {
+    if (UI_DIGITAL_READ(pin) == ACTIVE)
+    {
+      if (idx == -1) idx = i;  // only record the first one
+      count++;
+    }
+    return(true);
+  };
+};
+
+/**
+* Extension class MD_UISwitch_User.
+*
+* Implements interface for user defined digital values. This provides the application
+* flexibility to implement switches through I/O extenders and still maintain the same
+* UISwitch interface.
+*
+* When the current digital value is required a user defined callback function will be 
+* invoked to return the current active state of the digital I/O identified by specific
+* id. This works very similar to the MD_UISwitch_Digital class but without direct I/O 
+* access.
+*
+* Where the switch states are read together, such as the ports of an I/O expander
+* on an I2C bus, a bulk callback can be used instead. This is invoked once for each 
+* read() and returns the active state of all the ids as a bit mask, so only one bus
+* transaction is needed rather than one for each switch.
+*/
+class MD_UISwitch_User : public MD_UISwitch
+{
+public:
+  //--------------------------------------------------------------
+ /**
+  * User data function prototype
+  *
+  * The user data is returned from a callback function. The function must 
+  * return the current value (true if the switch is active, false otherwise) of 
+  * the digital identified by id.
+  */
+  typedef bool(*cbUserData)(uint8_t id);
+
+  /**
+  * User bulk data function prototype
+  *
+  * The user data for all the ids is returned from one call of a callback function.
+  * The function must return a bit mask with bit n set if the digital identified by 
+  * id n is active. Ids used with a bulk callback must be in the range 0 to 31.
+  */
+  typedef uint32_t(*cbUserBulk)(void);
+
+  /** \name Class constructor and destructor.
+  * @{
+  */
+  /**
+  * Class Constructor - single id.
+  *
+  * Instantiate a new instance of the class. The parameters passed are
+  * used to define the interface to the switch.
+  *
+  * This form of the constructor is for a single digital id (ie,
+  * one switch).
+  *
+  * \param id   the switch identifier for this switch
+  * \param cb   the callback to obtain the digital data state
+  */
+  MD_UISwitch_User(uint8_t id, cbUserData cb) :
+    _idSimple(id), _ids(&_idSimple), _idCount(1), _cb(cb), _cbBulk(nullptr) {};
+
+  /**
+  * Class Constructor - array of id.
+  *
+  * Instantiate a new instance of the class. The parameters passed are
+  * used to the interface hardware to the switch.
+  *
+  * This form of the constructor is for an array of digital ids. The
+  * data is not copied from the user code, so the array elements need
+  * to remain in scope and constant for the life of the object.
+  *
+  * \param ids      pointer to array of switch identifiers for these switches
+  * \param idCount  the number of id in the ids[] array
+  * \param cb       the callback to obtain the digital data state
+  */
+  MD_UISwitch_User(uint8_t* ids, uint8_t idCount, cbUserData cb) :
+    _ids(ids), _idCount(idCount), _cb(cb), _cbBulk(nullptr) {};
+
+  /**
+  * Class Constructor - array of id, bulk callback.
+  *
+  * Instantiate a new instance of the class. The parameters passed are
+  * used to the interface hardware to the switch.
+  *
+  * This form of the constructor is for an array of digital ids read together
+  * using a bulk callback. The ids must be in the range 0 to 31. The data is not
+  * copied from the user code, so the array elements need to remain in scope 
+  * and constant for the life of the object.
+  *
+  * \param ids      pointer to array of switch identifiers for these switches
+  * \param idCount  the number of id in the ids[] array
+  * \param cb       the callback to obtain the digital data state of all the ids
+  */
+  MD_UISwitch_User(uint8_t* ids, uint8_t idCount, cbUserBulk cb) :
+    _ids(ids), _idCount(idCount), _cb(nullptr), _cbBulk(cb) {};
+
+  /**
+  * Class Destructor.
+  *
+  * Release allocated memory and does the necessary to clean up once the queue is
+  * no longer required.
+  */
+  ~MD_UISwitch_User() {};
+
+  /** @} */
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+  * @{
+  */
+  /**
+  * Initialize the object.
+  *
+  * Initialize the object data. This needs to be called during setup() to initialize new
+  * data for the class that cannot be done during the object creation.
+  */
+  virtual void begin(void);
+
+  /**
+  * Return the state of the switch
+  *
+  * Return one of the keypress types depending on what has been detected.
+  * The timing for each keypress starts when the first transition of the
+  * switch from inactive to active state and is recognized by a finite
+  * state machine whose operation is directed by the timer and option
+  * values specified.
+  *
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(void) { return(read(UI_MILLIS())); };
+
+  /**
+  * Return the state of the switch at a given time
+  *
+  * \sa MD_UISwitch::read(uint32_t)
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(uint32_t now);
+
+  using MD_UISwitch::read;   // read(keyEvent_t*, uint8_t) key event versions
+  /** @} */
+
+protected:
   uint8_t   _idSimple; ///< number for simple id
   uint8_t*  _ids;      ///< pointer to data for one or more ids
   uint8_t   _idCount;  ///< number of ids defined
   cbUserData _cb;      ///< callback to obtain user digital data
+  cbUserBulk _cbBulk;  ///< callback to obtain user digital data for all ids, nullptr if not used
+};
+
+/**
+* Parallel debounce class template MD_UISwitch_VDebounce.
+*
+* Debounces 8, 16 or 32 switches at once, one per bit of a word of type T
+* (uint8_t, uint16_t or uint32_t). Each call to update() is passed a sample of
+* all the switches, with a 1 bit for an active switch, and returns the debounced
+* state of all of them as a bit mask.
+*
+* A switch only changes debounced state once it has been sampled in the new
+* state DEBOUNCE_COUNT times in a row. The count for each switch is held in a 2 bit
+* vertical counter - bit 0 of all the counts in one word and bit 1 in another -
+* so update() takes the same few bitwise operations however many of the switches
+* are changing, and each switch costs 5 bits of RAM.
+*
+* The switches that changed state in the last update() are returned by
+* getPressed() and getReleased(). These masks and the debounced state can be
+* used to run the FSM for each switch only when it needs it, as
+* MD_UISwitch_Bank does when set up with a word callback.
+*
+* \tparam T the unsigned integer type holding the switch bits.
+*/
+template <typename T>
+class MD_UISwitch_VDebounce
+{
+public:
+  static const uint8_t DEBOUNCE_COUNT = 4;  ///< samples in a row needed to change state
+
+  /**
+  * Class Constructor.
+  *
+  * All the switches start inactive.
+  */
+  MD_UISwitch_VDebounce(void) { reset(); };
+
+  /**
+  * Reset the debounce state
+  *
+  * Set the debounced state and clear all the counts and edges.
+  *
+  * \param state the debounced state for all the switches.
+  */
+  void reset(T state = 0) { _state = state; _cnt0 = _cnt1 = _pressed = _released = 0; };
+
+  /**
+  * Debounce a new sample
+  *
+  * Count the switches whose sample differs from their debounced state, and
+  * change the state of those that have differed DEBOUNCE_COUNT times in a row.
+  * A switch whose sample matches its debounced state restarts its count.
+  *
+  * \param sample the current state of the switches, 1 for active.
+  * \return the debounced state of the switches.
+  */
+  T update(T sample)
+  {
+    T delta = sample ^ _state;
+    T toggle;
+
+    _cnt1 = (T)((_cnt1 ^ _cnt0) & delta);
+    _cnt0 = (T)(~_cnt0 & delta);
+    toggle = (T)(delta & ~(_cnt0 | _cnt1));   // counts that have wrapped to 0
+    _state ^= toggle;
+    _pressed = toggle & _state;
+    _released = (T)(toggle & ~_state);
+
+    return(_state);
+  };
+
+  inline T getState(void) const { return(_state); };         ///< Debounced state, 1 for an active switch
+  inline T getPressed(void) const { return(_pressed); };     ///< Switches that became active in the last update()
+  inline T getReleased(void) const { return(_released); };   ///< Switches that became inactive in the last update()
+  inline T getCounting(void) const { return(_cnt0 | _cnt1); }; ///< Switches with a change of state being debounced
+
+protected:
+  T _state;     ///< debounced state
+  T _cnt0;      ///< bit 0 of the vertical counter
+  T _cnt1;      ///< bit 1 of the vertical counter
+  T _pressed;   ///< switches that became active in the last update
+  T _released;  ///< switches that became inactive in the last update
+};
+
+/**
+* Extension class MD_UISwitch_Bank.
+*
+* Implements a bank of many independent switches, such as a large front panel,
+* using as little RAM as possible for each switch.
+*
+* As for MD_UISwitch_User, the current digital value of each switch is obtained
+* from a user callback function. The id passed to the callback is the key number
+* (0 to keyCount-1). Each key has its own debounce and FSM state, so any number
+* of keys can be active at the same time, and the events are returned as key/event
+* pairs by read(keyEvent_t*, uint8_t).
+*
+* The state for each key is packed into 5 bytes, held structure-of-arrays style
+* in three arrays provided by the application:
+* - uint8_t  RC debounce integrator value.
+* - uint16_t FSM state, pushed key, debounce state and profile bit fields.
+* - uint16_t the low 16 bits of the FSM timer.
+*
+* The arrays are not copied, so they must remain in scope for the life of the object.
+*
+* Where the switch states can be read many at a time, such as from port registers
+* or shift registers, the bank can instead be set up with a callback that returns
+* the state of 32 keys at once as a bit mask (cbBankWord). All the keys are then
+* debounced together by an MD_UISwitch_VDebounce for each 32 keys, held in a
+* bankWord_t array provided by the application in place of the RC integrator array.
+* The FSM is only run for keys that are debounced active or still have FSM
+* processing in progress, so a word of idle keys is skipped with a single test.
+* The debounce is not the RC integrator used by the other switches - a key changes
+* state after MD_UISwitch_VDebounce::DEBOUNCE_COUNT reads in a row in the new state.
+*
+* There is no room in the packed key state to time the debounce filter steps, so
+* setDebounceTime() only selects the time constant and the filter always takes one
+* step per read(). For the same reason enableEagerPress() is ignored.
+* As the FSM timer is held in 16 bits, read() must be called at least every 65 seconds.
+*
+* Keys share up to PROFILE_COUNT timer and option profiles. Profile 0 is always the
+* object's current settings. Other profiles are set by changing the object settings
+* using the normal methods and then saving them with saveProfile().
+*/
+class MD_UISwitch_Bank : public MD_UISwitch
+{
+public:
+  static const uint8_t PROFILE_COUNT = 4;  ///< number of timer and option profiles
+
+  /**
+  * Word callback function prototype.
+  *
+  * Used by the bank to read the state of 32 keys at once. Bit n of the return
+  * value is the state of key (word * 32 + n), 1 for active. Bits for keys past
+  * the end of the bank are ignored.
+  *
+  * \param word the word number, 0 for keys 0 to 31, 1 for keys 32 to 63, etc.
+  * \return the bit mask of the key states.
+  */
+  typedef uint32_t(*cbBankWord)(uint8_t word);
+
+  /**
+  * Word state
+  *
+  * The debounce state for 32 keys when the bank reads its keys a word at a time.
+  * The application provides an array of these, one for each 32 keys.
+  */
+  typedef struct
+  {
+    MD_UISwitch_VDebounce<uint32_t> db; ///< parallel debounce for the keys
+    uint32_t busy;                      ///< keys with FSM processing in progress
+  } bankWord_t;
+
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+  * @{
+  */
+  /**
+  * Class Constructor.
+  *
+  * Instantiate a new instance of the class. The parameters passed are
+  * used to define the interface to the switches and the state storage.
+  *
+  * \param keyCount the number of keys in the bank.
+  * \param cb       the callback to obtain the digital data state for each key.
+  * \param rc       array of keyCount elements for the debounce integrators.
+  * \param state    array of keyCount elements for the packed key states.
+  * \param time     array of keyCount elements for the FSM timers.
+  */
+  MD_UISwitch_Bank(uint8_t keyCount, MD_UISwitch_User::cbUserData cb, uint8_t *rc, uint16_t *state, uint16_t *time);
+
+  /**
+  * Class Constructor - word callback.
+  *
+  * Instantiate a new instance of the class with the switch states read 32 keys
+  * at a time and debounced in parallel.
+  *
+  * \param keyCount the number of keys in the bank.
+  * \param cb       the callback to obtain the digital data state for each 32 keys.
+  * \param word     array of (keyCount+31)/32 elements for the parallel debounce state.
+  * \param state    array of keyCount elements for the packed key states.
+  * \param time     array of keyCount elements for the FSM timers.
+  */
+  MD_UISwitch_Bank(uint8_t keyCount, cbBankWord cb, bankWord_t *word, uint16_t *state, uint16_t *time);
+
+  /**
+  * Class Destructor.
+  *
+  * Release allocated memory and does the necessary to clean up once the queue is
+  * no longer required.
+  */
+  ~MD_UISwitch_Bank() {};
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+  * @{
+  */
+  /**
+  * Initialize the object.
+  *
+  * Initialize the object data. This needs to be called during setup() to initialize new
+  * data for the class that cannot be done during the object creation. All the keys are
+  * reset and set to use profile 0.
+  */
+  virtual void begin(void);
+
+  /**
+  * Return the state of the switch
+  *
+  * Process all the keys and return the first event detected. getKey() returns the
+  * number of the key for the event. Any other keys are picked up by the next call.
+  *
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(void) { return(read(UI_MILLIS())); };
+
+  /**
+  * Return the state of the switch at a given time
+  *
+  * \sa MD_UISwitch::read(uint32_t)
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(uint32_t now);
+
+  /**
+  * Return all the key events
+  *
+  * Process all the keys and return the events detected as key number and keyResult_t
+  * pairs. If the event buffer fills, the remaining keys are processed first on the
+  * next call.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \return the number of events placed in the buffer.
+  */
+  uint8_t read(keyEvent_t *ev, uint8_t evSize) { return(read(ev, evSize, UI_MILLIS())); };
+
+  /**
+  * Return all the key events at a given time
+  *
+  * Same as read(keyEvent_t*, uint8_t) using the time passed for the FSM timing.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \param now     the current time, as returned by UI_MILLIS().
+  * \return the number of events placed in the buffer.
+  */
+  virtual uint8_t read(keyEvent_t *ev, uint8_t evSize, uint32_t now);
+
+  /**
+  * Time to the next timed event
+  *
+  * The earliest deadline for all the keys in the bank.
+  *
+  * \sa MD_UISwitch::nextDeadline()
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  virtual uint32_t nextDeadline(uint32_t now);
+
+  virtual uint32_t nextDeadline(void) { return(nextDeadline(UI_MILLIS())); };  ///< Time to the next timed event, see nextDeadline(uint32_t)
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for key profiles.
+  * @{
+  */
+  /**
+  * Save the current settings as a profile
+  *
+  * Save a copy of the object's current timer and option settings as
+  * profile p (1 to PROFILE_COUNT-1). Profile 0 always uses the current settings.
+  *
+  * \param p the profile number.
+  */
+  void saveProfile(uint8_t p);
+
+  /**
+  * Set the profile for a key
+  *
+  * Set the timer and option profile used by the key. This should be done after
+  * begin() as that sets all the keys to profile 0.
+  *
+  * \param key the key number.
+  * \param p   the profile number (0 to PROFILE_COUNT-1).
+  */
+  void setKeyProfile(uint8_t key, uint8_t p);
+  /** @} */
+
+protected:
+  // Bit fields in the packed key state
+  static const uint8_t  PK_FSM = 0;          ///< FSM state bit position, 3 bits
+  static const uint8_t  PK_PUSH = 3;         ///< FSM pushed key bit position, 3 bits
+  static const uint8_t  PK_DB = 6;           ///< debounce state bit position, 2 bits
+  static const uint8_t  PK_PREV = 8;         ///< debounce previous status bit position, 1 bit
+  static const uint8_t  PK_PROFILE = 9;      ///< profile bit position, 2 bits
+  static const uint16_t PK_PROFILE_MASK = (0x3 << PK_PROFILE); ///< profile bits mask
+
+  uint8_t   _keyCount;   ///< number of keys in the bank
+  MD_UISwitch_User::cbUserData _cb;  ///< callback to obtain user digital data
+  cbBankWord _cbWord;    ///< callback to obtain user digital data 32 keys at a time, nullptr if not used
+  uint8_t   *_rc;        ///< debounce RC integrator for each key
+  bankWord_t *_word;     ///< parallel debounce state for each 32 keys
+  uint16_t  *_state;     ///< packed state for each key
+  uint16_t  *_time;      ///< low 16 bits of the FSM timer for each key
+  uint8_t   _nextKey;    ///< next key to process
+  uiProfile_t _profTable[PROFILE_COUNT - 1];  ///< saved profiles 1 onwards
+
+  uint8_t readWords(keyEvent_t *ev, uint8_t evSize, uint32_t now);  ///< read() for keys read a word at a time
+};
+
+/**
+* Extension class MD_UISwitch_Analog.
+*
+* Implements resistor ladder switches on analog input. This type of switch
+* are typically found on 1602 LCD module shields.
+*
+* image{inline} html lcd_shield.jpg "LCD Shield"
+*
+* All the switches are wired to one analog input, generally with resistor values 
+* as shown in the circuit below. The switch pressed is determined
+* from the analog value read from the port. This may vary depending on the 
+* implementation of the resistor, so a translation table is implemented to allow
+* the remapping of the analog value to a key number.
+*
+* \image{inline} html lcd_switch_ladder.png "Analog Ladder Circuit"
+*
+* The translation table must be determined separately and passed as a parameter to 
+* the class constructor - the utility application Test_Analog_Keys in the examples 
+* folder can be used for this purpose. The class does not copy this table to its 
+* own memory, so it must remain in scope for the life of the object.
+*
+* By default read() checks the analog value against each entry in the table 
+* in turn. For larger tables, a lookup table indexed by the analog value can 
+* be supplied using setLookup() or setLookup_P(). Each byte of the lookup table
+* covers 2^shift ADC counts, and read() then finds the key with one table 
+* access and one range check. The lookup gives the same results as the 
+* sequential search. 
+* 
+* begin() also checks the table for keys whose tolerance windows overlap (see
+* getOverlap()). Where windows overlap, the first matching entry in the table
+* is used.
+*
+* Each analog conversion takes around 100us on AVR processors, and read()
+* normally waits for it. With enableAsyncRead() set, each read() instead
+* collects the result of the conversion started by the previous call and 
+* starts the next one (see UI_ANALOG_START), so it never waits. Only one 
+* switch can use this mode at a time.
+*
+* While a key on the ladder is pressed or released, the analog value can pass 
+* through the windows of other keys, and contact noise can briefly give values 
+* outside the key window. Each change of key resets the debounce and FSM. The
+* analog values can be filtered with a median of 3 filter (enableMedian()) 
+* to remove single sample spikes, and a new key only accepted once it has been 
+* seen for a number of samples in a row (setSettleCount()).
+*/
+class MD_UISwitch_Analog : public MD_UISwitch
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Enumerated values and Typedefs.
+  * @{
+  */
+  /**
+  * Data table for switch values
+  *
+  * The read() will use this table to determine which key has been pressed
+  * and getKey() will return the specified identifier.
+  */
+  typedef struct
+  {
+    uint16_t  adcThreshold; ///< Average analog value of the 
+    uint8_t   adcTolerance; ///< Valid +/- tolerance range around adcThreshold for a key
+    uint8_t   value;        ///< Identifier for this key, returned using getKey()
+  } uiAnalogKeys_t;
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+  * @{
+  */
+  /**
+  * Class Constructor.
+  *
+  * Instantiate a new instance of the class. The parameters passed are
+  * used to the hardware interface to the switch.
+  *
+  * The key definitions table is not copied by the class, so user code
+  * must ensure that the table remains in scope for the life of the object 
+  * created.
+  *
+  * \param pin    the analog pin to which the switches are connected.
+  * \param kt     pointer to a table of analog value key definitions
+  * \param ktSize number of elements in the kt table
+  */
+  MD_UISwitch_Analog(uint8_t pin, uiAnalogKeys_t* kt, uint8_t ktSize) :
+    _pin(pin), _kt(kt), _ktSize(ktSize), _lut(nullptr), _lutP(nullptr), _lutShift(0), _overlap(false),
+    _async(false), _adcBusy(false), _adcHeld(false), _median(false), _histCount(0), _settle(1), _candCount(1), _candIdx(-1), _keyIdx(-1) {};
+
+  /**
+  * Class Destructor.
+  *
+  * Release allocated memory and does the necessary to clean up once the queue is
+  * no longer required.
+  */
+  ~MD_UISwitch_Analog() {};
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+  * @{
+  */
+  /**
+  * Initialize the object.
+  *
+  * Initialize the object data. This needs to be called during setup() to initialize new
+  * data for the class that cannot be done during the object creation.
+  */
+  virtual void begin(void);
+
+  /**
+  * Return the state of the switch
+  *
+  * Return one of the keypress types depending on what has been detected.
+  * The timing for each keypress starts when the first transition of the
+  * switch from inactive to active state and is recognized by a finite
+  * state machine whose operation is directed by the timer and option
+  * values specified.
+  *
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(void) { return(read(UI_MILLIS())); };
+
+  /**
+  * Return the state of the switch at a given time
+  *
+  * \sa MD_UISwitch::read(uint32_t)
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(uint32_t now);
+
+  using MD_UISwitch::read;   // read(keyEvent_t*, uint8_t) key event versions
+
+  /**
+  * Check for overlapping key windows
+  *
+  * Set by begin() if the tolerance windows of any two entries in the key
+  * table overlap, which usually means the table needs adjusting.
+  *
+  * \return true if there are overlapping windows in the key table.
+  */
+  inline bool getOverlap(void) { return(_overlap); };
+
+  /**
+  * Read the analog input without waiting
+  *
+  * When enabled, read() collects the result of the analog conversion 
+  * started on the previous call, if it has finished, and then starts the next 
+  * one. If the conversion has not finished, read() returns KEY_NULL straight
+  * away with the switch state unchanged. Each conversion result is processed
+  * exactly once, so the debounce works on the same number of samples as 
+  * when the mode is disabled.
+  *
+  * Each result is one read() call old, which may be longer if the switch
+  * is read infrequently (eg, using nextDeadline()).
+  *
+  * The ADC conversion in progress is shared hardware, so only one switch can
+  * use the mode at a time. Enabling it for another switch has no effect until
+  * it is disabled on the first. Other MD_UISwitch_Analog switches read without
+  * the mode wait for the conversion in progress and keep its result for the 
+  * switch that started it. The application must not call analogRead() while
+  * the mode is enabled, as it would return the result of the conversion in 
+  * progress. Enabling the mode makes one analogRead() to set up the ADC, so 
+  * any analogReference() call must be made before.
+  *
+  * \param f true to enable, false to disable (default).
+  */
+  void enableAsyncRead(boolean f);
+
+  /**
+  * Filter the analog values
+  *
+  * When enabled, each analog value is replaced by the median of it and 
+  * the previous two values before the key is found. This removes single 
+  * sample spikes, but delays any change by one sample.
+  *
+  * \param f true to enable, false to disable (default).
+  */
+  inline void enableMedian(boolean f) { _median = f; _histCount = 0; };
+
+  /**
+  * Set the number of samples for a new key
+  *
+  * A different key, or no key, is only accepted after it has been found in 
+  * this number of samples in a row. Until then, the previous key is used. A
+  * value of 1 (default) accepts every change straight away.
+  *
+  * \param n the number of samples, 1 or more.
+  */
+  inline void setSettleCount(uint8_t n) { _settle = (n == 0) ? 1 : n; _candCount = _settle; };
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for key lookup table.
+  * @{
+  */
+  /**
+  * Number of bytes in a lookup table
+  *
+  * The size of the table needed for the shift value, covering all the
+  * values from 0 to UI_ANALOG_MAX.
+  *
+  * \param shift the number of ADC value bits dropped, each table byte covers 2^shift counts.
+  * \return the size of the table in bytes.
+  */
+  static constexpr uint16_t lookupSize(uint8_t shift) { return((UI_ANALOG_MAX >> shift) + 1); };
+
+  /**
+  * Set a lookup table in RAM
+  *
+  * The table is filled in by begin() from the key table, so this must
+  * be called before begin(). The lookup table is not copied and must
+  * remain in scope for the life of the object. The key table must have fewer
+  * than LUT_SHARED entries.
+  *
+  * \param lut   array of lookupSize(shift) bytes for the table.
+  * \param shift the number of ADC value bits dropped, each table byte covers 2^shift counts.
+  */
+  void setLookup(uint8_t *lut, uint8_t shift) { _lut = lut; _lutP = nullptr; _lutShift = shift; };
+
+  /**
+  * Set a lookup table in program memory
+  *
+  * The table is not changed by begin() and must match the key table. It
+  * can be generated using buildLookup() and printed, as shown in the 
+  * AnalogLookup example.
+  *
+  * \param lut   PROGMEM array of lookupSize(shift) bytes built by buildLookup().
+  * \param shift the number of ADC value bits dropped, each table byte covers 2^shift counts.
+  */
+  void setLookup_P(const uint8_t *lut, uint8_t shift) { _lut = nullptr; _lutP = lut; _lutShift = shift; };
+
+  /**
+  * Build a lookup table
+  *
+  * Fill in the lookup table for a key table. Each byte is the index of 
+  * the only key whose tolerance window includes any of the ADC values 
+  * covered by the byte, LUT_NONE if there are none, or LUT_SHARED if there
+  * is more than one.
+  *
+  * \param kt     pointer to a table of analog value key definitions.
+  * \param ktSize number of elements in the kt table.
+  * \param lut    array of lookupSize(shift) bytes for the table.
+  * \param shift  the number of ADC value bits dropped, each table byte covers 2^shift counts.
+  */
+  static void buildLookup(const uiAnalogKeys_t *kt, uint8_t ktSize, uint8_t *lut, uint8_t shift);
+
+  static const uint8_t LUT_NONE = 0xff;   ///< lookup table value for no key
+  static const uint8_t LUT_SHARED = 0xfe; ///< lookup table value for more than one key, these are searched
+  /** @} */
+
+protected:
+  uint8_t     _pin;     ///< pin number
+  uiAnalogKeys_t* _kt;  ///< analog key values table
+  uint8_t   _ktSize;    ///< number of elements in analog keys table
+
+  uint8_t   *_lut;        ///< lookup table in RAM, nullptr if none
+  const uint8_t *_lutP;   ///< lookup table in PROGMEM, nullptr if none
+  uint8_t   _lutShift;    ///< ADC value bits dropped for the lookup table index
+  bool      _overlap;     ///< key table has overlapping windows
+  bool      _async;       ///< read without waiting for the analog conversion
+  bool      _adcBusy;     ///< an analog conversion has been started
+  bool      _adcHeld;     ///< the conversion result was collected by another switch, in _adcValue
+  uint16_t  _adcValue;    ///< conversion result collected by another switch
+  static MD_UISwitch_Analog *_adcAsync;  ///< the switch using enableAsyncRead(), if any
+  bool      _median;      ///< median of 3 filter enabled
+  uint8_t   _histCount;   ///< number of values in _hist, up to 2
+  uint16_t  _hist[2];     ///< previous two analog values for the median filter
+  uint8_t   _settle;      ///< samples needed to accept a new key
+  uint8_t   _candCount;   ///< number of samples in a row for _candIdx
+  int16_t   _candIdx;     ///< key index being checked for acceptance
+  int16_t   _keyIdx;      ///< accepted key index
+
+  uint16_t filter(uint16_t v);  ///< apply the median filter to an analog value
+  int16_t settle(int16_t idx);  ///< apply the settle count to a key index
+
+  int16_t findKey(uint16_t v);  ///< return the key table index for an ADC value
+  void adcWait(void);           ///< collect the async switch conversion before using the ADC
 };
 
 /**
-* Extension class MD_UISwitch_Analog.
+* Extension class MD_UISwitch_Matrix.
 *
-* Implements resistor ladder switches on analog input. This type of switch
-* are typically found on 1602 LCD module shields.
+* Implements keyboard matrix switches that need to be scanned to detect a keypress.
 *
-* image{inline} html lcd_shield.jpg "LCD Shield"
+* \image{inline} html Keypad_Switches.jpg "Keypad Switches"
 *
-* All the switches are wired to one analog input, generally with resistor values 
-* as shown in the circuit below. The switch pressed is determined
-* from the analog value read from the port. This may vary depending on the 
-* implementation of the resistor, so a translation table is implemented to allow
-* the remapping of the analog value to a key number.
+* The class will scan a key matrix that typically have circuits and connections 
+* similar to that shown below. Each row and column is separately connected to a 
+* digital pin, and arrays of pin numbers are passed to the class constructor 
+* to allow the code to scan the matrix to determine which key has been pressed. 
+* Pins should be directly connected to the matrix without pull-up or pull-down 
+* resistors. The library does not make a copy of the pin arrays so they should 
+* remain in scope for the life of the object.
 *
-* \image{inline} html lcd_switch_ladder.png "Analog Ladder Circuit"
+* \image{inline} html Keypad_Circuit_4x4.jpg "Keypad Circuit"
 *
-* The translation table must be determined separately and passed as a parameter to 
-* the class constructor - the utility application Test_Analog_Keys in the examples 
-* folder can be used for this purpose. The class does not copy this table to its 
-* own memory, so it must remain in scope for the life of the object.
+* The class will only return a valid key press if only one key is pressed. If 
+* more than one key is pressed simultaneously, all the keys are ignored until
+* just a single key is again detected.
+*
+* N-Key Rollover
+* --------------
+* Alternatively, enableNKRO() provides storage for a number of key 'slots' and
+* each key pressed is allocated a slot with its own debounce and FSM state, so
+* keys that are held together (chorded) are each detected independently. The 
+* events are returned as key/event pairs using read(keyEvent_t*, uint8_t). Only 
+* keys in use have their state processed, so the processing time depends on the 
+* number of keys active rather than the size of the matrix.
+*
+* In a matrix without diodes, three keys pressed at the corners of a rectangle make
+* the fourth corner appear pressed (ghosting). When ghost detection is enabled 
+* (the default) no new keys are accepted while the scan shows a possible ghost, 
+* and isGhosting() reports the condition.
+*
+* Scanning
+* --------
+* The matrix is scanned by driving each column LOW in turn and reading the rows,
+* which have the internal pull-ups enabled. Lines that are not being driven are 
+* left high impedance. setDriveRows() swaps this over to drive the rows and read
+* the columns, so that a matrix with fewer rows than columns is scanned in fewer
+* steps. A 1x6 matrix then needs one drive step per scan rather than six.
+*
+* In a matrix with a diode on each key, current flows from the pull-up on the 
+* line being read through the diode to the driven line. The diodes must have 
+* their cathodes towards the driven lines - the columns by default, or the rows
+* with setDriveRows() - or no key will be read.
+*
+* Where the hardware port registers can be accessed directly (see UI_PORT_IO and 
+* UI_PORT_DRIVE), begin() looks up the registers and bit mask for each pin and the
+* scan switches the driven lines by writing the port registers, without calling 
+* pinMode(), digitalWrite() or digitalRead(), and reads each input port once per 
+* driven line. This is used if neither dimension has more than UI_MATRIX_LINES
+* lines.
+*
+* While no key is being processed, read() first drives all the lines LOW together 
+* and reads the other dimension once. The full scan only runs if this probe finds a
+* key pressed, so an idle keypad costs about the same as a one line matrix.
+*
+* Incremental Scanning
+* --------------------
+* By default each read() scans the whole matrix. For applications where read()
+* must not take long, setScanSlice() limits the number of lines driven in each
+* call. The keys found are processed by the debounce and FSM once the scan is 
+* complete, and read() returns KEY_NULL for the calls part way through a scan.
+* The time for one read() is then at most the probe plus the lines in a slice,
+* whatever the size of the matrix, but the switch timing resolution becomes the 
+* time for getScanCalls() calls.
+*/
+class MD_UISwitch_Matrix : public MD_UISwitch
+{
+public:
+  //--------------------------------------------------------------
+  /** \name Enumerated values and Typedefs.
+  * @{
+  */
+  /**
+  * N-Key Rollover key slot
+  *
+  * Holds the state for one key being tracked in NKRO mode. The storage is 
+  * provided by the application to enableNKRO() and needs no initialization.
+  */
+  typedef struct
+  {
+    uint8_t    idx;   ///< matrix index of the key in this slot, KEY_SLOT_FREE if not in use
+    dbState_t  db;    ///< debouncing state for the key
+    fsmState_t fsm;   ///< FSM state for the key
+  } keySlot_t;
+
+  static const uint8_t KEY_SLOT_FREE = 0xff;  ///< keySlot_t index for an unused slot
+  static const uint8_t NKRO_SCAN_MAX = 8;     ///< maximum keys recorded in one NKRO scan
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Class constructor and destructor.
+  * @{
+  */
+  /**
+  * Class Constructor.
+  *
+  * Instantiate a new instance of the class. The parameters passed are
+  * used to the hardware interface to the switch.
+  *
+  * The class will only return a valid key if just one key is pressed. If more
+  * than one key is pressed simultaneously, all the keys are ignored until just
+  * a single key is again detected.
+  *
+  * The class does not make copies of the pin array so they should 
+  * remain in scope for the life of the object.
+  *
+  * \param rows    the number of rows in the key matrix.
+  * \param cols    the number of columns in the key matrix.
+  * \param rowPin  array of rows elements of ordered row pins to which the switches are connected.
+  * \param colPin  array of cols elements of ordered column pins to which the switches are connected.
+  * \param kt      the key table. An array of characters arranged in by column then row.
+  */
+  MD_UISwitch_Matrix(uint8_t rows, uint8_t cols, uint8_t* rowPin, uint8_t* colPin, char* kt) :
+    _rows(rows), _cols(cols), _rowPin(rowPin), _colPin(colPin), _kt(kt),
+    _slot(nullptr), _slotCount(0), _ghostCheck(true), _ghost(false),
+    _driveRows(false), _portIO(false), _drivePorts(0), _sensePorts(0),
+    _slice(0), _frameLine(0), _frameCount(0) {};
+
+  /**
+  * Class Destructor.
+  *
+  * Release allocated memory and does the necessary to clean up once the queue is
+  * no longer required.
+  */
+  ~MD_UISwitch_Matrix() {};
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for core object control.
+  * @{
+  */
+  /**
+  * Initialize the object.
+  *
+  * Initialize the object data. This needs to be called during setup() to initialize new
+  * data for the class that cannot be done during the object creation.
+  */
+  virtual void begin(void);
+
+  /**
+  * Return the key pressed of the switch matrix
+  *
+  * Return one of the keypress types depending on what has been detected.
+  * The timing for each keypress starts when the first transition of the
+  * switch from inactive to active state and is recognized by a finite
+  * state machine whose operation is directed by the timer and option
+  * values specified.
+  *
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(void) { return(read(UI_MILLIS())); };
+
+  /**
+  * Return the state of the switch at a given time
+  *
+  * \sa MD_UISwitch::read(uint32_t)
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(uint32_t now);
+
+  /**
+  * Return all the key events from one matrix scan
+  *
+  * Used in N-Key Rollover mode (see enableNKRO()) to scan the matrix once and
+  * process every key currently tracked. The events detected are returned as key
+  * identifier and keyResult_t pairs, the key identifier being the character from
+  * the key table.
+  *
+  * If the event buffer fills, the remaining keys are processed on the next call.
+  * It should be sized for at least the number of key slots.
+  *
+  * If NKRO mode is not enabled this returns the result of read() as one event.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \return the number of events placed in the buffer.
+  */
+  uint8_t read(keyEvent_t *ev, uint8_t evSize) { return(read(ev, evSize, UI_MILLIS())); };
+
+  /**
+  * Return all the key events at a given time
+  *
+  * Same as read(keyEvent_t*, uint8_t) using the time passed for the FSM timing.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \param now     the current time, as returned by UI_MILLIS().
+  * \return the number of events placed in the buffer.
+  */
+  virtual uint8_t read(keyEvent_t *ev, uint8_t evSize, uint32_t now);
+
+  /**
+  * Time to the next timed event
+  *
+  * In NKRO mode this is the earliest deadline for all the keys being tracked.
+  *
+  * \sa MD_UISwitch::nextDeadline()
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  virtual uint32_t nextDeadline(uint32_t now);
+
+  virtual uint32_t nextDeadline(void) { return(nextDeadline(UI_MILLIS())); };  ///< Time to the next timed event, see nextDeadline(uint32_t)
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for N-Key Rollover.
+  * @{
+  */
+  /**
+  * Enable N-Key Rollover mode
+  *
+  * Provide the storage for the keys that can be tracked at the same time and 
+  * switch the object into NKRO mode. The data is not copied so the array must 
+  * remain in scope for the life of the object. Passing a nullptr or zero count
+  * returns to single key mode.
+  *
+  * \param slot  pointer to an array of key slots.
+  * \param count the number of elements in the slot array.
+  */
+  void enableNKRO(keySlot_t *slot, uint8_t count);
+
+  /**
+  * Enable ghost key detection
+  *
+  * Enable or disable the detection of ghost keys in NKRO mode. This should be
+  * disabled for a matrix with a diode for each key, where ghosting cannot occur.
+  * Default is enabled.
+  *
+  * \param f true to enable, false to disable.
+  */
+  inline void enableGhostDetect(bool f) { _ghostCheck = f; };
+
+  /**
+  * Check for ghost keys
+  *
+  * \return true if the last NKRO scan showed a possible ghost key.
+  */
+  inline bool isGhosting(void) { return(_ghost); };
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for object parameters and options.
+  * @{
+  */
+  /**
+  * Set the lines driven by the scan
+  *
+  * Drive the rows and read the columns, or drive the columns and read the rows
+  * (the default), as described in the class description. Driving the smaller 
+  * dimension makes each scan shorter. For a matrix with a diode on each key the
+  * diodes must be fitted to suit the lines driven.
+  *
+  * This must be called before begin().
+  *
+  * \param f true to drive the rows, false to drive the columns.
+  */
+  inline void setDriveRows(bool f) { _driveRows = f; };
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for incremental scanning.
+  * @{
+  */
+  /**
+  * Set the number of lines scanned per read()
+  *
+  * Limit the number of matrix lines driven in each call to read(), as described in
+  * the class description. The lines driven are the columns, or the rows if set by
+  * setDriveRows(). Any scan in progress is restarted.
+  *
+  * \param lines the lines scanned per call, 0 to scan the whole matrix (the default).
+  */
+  inline void setScanSlice(uint8_t lines) { _slice = lines; _frameLine = 0; };
+
+  /**
+  * Get the number of read() calls for a complete scan
+  *
+  * When a key is pressed, this is the number of calls to read() needed to scan
+  * the whole matrix and process the keys. While the matrix is idle the probe 
+  * completes the scan in one call.
+  *
+  * \return the number of read() calls for each complete scan of the matrix.
+  */
+  uint8_t getScanCalls(void);
+  /** @} */
+
+protected:
+  uint8_t   _rows;       ///< number of rows in the key matrix
+  uint8_t   _cols;       ///< number of columns in the key matrix
+  uint8_t   *_rowPin;    ///< array of pins connected to the rows 
+  uint8_t   *_colPin;    ///< array of pins connected to the columns
+  char      *_kt;        ///< analog key values in a char string
+
+  keySlot_t *_slot;      ///< NKRO key slots, nullptr for single key mode
+  uint8_t   _slotCount;  ///< number of NKRO key slots
+  bool      _ghostCheck; ///< NKRO ghost detection enabled
+  bool      _ghost;      ///< NKRO ghost detected in last scan
+
+  bool      _driveRows;  ///< rows are driven and the columns read
+  bool      _portIO;     ///< scan using the port registers below
+  uint8_t       _drivePorts;                          ///< number of mode registers for the driven lines
+  volatile UI_PORT_TYPE *_driveMode[UI_MATRIX_LINES]; ///< mode registers for the driven lines
+  volatile UI_PORT_TYPE *_driveOut[UI_MATRIX_LINES];  ///< output register paired with each mode register
+  UI_PORT_TYPE  _driveAll[UI_MATRIX_LINES];           ///< bit mask of all the driven lines in each register
+  uint8_t       _driveIdx[UI_MATRIX_LINES];           ///< _driveMode[] index for each driven line
+  UI_PORT_TYPE  _driveMask[UI_MATRIX_LINES];          ///< bit mask for each driven line
+  uint8_t       _sensePorts;                          ///< number of input registers for the lines read
+  volatile UI_PORT_TYPE *_senseIn[UI_MATRIX_LINES];   ///< input registers for the lines read
+  uint8_t       _senseIdx[UI_MATRIX_LINES];           ///< _senseIn[] index for each line read
+  UI_PORT_TYPE  _senseMask[UI_MATRIX_LINES];          ///< bit mask for each line read
+
+  uint8_t   _slice;      ///< lines scanned per read() call, 0 for all of them
+  uint8_t   _frameLine;  ///< next line of an incremental scan, 0 at the start of the scan
+  uint16_t  _frameCount; ///< keys found so far in the incremental scan
+  uint8_t   _frameKeys[NKRO_SCAN_MAX]; ///< first keys found in the incremental scan
+
+  inline uint8_t keyIndex(uint8_t d, uint8_t s) { return(_driveRows ? (d * _cols) + s : (s * _cols) + d); };  ///< key index for a driven and read line pair
+
+  bool probe(void);  ///< drive all the lines together and return true if any key is pressed
+  uint16_t scan(uint8_t *active, uint8_t size);  ///< scan the matrix, return the active key count
+  uint16_t scanLines(uint8_t first, uint8_t last, uint8_t *active, uint8_t size, uint16_t count);  ///< scan some driven lines, return the updated key count
+  uint16_t scanPins(uint8_t first, uint8_t last, uint8_t *active, uint8_t size, uint16_t count);   ///< scanLines() using the pin functions
+  uint16_t scanPorts(uint8_t first, uint8_t last, uint8_t *active, uint8_t size, uint16_t count);  ///< scanLines() using the port registers
+  bool scanSlice(uint8_t size, bool idle);  ///< scan the next slice, return true when the scan is complete
+  bool ghostCheck(uint8_t *active, uint8_t count);  ///< true if the active keys could include a ghost
+};
+
+/**
+* Extension class MD_UISwitch_4017KM.
+*
+* Implements keyboard matrix switches implemented using 4017 decade counter
+* (see https://arduinoplusplus.wordpress.com/2016/02/17/up-to-100-switches-with-3-digital-pins/).
+*
+* \image{inline} html Matrix_4017_KM.jpg "Key Matrix 4017"
+*
+* Using a 4017 IC, this class implements a method for reading many open/closed switches
+* using only three digital I/O pins (Clock, Reset and DataIn). The class will scan a key 
+* matrix that have circuits similar to that shown above. Pin numbers used are passed to 
+* the class constructor allow the code to manage the 4017 IC to determine which key has 
+* been pressed. Pins should be directly connected to the matrix without pull-up or 
+* pull-down resistors.
+*
+* The class will only detect a key if there is just one key pressed. If more than one 
+* key is pressed it will pause until just one key remains pressed.
+*
+* Checking every key takes a clock pulse for each key. If the keys have a diode in
+* series with each 4017 output, an additional output pin can be connected through a
+* diode to the 4017 side of every key switch (see setProbePin()). Setting this pin
+* HIGH makes every key pressed show on the key pin at once, so while no key is being
+* processed read() can check for any key pressed in one step, and only clocks 
+* through the keys if one is found.
+*
+* As for MD_UISwitch_Matrix, setScanSlice() limits the number of keys checked in 
+* each call to read(), with the keys processed once they have all been checked.
 */
-class MD_UISwitch_Analog : public MD_UISwitch
+class MD_UISwitch_4017KM : public MD_UISwitch
 {
 public:
-  //--------------------------------------------------------------
-  /** \name Enumerated values and Typedefs.
-  * @{
-  */
-  /**
-  * Data table for switch values
-  *
-  * The read() will use this table to determine which key has been pressed
-  * and getKey() will return the specified identifier.
-  */
-  typedef struct
-  {
-    uint16_t  adcThreshold; ///< Average analog value of the 
-    uint8_t   adcTolerance; ///< Valid +/- tolerance range around adcThreshold for a key
-    uint8_t   value;        ///< Identifier for this key, returned using getKey()
-  } uiAnalogKeys_t;
-  /** @} */
-
   //--------------------------------------------------------------
   /** \name Class constructor and destructor.
   * @{
@@ -651,24 +3556,26 @@ public:
   * Instantiate a new instance of the class. The parameters passed are
   * used to the hardware interface to the switch.
   *
-  * The key definitions table is not copied by the class, so user code
-  * must ensure that the table remains in scope for the life of the object 
-  * created.
+  * The class will only return a valid key if just one key is pressed. If more
+  * than one key is pressed simultaneously, all the keys are ignored until just
+  * a single key is again detected.
   *
-  * \param pin    the analog pin to which the switches are connected.
-  * \param kt     pointer to a table of analog value key definitions
-  * \param ktSize number of elements in the kt table
+  * \param numKeys the number of keys in the 4017 matrix (rows*columns).
+  * \param pinClk  pin number for the 4017 clock pin, LOW to HIGH transition.
+  * \param pinRst  pin number for the 4017 reset pin (0 if not used), LOW to HIGH transition.
+  * \param pinKey  pin number for the key switch output to Arduino, HIGH means key is pressed.
   */
-  MD_UISwitch_Analog(uint8_t pin, uiAnalogKeys_t* kt, uint8_t ktSize) :
-    _pin(pin), _kt(kt), _ktSize(ktSize) {};
-
+  MD_UISwitch_4017KM(uint8_t numKeys, uint8_t pinClk, uint8_t pinKey, uint8_t pinRst) :
+    _numKeys(numKeys), _pinClk(pinClk), _pinKey(pinKey), _pinRst(pinRst), _pinProbe(0),
+    _slice(0), _frameStep(0), _frameCount(0), _frameIdx(-1) {};
+  
   /**
   * Class Destructor.
   *
   * Release allocated memory and does the necessary to clean up once the queue is
   * no longer required.
   */
-  ~MD_UISwitch_Analog() {};
+  ~MD_UISwitch_4017KM() {};
   /** @} */
 
   //--------------------------------------------------------------
@@ -684,7 +3591,7 @@ public:
   virtual void begin(void);
 
   /**
-  * Return the state of the switch
+  * Return the key pressed of the switch matrix
   *
   * Return one of the keypress types depending on what has been detected.
   * The timing for each keypress starts when the first transition of the
@@ -694,41 +3601,126 @@ public:
   *
   * \return one of the keyResult_t enumerated values
   */
-  virtual keyResult_t read(void);
+  virtual keyResult_t read(void) { return(read(UI_MILLIS())); };
+
+  /**
+  * Return the state of the switch at a given time
+  *
+  * \sa MD_UISwitch::read(uint32_t)
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return one of the keyResult_t enumerated values
+  */
+  virtual keyResult_t read(uint32_t now);
+
+  using MD_UISwitch::read;   // read(keyEvent_t*, uint8_t) key event versions
+
+  /**
+  * Set the probe pin
+  *
+  * Set the pin wired to check all the keys at once, as described in the class 
+  * description. This should be set before begin() is called.
+  *
+  * \param pin the probe pin number, 0 if not used (the default).
+  */
+  inline void setProbePin(uint8_t pin) { _pinProbe = pin; };
+
+  /**
+  * Time to the next timed event
+  *
+  * Part way through an incremental scan this is 0, as the scan needs to be completed.
+  *
+  * \sa MD_UISwitch::nextDeadline()
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the milliseconds to the next timed event, 0 or DEADLINE_NONE.
+  */
+  virtual uint32_t nextDeadline(uint32_t now) { return(_frameStep != 0 ? 0 : MD_UISwitch::nextDeadline(now)); };
+
+  virtual uint32_t nextDeadline(void) { return(nextDeadline(UI_MILLIS())); };  ///< Time to the next timed event, see nextDeadline(uint32_t)
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for incremental scanning.
+  * @{
+  */
+  /**
+  * Set the number of keys checked per read()
+  *
+  * Limit the number of 4017 clock steps in each call to read(). The keys are 
+  * processed by the debounce and FSM once they have all been checked, and read()
+  * returns KEY_NULL for the calls part way through. Any scan in progress is 
+  * restarted.
+  *
+  * \param steps the keys checked per call, 0 to check all the keys (the default).
+  */
+  inline void setScanSlice(uint8_t steps) { _slice = steps; _frameStep = 0; };
+
+  /**
+  * Get the number of read() calls for a complete scan
+  *
+  * \sa MD_UISwitch_Matrix::getScanCalls()
+  *
+  * \return the number of read() calls for each complete scan of the keys.
+  */
+  inline uint8_t getScanCalls(void) { return((_slice == 0 || _slice >= _numKeys) ? 1 : (_numKeys + _slice - 1) / _slice); };
   /** @} */
 
 protected:
-  uint8_t     _pin;     ///< pin number
-  uiAnalogKeys_t* _kt;  ///< analog key values table
-  uint8_t   _ktSize;    ///< number of elements in analog keys table
+  uint8_t  _numKeys; ///< total number of keys
+  uint8_t  _pinClk;  ///< 4017 clock pin, LOW to HIGH transition
+  uint8_t  _pinKey;  ///< key switch output to Arduino, HIGH means key is pressed	
+  uint8_t  _pinRst;  ///< 4017 reset pin (0 if not used), LOW to HIGH transition
+  uint8_t  _pinProbe; ///< probe pin to check all the keys at once (0 if not used), HIGH to check
 
-  int16_t   _lastKeyIdx;  ///< index of the last key read
+  uint8_t  _slice;      ///< keys checked per read() call, 0 for all of them
+  uint8_t  _frameStep;  ///< next key of an incremental scan, 0 at the start of the scan
+  int16_t  _frameCount; ///< keys found so far in the incremental scan
+  int16_t  _frameIdx;   ///< first key found in the incremental scan
+
+  void reset(void);  ///< reset the 4017 IC
+  void clock(void);  ///< clock the 4017 IC
+  bool probe(void);  ///< return true if any key is pressed, using the probe pin
 };
 
+
 /**
-* Extension class MD_UISwitch_Matrix.
-*
-* Implements keyboard matrix switches that need to be scanned to detect a keypress.
-*
-* \image{inline} html Keypad_Switches.jpg "Keypad Switches"
+* Event queue class MD_UISwitch_Queue.
 *
-* The class will scan a key matrix that typically have circuits and connections 
-* similar to that shown below. Each row and column is separately connected to a 
-* digital pin, and arrays of pin numbers are passed to the class constructor 
-* to allow the code to scan the matrix to determine which key has been pressed. 
-* Pins should be directly connected to the matrix without pull-up or pull-down 
-* resistors. The library does not make a copy of the pin arrays so they should 
-* remain in scope for the life of the object.
+* Implements a lock-free single producer, single consumer ring buffer of key
+* events. This allows the switches to be scanned in one context (eg, a timer
+* interrupt) and the events consumed in another (eg, the main loop), without
+* disabling interrupts and without the scanning and consuming having to occur
+* in the same loop iteration.
 *
-* \image{inline} html Keypad_Circuit_4x4.jpg "Keypad Circuit"
+* Exactly one context may add events using push() or scan() and exactly one
+* other context may remove them using pop() or count(). The head index is only
+* written by the producer and the tail index only by the consumer, so no locks
+* are needed provided each index is read and written atomically. This is true
+* for the 8 bit indices used on all supported architectures. The UI_MEMORY_BARRIER()
+* HAL macro orders the event data writes with respect to the index updates.
 *
-* The class will only return a valid key press if only one key is pressed. If 
-* more than one key is pressed simultaneously, all the keys are ignored until
-* just a single key is again detected.
+* The event buffer is an array provided by the application with a size that
+* is a power of 2, no larger than 128 elements. The array is not copied, so it
+* must remain in scope for the life of the object. Events that arrive when the
+* queue is full are discarded and counted as overflows.
 */
-class MD_UISwitch_Matrix : public MD_UISwitch
+class MD_UISwitch_Queue
 {
 public:
+  /**
+   * Queued key event
+   *
+   * A key event with the time it was detected. The result is stored as
+   * a byte to keep the event compact.
+   */
+  typedef struct
+  {
+    uint32_t time;    ///< UI_MILLIS() time when the event was detected
+    uint8_t  key;     ///< identifier for the key, as would be returned by getKey()
+    uint8_t  result;  ///< the MD_UISwitch::keyResult_t event detected for this key
+  } queueEvent_t;
+
   //--------------------------------------------------------------
   /** \name Class constructor and destructor.
   * @{
@@ -736,24 +3728,13 @@ public:
   /**
   * Class Constructor.
   *
-  * Instantiate a new instance of the class. The parameters passed are
-  * used to the hardware interface to the switch.
-  *
-  * The class will only return a valid key if just one key is pressed. If more
-  * than one key is pressed simultaneously, all the keys are ignored until just
-  * a single key is again detected.
-  *
-  * The class does not make copies of the pin array so they should 
-  * remain in scope for the life of the object.
+  * Instantiate a new instance of the class. If size is not a power of 2
+  * only the largest power of 2 elements of the buffer that fit are used.
   *
-  * \param rows    the number of rows in the key matrix.
-  * \param cols    the number of columns in the key matrix.
-  * \param rowPin  array of rows elements of ordered row pins to which the switches are connected.
-  * \param colPin  array of cols elements of ordered column pins to which the switches are connected.
-  * \param kt      the key table. An array of characters arranged in by column then row.
+  * \param buf   pointer to the array used to hold the events.
+  * \param size  the number of elements in buf (power of 2, maximum 128).
   */
-  MD_UISwitch_Matrix(uint8_t rows, uint8_t cols, uint8_t* rowPin, uint8_t* colPin, char* kt) :
-    _rows(rows), _cols(cols), _rowPin(rowPin), _colPin(colPin), _kt(kt) {};
+  MD_UISwitch_Queue(queueEvent_t *buf, uint8_t size);
 
   /**
   * Class Destructor.
@@ -761,64 +3742,143 @@ public:
   * Release allocated memory and does the necessary to clean up once the queue is
   * no longer required.
   */
-  ~MD_UISwitch_Matrix() {};
+  ~MD_UISwitch_Queue() {};
   /** @} */
 
   //--------------------------------------------------------------
-  /** \name Methods for core object control.
+  /** \name Methods for the producer.
   * @{
   */
   /**
-  * Initialize the object.
+  * Add an event to the queue
   *
-  * Initialize the object data. This needs to be called during setup() to initialize new
-  * data for the class that cannot be done during the object creation.
+  * Add the event to the head of the queue. If the queue is full the event
+  * is discarded and the overflow count incremented.
+  *
+  * \param key    the key identifier.
+  * \param result the event detected.
+  * \param time   the time the event was detected.
+  * \return true if the event was queued, false if the queue was full.
   */
-  virtual void begin(void);
+  bool push(uint8_t key, MD_UISwitch::keyResult_t result, uint32_t time);
 
   /**
-  * Return the key pressed of the switch matrix
+  * Read a switch and queue the result
   *
-  * Return one of the keypress types depending on what has been detected.
-  * The timing for each keypress starts when the first transition of the
-  * switch from inactive to active state and is recognized by a finite
-  * state machine whose operation is directed by the timer and option
-  * values specified.
+  * Call the switch read() method and add any event detected to the queue,
+  * using getKey() as the key identifier and the current UI_MILLIS() time.
+  * This is intended to be called from a timer interrupt.
   *
-  * \return one of the keyResult_t enumerated values
+  * \param s the switch object to read.
+  * \return the keyResult_t returned by the switch read().
+  */
+  MD_UISwitch::keyResult_t scan(MD_UISwitch &s);
+  /** @} */
+
+  //--------------------------------------------------------------
+  /** \name Methods for the consumer.
+  * @{
+  */
+  /**
+  * Remove an event from the queue
+  *
+  * \param e the event structure to fill with the oldest event in the queue.
+  * \return true if an event was removed, false if the queue was empty.
+  */
+  bool pop(queueEvent_t &e);
+
+  /**
+  * Remove a batch of events from the queue
+  *
+  * Remove up to size events, oldest first, releasing the space in the
+  * queue only once for the whole batch.
+  *
+  * \param ev   pointer to the buffer for the events.
+  * \param size the number of events the buffer can hold.
+  * \return the number of events placed in the buffer.
+  */
+  uint8_t pop(queueEvent_t *ev, uint8_t size);
+
+  /**
+  * Number of queued events
+  *
+  * \return the number of events waiting in the queue.
+  */
+  inline uint8_t count(void) { return((uint8_t)(_head - _tail)); };
+
+  /**
+  * Number of lost events
+  *
+  * The total count of events discarded because the queue was full. The
+  * counter wraps around, so the number of events lost over a period is
+  * the difference between two readings.
+  *
+  * \return the number of events discarded.
   */
-  virtual keyResult_t read(void);
+  uint16_t getOverflow(void);
   /** @} */
 
 protected:
-  uint8_t   _rows;       ///< number of rows in the key matrix
-  uint8_t   _cols;       ///< number of columns in the key matrix
-  uint8_t   *_rowPin;    ///< array of pins connected to the rows 
-  uint8_t   *_colPin;    ///< array of pins connected to the columns
-  char      *_kt;        ///< analog key values in a char string
+  queueEvent_t     *_buf;      ///< the event buffer
+  uint8_t          _mask;      ///< buffer size - 1, to wrap the indices
+  volatile uint8_t _head;      ///< free running index of the next event written, producer only
+  volatile uint8_t _tail;      ///< free running index of the next event read, consumer only
+  volatile uint16_t _overflow; ///< number of events discarded, producer only
 };
 
 /**
-* Extension class MD_UISwitch_4017KM.
+* Switch group class MD_UISwitch_Group.
 *
-* Implements keyboard matrix switches implemented using 4017 decade counter
-* (see https://arduinoplusplus.wordpress.com/2016/02/17/up-to-100-switches-with-3-digital-pins/).
-*
-* \image{inline} html Matrix_4017_KM.jpg "Key Matrix 4017"
+* Manages a group of switch objects of any mix of types, so that they can all
+* be processed with one call. Each read() takes the time once, reads the switches
+* and merges all their events into a single stream of events tagged with the
+* position of the switch in the group. This replaces the loop over an array of
+* switches found in many applications.
 *
-* Using a 4017 IC, this class implements a method for reading many open/closed switches
-* using only three digital I/O pins (Clock, Reset and DataIn). The class will scan a key 
-* matrix that have circuits similar to that shown above. Pin numbers used are passed to 
-* the class constructor allow the code to manage the 4017 IC to determine which key has 
-* been pressed. Pins should be directly connected to the matrix without pull-up or 
-* pull-down resistors.
+* The group keeps track of when each switch next needs to be read using the
+* switch nextDeadline(). Switches that are debouncing are read on every call,
+* and switches with a running timer are read when it expires. Otherwise a switch
+* can only change when its input changes, so by default every switch is also
+* read on every call. An idle scan time can be set with setIdleTime() so that
+* switches are only read for input changes at that interval. This reduces the
+* time spent on each call for large groups, at the cost of a delay of up to the
+* idle scan time in detecting a press or release. An application with pin change
+* interrupts can instead call wake() from the interrupt routine so that all the
+* switches are read on the next call.
 *
-* The class will only detect a key if there is just one key pressed. If more than one 
-* key is pressed it will pause until just one key remains pressed.
+* The switches are defined in an array of pointers to the switch objects and the
+* group keeps its information about each switch in an array of groupState_t of the
+* same size. Both arrays are provided by the application, are not copied and
+* must remain in scope for the life of the object.
 */
-class MD_UISwitch_4017KM : public MD_UISwitch
+class MD_UISwitch_Group
 {
 public:
+  static const uint8_t EVENT_MAX = 8;   ///< maximum events taken from one switch in a read
+
+  /**
+   * Group member state
+   *
+   * The group's record of when a switch next needs to be read.
+   */
+  typedef struct
+  {
+    uint32_t due;   ///< time the switch is next due to be read
+    bool     wait;  ///< switch is only waiting for an input change
+  } groupState_t;
+
+  /**
+   * Group event
+   *
+   * A key event tagged with the switch that reported it.
+   */
+  typedef struct
+  {
+    uint8_t                  id;      ///< position of the switch in the group array
+    uint8_t                  key;     ///< identifier for the key, as would be returned by getKey()
+    MD_UISwitch::keyResult_t result;  ///< the event detected for this key
+  } groupEvent_t;
+
   //--------------------------------------------------------------
   /** \name Class constructor and destructor.
   * @{
@@ -826,28 +3886,22 @@ public:
   /**
   * Class Constructor.
   *
-  * Instantiate a new instance of the class. The parameters passed are
-  * used to the hardware interface to the switch.
-  *
-  * The class will only return a valid key if just one key is pressed. If more
-  * than one key is pressed simultaneously, all the keys are ignored until just
-  * a single key is again detected.
+  * Instantiate a new instance of the class.
   *
-  * \param numKeys the number of keys in the 4017 matrix (rows*columns).
-  * \param pinClk  pin number for the 4017 clock pin, LOW to HIGH transition.
-  * \param pinRst  pin number for the 4017 reset pin (0 if not used), LOW to HIGH transition.
-  * \param pinKey  pin number for the key switch output to Arduino, HIGH means key is pressed.
+  * \param sw    array of pointers to the switches in the group.
+  * \param state array of count elements for the state of each switch.
+  * \param count the number of switches in the group.
   */
-  MD_UISwitch_4017KM(uint8_t numKeys, uint8_t pinClk, uint8_t pinKey, uint8_t pinRst) :
-    _numKeys(numKeys), _pinClk(pinClk), _pinKey(pinKey), _pinRst(pinRst) {};
-  
+  MD_UISwitch_Group(MD_UISwitch *sw[], groupState_t *state, uint8_t count) :
+    _sw(sw), _state(state), _count(count), _next(0), _passLeft(0), _idleTime(0), _timeIdle(0), _wake(true) {};
+
   /**
   * Class Destructor.
   *
   * Release allocated memory and does the necessary to clean up once the queue is
   * no longer required.
   */
-  ~MD_UISwitch_4017KM() {};
+  ~MD_UISwitch_Group() {};
   /** @} */
 
   //--------------------------------------------------------------
@@ -857,32 +3911,90 @@ public:
   /**
   * Initialize the object.
   *
-  * Initialize the object data. This needs to be called during setup() to initialize new
-  * data for the class that cannot be done during the object creation.
+  * Initialize the object data and call begin() for every switch in the group.
+  * This needs to be called during setup(). The switch begin() methods should
+  * not also be called by the application.
   */
-  virtual void begin(void);
+  void begin(void);
 
   /**
-  * Return the key pressed of the switch matrix
+  * Read all the switches
   *
-  * Return one of the keypress types depending on what has been detected.
-  * The timing for each keypress starts when the first transition of the
-  * switch from inactive to active state and is recognized by a finite
-  * state machine whose operation is directed by the timer and option
-  * values specified.
+  * Read the switches in the group that are due and return the events detected,
+  * tagged with the position of the switch in the group array. If the event buffer
+  * fills, the remaining switches are read first on the next call, including any
+  * still to be read after a wake() or idle scan, and nextDeadline() returns 0
+  * until they have been.
   *
-  * \return one of the keyResult_t enumerated values
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \return the number of events placed in the buffer.
+  */
+  uint8_t read(groupEvent_t *ev, uint8_t evSize) { return(read(ev, evSize, UI_MILLIS())); };
+
+  /**
+  * Read all the switches at a given time
+  *
+  * Same as read(groupEvent_t*, uint8_t) using the time passed.
+  *
+  * \param ev      pointer to the buffer for the events detected.
+  * \param evSize  the number of events the buffer can hold.
+  * \param now     the current time, as returned by UI_MILLIS().
+  * \return the number of events placed in the buffer.
+  */
+  uint8_t read(groupEvent_t *ev, uint8_t evSize, uint32_t now);
+
+  /**
+  * Time to the next read
+  *
+  * Return the number of milliseconds until the group next needs to be read,
+  * including the next idle scan if an idle scan time is set.
+  *
+  * \sa MD_UISwitch::nextDeadline()
+  *
+  * \return the milliseconds to the next timed event, 0 or MD_UISwitch::DEADLINE_NONE.
+  */
+  uint32_t nextDeadline(void) { return(nextDeadline(UI_MILLIS())); };
+
+  /**
+  * Time to the next read at a given time
+  *
+  * \param now the current time, as returned by UI_MILLIS().
+  * \return the milliseconds to the next timed event, 0 or MD_UISwitch::DEADLINE_NONE.
+  */
+  uint32_t nextDeadline(uint32_t now);
+
+  /**
+  * Read all switches on the next call
+  *
+  * Force all the switches to be read on the next call to read(), whether they
+  * are due or not. This can be called from an interrupt routine (eg, a pin change).
   */
-  virtual keyResult_t read(void);
+  inline void wake(void) { _wake = true; };
   /** @} */
 
-protected:
-  uint8_t  _numKeys; ///< total number of keys
-  uint8_t  _pinClk;  ///< 4017 clock pin, LOW to HIGH transition
-  uint8_t  _pinKey;  ///< key switch output to Arduino, HIGH means key is pressed	
-  uint8_t  _pinRst;  ///< 4017 reset pin (0 if not used), LOW to HIGH transition
+  //--------------------------------------------------------------
+  /** \name Methods for object parameters and options.
+  * @{
+  */
+  /**
+  * Set the idle scan time
+  *
+  * Set the time in milliseconds between reads of switches that are only waiting
+  * for an input change. The default of 0 reads these switches on every call.
+  *
+  * \param t the specified time in milliseconds.
+  */
+  inline void setIdleTime(uint16_t t) { _idleTime = t; };
+  /** @} */
 
-  void reset(void);  ///< reset the 4017 IC
-  void clock(void);  ///< clock the 4017 IC
+protected:
+  MD_UISwitch   **_sw;       ///< the switches in the group
+  groupState_t  *_state;     ///< the group state for each switch
+  uint8_t       _count;      ///< number of switches in the group
+  uint8_t       _next;       ///< switch to read first on the next call
+  uint8_t       _passLeft;   ///< switches still to be read in the current pass of all switches
+  uint16_t      _idleTime;   ///< time between idle scans in milliseconds
+  uint32_t      _timeIdle;   ///< time of the last idle scan
+  volatile bool _wake;       ///< read all switches on the next call
 };
-